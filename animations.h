@@ -0,0 +1,47 @@
+// Animations for scoreboard_LED.ino, the frame records described under
+// "Animations" there. Made by host/anim_compile from host/animations/,
+// edit those and run make -C host animations rather than editing this.
+
+// win: 6 frames, 169 bytes
+const byte winAnimation[] PROGMEM = {
+    15, 1, 1, 0, 31, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127,
+    15, 1, 1, 8, 31, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127,
+    15, 1, 1, 0, 31, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127,
+    15, 1, 1, 8, 31, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127, 112, 127,
+        112, 127, 112, 127,
+    10, 1, 1, 0, 16, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247, 247,
+        247, 247, 247, 247, 247,
+    10, 1, 0,
+    0,
+};
+
+// drain: 4 frames, 79 bytes
+const byte drainAnimation[] PROGMEM = {
+    8, 0, 1, 9, 19, 3, 224, 3, 224, 3, 224, 3, 224, 3, 224, 3,
+        224, 3, 224, 3, 224, 3, 224, 3,
+    8, 0, 1, 9, 10, 240, 240, 240, 240, 240, 240, 240, 240, 240, 0,
+    8, 0, 1, 9, 19, 3, 224, 3, 224, 3, 224, 3, 224, 3, 224, 3,
+        224, 3, 224, 3, 224, 3, 224, 3,
+    8, 0, 1, 9, 10, 240, 240, 240, 240, 240, 240, 240, 240, 240, 0,
+    0,
+};
+
+// attract: 4 frames, 109 bytes
+const byte attractAnimation[] PROGMEM = {
+    8, 1, 1, 0, 22, 114, 240, 112, 114, 240, 112, 114, 240, 112, 114, 240,
+        112, 114, 240, 112, 114, 240, 112, 114, 240, 112, 114,
+    8, 1, 1, 8, 22, 117, 240, 112, 117, 240, 112, 117, 240, 112, 117, 240,
+        112, 117, 240, 112, 117, 240, 112, 117, 240, 112, 117,
+    8, 1, 1, 16, 22, 114, 240, 112, 114, 240, 112, 114, 240, 112, 114, 240,
+        112, 114, 240, 112, 114, 240, 112, 114, 240, 112, 114,
+    8, 1, 1, 24, 22, 117, 240, 112, 117, 240, 112, 117, 240, 112, 117, 240,
+        112, 117, 240, 112, 117, 240, 112, 117, 240, 112, 117,
+    0,
+};
@@ -0,0 +1,295 @@
+#include <string.h>
+#include <stdint.h>
+
+// Shadow copy of what each LED matrix is currently showing.
+// The game code sets the fields it wants on a display and display_Flush()
+// only sends the fields that differ from what its Arduino already shows.
+
+#define SHADOW_TEXT_MAX 8        // the Arduino only draws 8 characters per row
+#define SHADOW_MARQUEE_MAX 24    // longest scrolling message, the Arduino takes up to 26
+
+#define MARQUEE_LOOP 0x01        // marquee flag: keep scrolling instead of running once
+
+#define SHADOW_TOP     0x01
+#define SHADOW_BOTTOM  0x02
+#define SHADOW_SCORE   0x04
+#define SHADOW_BALLS   0x08
+#define SHADOW_CLEAR   0x10     // a full clear must go out before any field
+#define SHADOW_MARQUEE 0x20     // scrolling message, the Arduino animates it by itself
+#define SHADOW_ANIMATION 0x40   // one shot, sent once and never part of shown
+#define SHADOW_LANE_BEST 0x80   // this lane's best, the leaderboard shows the best of all lanes
+
+typedef struct {
+    char top[SHADOW_TEXT_MAX + 1];
+    char bottom[SHADOW_TEXT_MAX + 1];
+    uint8_t topColor;
+    uint8_t bottomColor;
+    int16_t score;
+    uint8_t scoreColor;
+    uint8_t balls;
+    char marquee[SHADOW_MARQUEE_MAX + 1];
+    uint8_t marqueeRow;      // 0x01 top or 0x02 bottom
+    uint8_t marqueeColor;
+    uint8_t marqueeStepMs;   // ms per column step
+    uint8_t marqueeFlags;
+    uint8_t animation;
+    uint8_t animationRepeats;
+    uint8_t animationFlags;
+    int16_t laneBest;
+    uint8_t shown;   // fields the Arduino is currently drawing
+    uint8_t dirty;   // fields that must be resent on the next flush
+    uint8_t channel; // I2C channel of the display's Arduino
+} DisplayShadow;
+
+#define DISPLAY_LANE 0          // the lane's own scoreboard
+#define DISPLAY_LEADERBOARD 1   // board shared by every lane, showing the best of them all
+#define DISPLAY_COUNT 2
+
+DisplayShadow displays[DISPLAY_COUNT];
+uint8_t displayNext = 0;    // display the next display_FlushAll() starts with
+
+// ties every display to its I2C channel
+void display_Init(void) {
+    displays[DISPLAY_LANE].channel = I2C_CHANNEL_LANE;
+    displays[DISPLAY_LEADERBOARD].channel = I2C_CHANNEL_LEADERBOARD;
+}
+
+// copies a message into a shadow text field of max characters, truncated like the Arduino does
+// returns 1 if the stored text changed
+uint8_t display_CopyText(char* field, const char* message, uint8_t max) {
+    uint8_t changed = 0;
+    uint8_t i = 0;
+    for (; i < max && message[i] != '\0'; i++) {
+        if (field[i] != message[i]) {
+            field[i] = message[i];
+            changed = 1;
+        }
+    }
+    if (field[i] != '\0') {
+        field[i] = '\0';
+        changed = 1;
+    }
+    return changed;
+}
+
+// wipes the matrix. every field has to be set again after this
+void display_Clear(DisplayShadow* display) {
+    display->shown = 0;
+    display->dirty = SHADOW_CLEAR;
+    display->top[0] = '\0';
+    display->bottom[0] = '\0';
+    display->marquee[0] = '\0';
+}
+
+// sets the top row text and color
+void display_Top(DisplayShadow* display, uint8_t color, const char* message) {
+    uint8_t changed = display_CopyText(display->top, message, SHADOW_TEXT_MAX);
+    if (changed || color != display->topColor || !(display->shown & SHADOW_TOP)) {
+        display->topColor = color;
+        display->dirty |= SHADOW_TOP;
+    }
+}
+
+// sets the bottom row text and color
+void display_Bottom(DisplayShadow* display, uint8_t color, const char* message) {
+    uint8_t changed = display_CopyText(display->bottom, message, SHADOW_TEXT_MAX);
+    if (changed || color != display->bottomColor || !(display->shown & SHADOW_BOTTOM)) {
+        display->bottomColor = color;
+        display->dirty |= SHADOW_BOTTOM;
+    }
+}
+
+// sets the score shown on the bottom right and its color
+void display_Score(DisplayShadow* display, int16_t number, uint8_t color) {
+    if (number != display->score || color != display->scoreColor || !(display->shown & SHADOW_SCORE)) {
+        display->score = number;
+        display->scoreColor = color;
+        display->dirty |= SHADOW_SCORE;
+    }
+}
+
+// sets the number of ball leds that are lit
+void display_Balls(DisplayShadow* display, uint8_t ballCount) {
+    if (ballCount != display->balls || !(display->shown & SHADOW_BALLS)) {
+        display->balls = ballCount;
+        display->dirty |= SHADOW_BALLS;
+    }
+}
+
+// starts a message scrolling on one row
+// the message is sent once, the Arduino keeps it moving without any more traffic
+// fixed text on the same row replaces it
+void display_Marquee(DisplayShadow* display, uint8_t row, uint8_t color, uint8_t stepMs, uint8_t flags, const char* message) {
+    uint8_t changed = display_CopyText(display->marquee, message, SHADOW_MARQUEE_MAX);
+    if (changed || row != display->marqueeRow || color != display->marqueeColor ||
+        stepMs != display->marqueeStepMs || flags != display->marqueeFlags ||
+        !(display->shown & SHADOW_MARQUEE)) {
+        display->marqueeRow = row;
+        display->marqueeColor = color;
+        display->marqueeStepMs = stepMs;
+        display->marqueeFlags = flags;
+        display->dirty |= SHADOW_MARQUEE;
+    }
+}
+
+// sets the best score of this lane, the leaderboard works out the best of
+// all the lanes from what each of them sent
+void display_LaneBest(DisplayShadow* display, int16_t number) {
+    if (number != display->laneBest || !(display->shown & SHADOW_LANE_BEST)) {
+        display->laneBest = number;
+        display->dirty |= SHADOW_LANE_BEST;
+    }
+}
+
+// plays an animation over the screen
+// it goes out after the other fields, so with ANIM_RETURN the Arduino
+// comes back to the screen as it is after this flush
+void display_Animation(DisplayShadow* display, uint8_t animation, uint8_t repeats, uint8_t flags) {
+    display->animation = animation;
+    display->animationRepeats = repeats;
+    display->animationFlags = flags;
+    display->dirty |= SHADOW_ANIMATION;
+}
+
+// order the fields are packed in, a clear goes first and the animation last
+const uint8_t displayOrder[] = {
+    SHADOW_CLEAR, SHADOW_TOP, SHADOW_BOTTOM, SHADOW_SCORE, SHADOW_BALLS, SHADOW_MARQUEE,
+    SHADOW_LANE_BEST, SHADOW_ANIMATION
+};
+
+// returns how many frame bytes one shadow field takes
+uint8_t display_Size(DisplayShadow* display, uint8_t field) {
+    switch (field) {
+        case SHADOW_TOP:
+            return 3 + strlen(display->top);
+        case SHADOW_BOTTOM:
+            return 3 + strlen(display->bottom);
+        case SHADOW_SCORE:
+            return 4;
+        case SHADOW_BALLS:
+            return 2;
+        case SHADOW_MARQUEE:
+            return 6 + strlen(display->marquee);
+        case SHADOW_LANE_BEST:
+            return 4;
+        case SHADOW_ANIMATION:
+            return 4;
+    }
+    return 1;   // SHADOW_CLEAR
+}
+
+// appends one shadow field to a frame that has room for it
+void display_Put(DisplayShadow* display, I2cFrame* frame, uint8_t field) {
+    switch (field) {
+        case SHADOW_CLEAR:
+            i2c_PutClear(frame);
+            break;
+        case SHADOW_TOP:
+            i2c_PutText(frame, 0x01, display->topColor, display->top);
+            break;
+        case SHADOW_BOTTOM:
+            i2c_PutText(frame, 0x02, display->bottomColor, display->bottom);
+            break;
+        case SHADOW_SCORE:
+            i2c_PutScore(frame, display->score, display->scoreColor);
+            break;
+        case SHADOW_BALLS:
+            i2c_PutBalls(frame, display->balls);
+            break;
+        case SHADOW_MARQUEE:
+            i2c_PutMarquee(frame, display->marqueeRow, display->marqueeColor,
+                           display->marqueeStepMs, display->marqueeFlags, display->marquee);
+            break;
+        case SHADOW_LANE_BEST:
+            i2c_PutLaneBest(frame, LANE_NUMBER, display->laneBest);
+            break;
+        case SHADOW_ANIMATION:
+            i2c_PutAnimation(frame, display->animation, display->animationRepeats, display->animationFlags);
+            break;
+    }
+}
+
+// Queues every dirty field of one display for its Arduino as batch frames.
+// The Arduino keeps every field in its own layer, so a field that overlaps
+// another on the matrix is sent on its own and the others stay as they are.
+// Fixed text on the marquee's row stops the marquee on the Arduino.
+// Fields that do not fit in one frame go out in the next one. If the
+// display's channel fills up the fields not queued yet stay dirty, so this is
+// meant to be called on every pass of the main loop.
+// Returns 1 if a frame was queued.
+uint8_t display_Flush(DisplayShadow* display) {
+    uint8_t send = display->dirty;
+    if ((send & SHADOW_TOP && display->marqueeRow == 0x01) ||
+        (send & SHADOW_BOTTOM && display->marqueeRow == 0x02)) {
+        send &= ~SHADOW_MARQUEE;
+        display->shown &= ~SHADOW_MARQUEE;
+        display->marquee[0] = '\0';
+    }
+    if (send == 0) {
+        return 0;
+    }
+
+    I2cFrame* frame = NULL;
+    uint8_t queued = 0;
+    for (uint8_t i = 0; i < sizeof(displayOrder); i++) {
+        uint8_t field = displayOrder[i];
+        if (!(send & field)) {
+            continue;
+        }
+        if (frame == NULL || frame->length + display_Size(display, field) > I2C_FRAME_MAX) {
+            // This frame is full, start the next one
+            if (frame != NULL) {
+                i2c_CommitFrame(display->channel);
+                queued = 1;
+            }
+            frame = i2c_BeginBatch(display->channel);
+            if (frame == NULL) {
+                display->dirty = send;   // The rest goes out on a later flush
+                return queued;
+            }
+        }
+        display_Put(display, frame, field);
+        send &= ~field;
+        display->shown |= field & ~(SHADOW_CLEAR | SHADOW_ANIMATION);
+    }
+    i2c_CommitFrame(display->channel);
+
+    display->dirty = 0;
+    return 1;
+}
+
+// Flushes every display. Each display has its own channel, and the starting
+// display moves on by one every call, so a display that keeps its channel
+// full never keeps the others from getting their fields queued.
+void display_FlushAll(void) {
+    uint8_t index = displayNext;
+    for (uint8_t i = 0; i < DISPLAY_COUNT; i++) {
+        display_Flush(&displays[index]);
+        index = (index + 1 < DISPLAY_COUNT) ? index + 1 : 0;
+    }
+    displayNext = (displayNext + 1 < DISPLAY_COUNT) ? displayNext + 1 : 0;
+}
+
+// Shows one message on every lane's scoreboard at once with a single
+// general call frame, e.g. to start a tournament. The leaderboard does not
+// take it. The lane's shadow is updated as if the message had been sent on
+// its own, so its next flush only sends what the game changes after it.
+// The other lanes' PICs do not know of the frame; one that had filled its
+// scoreboard's ring just then sees a frame dropped in the next status.
+// Returns 1 if the frame was queued.
+uint8_t display_Broadcast(uint8_t color, uint8_t stepMs, uint8_t flags, const char* message) {
+    I2cFrame* frame = i2c_BeginBatch(I2C_CHANNEL_BROADCAST);
+    if (frame == NULL) {
+        return 0;
+    }
+    i2c_PutClear(frame);
+    i2c_PutMarquee(frame, 0x01, color, stepMs, flags, message);
+    i2c_CommitFrame(I2C_CHANNEL_BROADCAST);
+
+    DisplayShadow* display = &displays[DISPLAY_LANE];
+    display_Clear(display);
+    display_Marquee(display, 0x01, color, stepMs, flags, message);
+    display->shown = SHADOW_MARQUEE;
+    display->dirty = 0;
+    return 1;
+}
@@ -0,0 +1,182 @@
+#include <stdint.h>
+#include <string.h>
+
+// Rules of the game, kept apart from the hardware.
+// Nothing in here touches a register or a global: the firmware hands in
+// the rules and a game, feeds it target hits with the time they happened,
+// the start button and a regular update, and reads the state, score and
+// balls back. What each state does with those is the coreStates table, so
+// the whole game runs the same on the PIC and on a PC (host/montecarlo.c).
+
+#define CORE_TARGETS 4
+
+#define STATE_NEW_GAME 0        // Define state for a new game initialization
+#define STATE_ACTIVE_GAME 1     // Define state for active gameplay
+#define STATE_END_GAME 2        // Define state for game over
+#define STATE_WIN_GAME 3        // Define state when the player wins the game
+#define STATE_REVERSE_GAME 4    // Define state for reverse play
+#define STATE_REVERSE_RESULT 5  // Define state showing how reverse play ended
+#define STATE_COUNT 6
+#define STATE_STAY 0xFF         // in coreStates, the input leaves the state as it is
+
+// what core_Hit, core_Start and core_Update report back
+#define CORE_SCORED 0x01        // a hit added or took back points
+#define CORE_NEW_STATE 0x02     // game->state changed, the firmware shows the new one
+
+typedef struct {
+    int16_t points[CORE_TARGETS];   // points per target, same order as the switch bits
+    uint16_t lockoutMs;             // a target only scores again after this long
+    int16_t winScore;               // score needed when the last ball is gone to win
+    int8_t ballsPerGame;
+} GameRules;
+
+// the rules the cabinet plays by
+const GameRules gameRules = {
+    {5, 10, 50, 100},   // RB7, RA0, RA1, RA4
+    1000,               // Lockout period in ms after scoring to prevent score spam
+    1000,
+    10
+};
+
+typedef struct {
+    uint8_t state;                              // STATE_, changed only by the core
+    int16_t score;
+    int8_t balls;                               // balls left to play
+    unsigned long lastScoreTime[CORE_TARGETS];  // when each target last scored
+} GameCore;
+
+// what a hit that passed the lockout does
+#define CORE_HIT_NONE 0         // nothing
+#define CORE_HIT_BALL 1         // adds the target's points and uses up a ball
+#define CORE_HIT_REVERSE 2      // takes the target's points back and returns a ball
+
+// what core_Update checks for
+#define CORE_CHECK_NONE 0
+#define CORE_CHECK_GAME_OVER 1  // the last ball is gone: won or lost
+#define CORE_CHECK_REVERSE 2    // reverse play has nothing left to take back
+
+typedef struct {
+    uint8_t hit;            // CORE_HIT_ action
+    uint8_t hitState;       // state after a hit that passed the lockout, or STATE_STAY
+    uint8_t startState;     // state after the start button, or STATE_STAY; a new
+                            // STATE_ACTIVE_GAME always starts with a fresh game
+    uint8_t check;          // CORE_CHECK_ run by core_Update
+} CoreState;
+
+const CoreState coreStates[STATE_COUNT] = {
+    //  hit               hitState            startState          check
+    { CORE_HIT_NONE,    STATE_STAY,         STATE_ACTIVE_GAME,  CORE_CHECK_NONE },      // STATE_NEW_GAME
+    { CORE_HIT_BALL,    STATE_STAY,         STATE_STAY,         CORE_CHECK_GAME_OVER }, // STATE_ACTIVE_GAME
+    { CORE_HIT_REVERSE, STATE_REVERSE_GAME, STATE_NEW_GAME,     CORE_CHECK_NONE },      // STATE_END_GAME
+    { CORE_HIT_REVERSE, STATE_REVERSE_GAME, STATE_NEW_GAME,     CORE_CHECK_NONE },      // STATE_WIN_GAME
+    { CORE_HIT_REVERSE, STATE_STAY,         STATE_STAY,         CORE_CHECK_REVERSE },   // STATE_REVERSE_GAME
+    { CORE_HIT_NONE,    STATE_STAY,         STATE_ACTIVE_GAME,  CORE_CHECK_NONE },      // STATE_REVERSE_RESULT
+};
+
+// starts a new game with a full set of balls
+void core_Reset(GameCore* game, const GameRules* rules) {
+    game->score = 0;
+    game->balls = rules->ballsPerGame;
+}
+
+// power up: waiting for a new game, no target locked out
+void core_Init(GameCore* game, const GameRules* rules) {
+    memset(game, 0, sizeof(*game));
+    game->state = STATE_NEW_GAME;
+    core_Reset(game, rules);
+}
+
+// returns 1 if the target may score a hit at hitTime, and starts its lockout
+uint8_t core_CanScore(GameCore* game, const GameRules* rules, uint8_t target, unsigned long hitTime) {
+    if (hitTime - game->lastScoreTime[target] > rules->lockoutMs) {
+        game->lastScoreTime[target] = hitTime;
+        return 1;
+    }
+    return 0;
+}
+
+// a ball went into a target: add its points and use up a ball
+// returns 1 if the hit counted
+uint8_t core_BallIn(GameCore* game, const GameRules* rules, uint8_t target) {
+    if (game->balls <= 0) {
+        return 0;
+    }
+    game->score += rules->points[target];
+    game->balls -= 1;
+    return 1;
+}
+
+// reverse play: a ball went into a target, take its points back and return a ball
+// returns 1 if the hit counted
+uint8_t core_BallInReverse(GameCore* game, const GameRules* rules, uint8_t target) {
+    if (game->balls >= rules->ballsPerGame) {
+        return 0;
+    }
+    game->score -= rules->points[target];
+    if (game->score < 0) {
+        game->score = 0;
+    }
+    game->balls += 1;
+    return 1;
+}
+
+// returns 1 once the last ball has been played
+uint8_t core_GameOver(const GameCore* game) {
+    return game->balls <= 0;
+}
+
+// returns 1 if the score is high enough to win
+uint8_t core_Won(const GameCore* game, const GameRules* rules) {
+    return game->score >= rules->winScore;
+}
+
+// returns 1 once reverse play has no points or no balls left to take back
+uint8_t core_ReverseOver(const GameCore* game, const GameRules* rules) {
+    return !(game->balls < rules->ballsPerGame && game->score > 0);
+}
+
+// moves to state, returns CORE_NEW_STATE if that is a change
+uint8_t core_Enter(GameCore* game, const GameRules* rules, uint8_t state) {
+    if (state == STATE_STAY) {
+        return 0;
+    }
+    if (state == STATE_ACTIVE_GAME) {
+        core_Reset(game, rules);
+    }
+    uint8_t changed = (state != game->state) ? CORE_NEW_STATE : 0;
+    game->state = state;
+    return changed;
+}
+
+// a target was hit at hitTime, in whatever state the game is in
+// returns CORE_ bits
+uint8_t core_Hit(GameCore* game, const GameRules* rules, uint8_t target, unsigned long hitTime) {
+    if (target >= CORE_TARGETS || !core_CanScore(game, rules, target, hitTime)) {
+        return 0;
+    }
+    const CoreState* state = &coreStates[game->state];
+    uint8_t events = 0;
+    if (state->hit == CORE_HIT_BALL) {
+        events = core_BallIn(game, rules, target) ? CORE_SCORED : 0;
+    } else if (state->hit == CORE_HIT_REVERSE) {
+        events = core_BallInReverse(game, rules, target) ? CORE_SCORED : 0;
+    }
+    return events | core_Enter(game, rules, state->hitState);
+}
+
+// the start button was pressed, returns CORE_ bits
+uint8_t core_Start(GameCore* game, const GameRules* rules) {
+    return core_Enter(game, rules, coreStates[game->state].startState);
+}
+
+// the state changes that do not come from an input, returns CORE_ bits
+uint8_t core_Update(GameCore* game, const GameRules* rules) {
+    uint8_t check = coreStates[game->state].check;
+    if (check == CORE_CHECK_GAME_OVER && core_GameOver(game)) {
+        return core_Enter(game, rules, core_Won(game, rules) ? STATE_WIN_GAME : STATE_END_GAME);
+    }
+    if (check == CORE_CHECK_REVERSE && core_ReverseOver(game, rules)) {
+        return core_Enter(game, rules, STATE_REVERSE_RESULT);
+    }
+    return 0;
+}
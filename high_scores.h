@@ -0,0 +1,173 @@
+#include <xc.h>
+#include <stdint.h>
+
+// Best scores kept in the data EEPROM across resets.
+// The 256 bytes hold a ring of 16 records of 16 bytes, every save goes to
+// the slot after the newest one so the cells wear evenly:
+//   [0-1]   sequence number, high byte first, one more than the record before
+//   [2-11]  the SCORE_TABLE_SIZE best scores, high byte first, best first
+//   [12-13] unused, 0xFF
+//   [14-15] CRC-16 of bytes 0-13, high byte first
+// The game works on the copy in RAM. A save only builds the new record
+// there, scores_Service() writes it one byte per call while nobody is
+// playing and only where the EEPROM differs. The scores go first, then the
+// sequence number, then the CRC. A reset in the middle of a save leaves a
+// record that fails its check, or still has the old sequence number and
+// loses to the newer records, or already holds all of the new scores.
+
+#define SCORE_TABLE_SIZE 5
+#define RECORD_SIZE 16
+#define RECORD_SLOTS 16
+#define RECORD_CRC (RECORD_SIZE - 2)
+#define SCORE_NO_RANK 0xFF
+
+typedef struct {
+    int16_t scores[SCORE_TABLE_SIZE];   // best first, 0 for an empty place
+    uint16_t sequence;                  // sequence number of the newest record
+    uint8_t slot;                       // slot of the newest record
+    uint8_t record[RECORD_SIZE];        // record being saved
+    uint8_t writeSlot;                  // slot it goes to
+    uint8_t writeIndex;                 // next byte to write, RECORD_SIZE when saved
+} HighScores;
+
+HighScores highScores;
+
+// order the bytes of a record are written in, see above
+const uint8_t recordOrder[RECORD_SIZE] = {2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 0, 1, 14, 15};
+uint8_t eepromWrites = 0;   // bytes written, wraps
+
+uint8_t eeprom_Read(uint8_t address) {
+    EEADRL = address;
+    EECON1bits.CFGS = 0;    // Data EEPROM, not configuration
+    EECON1bits.EEPGD = 0;
+    EECON1bits.RD = 1;
+    return EEDATL;
+}
+
+// Starts writing one byte, it takes ~4ms and runs on its own
+// EECON1bits.WR stays set until it is done
+void eeprom_Write(uint8_t address, uint8_t value) {
+    EEADRL = address;
+    EEDATL = value;
+    EECON1bits.CFGS = 0;
+    EECON1bits.EEPGD = 0;
+    EECON1bits.WREN = 1;
+    // The unlock sequence must not be interrupted, this is the only place
+    // interrupts are turned off and only for these few instructions
+    uint8_t interrupts = INTCONbits.GIE;
+    INTCONbits.GIE = 0;
+    EECON2 = 0x55;
+    EECON2 = 0xAA;
+    EECON1bits.WR = 1;
+    INTCONbits.GIE = interrupts;
+    EECON1bits.WREN = 0;
+    eepromWrites++;
+}
+
+// CRC-16, polynomial 0x1021 starting from 0xFFFF
+uint16_t scores_Crc(const uint8_t* data, uint8_t length) {
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// reads the record in a slot, returns 1 if it passes its check
+uint8_t scores_ReadRecord(uint8_t slot, uint8_t* record) {
+    uint8_t base = slot * RECORD_SIZE;
+    for (uint8_t i = 0; i < RECORD_SIZE; i++) {
+        record[i] = eeprom_Read(base + i);
+    }
+    uint16_t crc = ((uint16_t)record[RECORD_CRC] << 8) | record[RECORD_CRC + 1];
+    return scores_Crc(record, RECORD_CRC) == crc;
+}
+
+// Loads the newest valid record at power up, an empty table if there is none
+void scores_Load(void) {
+    uint8_t record[RECORD_SIZE];
+    uint8_t found = 0;
+    for (uint8_t slot = 0; slot < RECORD_SLOTS; slot++) {
+        if (!scores_ReadRecord(slot, record)) {
+            continue;
+        }
+        uint16_t sequence = ((uint16_t)record[0] << 8) | record[1];
+        if (found && (int16_t)(sequence - highScores.sequence) <= 0) {
+            continue;   // Older than the one found already, wraps safely
+        }
+        found = 1;
+        highScores.sequence = sequence;
+        highScores.slot = slot;
+        for (uint8_t i = 0; i < SCORE_TABLE_SIZE; i++) {
+            highScores.scores[i] = ((int16_t)record[2 + 2 * i] << 8) | record[3 + 2 * i];
+        }
+    }
+    if (!found) {
+        highScores.sequence = 0;
+        highScores.slot = RECORD_SLOTS - 1;     // The first save goes to slot 0
+        for (uint8_t i = 0; i < SCORE_TABLE_SIZE; i++) {
+            highScores.scores[i] = 0;
+        }
+    }
+    highScores.writeIndex = RECORD_SIZE;        // Nothing to save
+}
+
+// builds the record for the table in RAM and queues it for the next slot
+void scores_Save(void) {
+    uint8_t* record = highScores.record;
+    uint16_t sequence = highScores.sequence + 1;
+    record[0] = sequence >> 8;
+    record[1] = sequence;
+    for (uint8_t i = 0; i < SCORE_TABLE_SIZE; i++) {
+        record[2 + 2 * i] = (uint16_t)highScores.scores[i] >> 8;
+        record[3 + 2 * i] = highScores.scores[i];
+    }
+    for (uint8_t i = 2 + 2 * SCORE_TABLE_SIZE; i < RECORD_CRC; i++) {
+        record[i] = 0xFF;
+    }
+    uint16_t crc = scores_Crc(record, RECORD_CRC);
+    record[RECORD_CRC] = crc >> 8;
+    record[RECORD_CRC + 1] = crc;
+    highScores.writeSlot = (highScores.slot + 1) & (RECORD_SLOTS - 1);
+    highScores.writeIndex = 0;  // A save still going restarts, the newest record is untouched
+}
+
+// Puts a score into the table and queues a save if it made it
+// returns its place, 0 for the best, or SCORE_NO_RANK
+uint8_t scores_Insert(int16_t score) {
+    if (score <= highScores.scores[SCORE_TABLE_SIZE - 1]) {
+        return SCORE_NO_RANK;
+    }
+    uint8_t rank = SCORE_TABLE_SIZE - 1;
+    while (rank > 0 && score > highScores.scores[rank - 1]) {
+        highScores.scores[rank] = highScores.scores[rank - 1];
+        rank--;
+    }
+    highScores.scores[rank] = score;
+    scores_Save();
+    return rank;
+}
+
+// Writes the next byte of a queued save, call it only while nobody is playing
+// Bytes that already hold the right value are skipped without a write.
+void scores_Service(void) {
+    if (highScores.writeIndex >= RECORD_SIZE || EECON1bits.WR) {
+        return;     // Nothing to save, or the last byte is still being written
+    }
+    uint8_t base = highScores.writeSlot * RECORD_SIZE;
+    while (highScores.writeIndex < RECORD_SIZE) {
+        uint8_t index = recordOrder[highScores.writeIndex++];
+        if (eeprom_Read(base + index) != highScores.record[index]) {
+            eeprom_Write(base + index, highScores.record[index]);
+            break;
+        }
+    }
+    if (highScores.writeIndex == RECORD_SIZE) {
+        // The CRC went last, the record counts from now on
+        highScores.slot = highScores.writeSlot;
+        highScores.sequence = ((uint16_t)highScores.record[0] << 8) | highScores.record[1];
+    }
+}
@@ -0,0 +1,32 @@
+// Compiles animation sources (see anim_compiler.h) into the header of
+// frame records the sketch includes, written to stdout. Each animation is
+// named after its file: animations/win.txt becomes winAnimation[].
+//
+//   anim_compile animations/win.txt animations/drain.txt ... > ../animations.h
+
+#include "anim_compiler.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: anim_compile SOURCE...\n");
+        return 2;
+    }
+    printf("// Animations for scoreboard_LED.ino, the frame records described under\n");
+    printf("// \"Animations\" there. Made by host/anim_compile from host/animations/,\n");
+    printf("// edit those and run make -C host animations rather than editing this.\n");
+    size_t total = 0;
+    for (int i = 1; i < argc; i++) {
+        Animation animation;
+        std::string error;
+        animation.name = anim_Name(argv[i]);
+        if (!anim_Parse(argv[i], &animation, &error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        printf("\n");
+        anim_Write(stdout, animation);
+        total += animation.records.size();
+    }
+    fprintf(stderr, "%d animations, %zu bytes of flash\n", argc - 1, total);
+    return 0;
+}
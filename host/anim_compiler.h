@@ -0,0 +1,214 @@
+// Compiles animations from text into the sketch's frame records (see
+// "Animations" in scoreboard_LED.ino). A source file is a list of frames:
+//
+//   # a comment
+//   key 150          a keyframe held 150ms, drawn from black
+//   frame 80         a frame that only patches what changed since the last
+//   ........gggg....  then 8 lines of 32 palette letters, as the matrix dump
+//   ...                 writes them ('.' is 0, see arduinoCodes)
+//
+// Frames before the first keyframe patch a see-through overlay, so only
+// their lit pixels show over the screen under them. Each frame is stored
+// as spans of the leds that changed, in strip order, as runs: changed leds
+// close enough together that the leds between them take no more bytes
+// than a new span are sent as one span.
+
+#ifndef HOST_ANIM_COMPILER_H
+#define HOST_ANIM_COMPILER_H
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define ANIM_WIDTH 32
+#define ANIM_HEIGHT 8
+#define ANIM_LEDS (ANIM_WIDTH * ANIM_HEIGHT)
+#define ANIM_CODES ".GBRYPOWamknsdlg"
+
+#ifndef ANIM_TICK_MS                         // the sketch defines these too
+#define ANIM_TICK_MS 10
+#define ANIM_KEY 0x01
+#endif
+
+struct AnimFrame {
+    bool key;
+    int holdMs;
+    uint8_t pixels[ANIM_LEDS];               // palette indexes in strip order
+};
+
+struct Animation {
+    std::string name;
+    std::vector<AnimFrame> frames;
+    std::vector<uint8_t> records;            // compiled, the end marker included
+    std::vector<size_t> recordStarts;        // where each frame's record starts
+};
+
+static int anim_Led(int x, int y) {
+    return x * ANIM_HEIGHT + ((x & 1) ? (ANIM_HEIGHT - 1 - y) : y);
+}
+
+// runs of one color, at most 16 leds each, covering leds first to end
+static int anim_Runs(const uint8_t* pixels, int first, int end, std::vector<uint8_t>* out) {
+    int runs = 0;
+    for (int led = first; led < end; runs++) {
+        int run = 1;
+        while (run < 16 && led + run < end && pixels[led + run] == pixels[led]) {
+            run++;
+        }
+        if (out != NULL) {
+            out->push_back(((run - 1) << 4) | pixels[led]);
+        }
+        led += run;
+    }
+    return runs;
+}
+
+// one frame record: hold, flags, spans of what differs from base
+static void anim_Record(const AnimFrame& frame, const uint8_t* base, std::vector<uint8_t>* out) {
+    std::vector<std::pair<int, int> > spans;
+    int led = 0;
+    while (led < ANIM_LEDS) {
+        if (frame.pixels[led] == base[led]) {
+            led++;
+            continue;
+        }
+        int end = led + 1;
+        for (int next = end; next < ANIM_LEDS; next++) {
+            if (frame.pixels[next] == base[next]) {
+                continue;
+            }
+            // a new span costs its first led and run count, 2 bytes
+            if (anim_Runs(frame.pixels, end, next, NULL) > 2) {
+                break;
+            }
+            end = next + 1;
+        }
+        spans.push_back(std::make_pair(led, end));
+        led = end;
+    }
+    out->push_back(frame.holdMs / ANIM_TICK_MS);
+    out->push_back(frame.key ? ANIM_KEY : 0);
+    out->push_back(spans.size());
+    for (size_t i = 0; i < spans.size(); i++) {
+        std::vector<uint8_t> runs;
+        anim_Runs(frame.pixels, spans[i].first, spans[i].second, &runs);
+        out->push_back(spans[i].first);
+        out->push_back(runs.size());
+        out->insert(out->end(), runs.begin(), runs.end());
+    }
+}
+
+// compiles the frames into records, false if a frame cannot be stored
+static bool anim_Compile(Animation* animation, std::string* error) {
+    uint8_t base[ANIM_LEDS] = {0};
+    animation->records.clear();
+    animation->recordStarts.clear();
+    for (size_t i = 0; i < animation->frames.size(); i++) {
+        const AnimFrame& frame = animation->frames[i];
+        if (frame.holdMs <= 0 || frame.holdMs % ANIM_TICK_MS != 0 || frame.holdMs / ANIM_TICK_MS > 255) {
+            *error = "frame " + std::to_string(i + 1) + ": hold must be 10 to 2550ms, in steps of 10";
+            return false;
+        }
+        animation->recordStarts.push_back(animation->records.size());
+        uint8_t black[ANIM_LEDS] = {0};
+        anim_Record(frame, frame.key ? black : base, &animation->records);
+        memcpy(base, frame.pixels, ANIM_LEDS);
+    }
+    animation->records.push_back(0);
+    return true;
+}
+
+// reads a source file, false with the reason on a malformed one
+static bool anim_Parse(const char* path, Animation* animation, std::string* error) {
+    FILE* in = fopen(path, "r");
+    if (in == NULL) {
+        *error = std::string(path) + ": cannot open";
+        return false;
+    }
+    animation->frames.clear();
+    char line[128];
+    int lineNumber = 0;
+    int row = ANIM_HEIGHT;                   // matrix lines still expected for the last frame
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), in) != NULL) {
+        lineNumber++;
+        line[strcspn(line, "\r\n")] = '\0';
+        std::string where = std::string(path) + ":" + std::to_string(lineNumber) + ": ";
+        if (row < ANIM_HEIGHT) {
+            AnimFrame& frame = animation->frames.back();
+            if (strlen(line) != ANIM_WIDTH) {
+                *error = where + "a matrix line is 32 letters";
+                ok = false;
+                break;
+            }
+            for (int x = 0; x < ANIM_WIDTH && ok; x++) {
+                const char* code = strchr(ANIM_CODES, line[x]);
+                if (code == NULL) {
+                    *error = where + "unknown palette letter '" + line[x] + "'";
+                    ok = false;
+                } else {
+                    frame.pixels[anim_Led(x, row)] = code - ANIM_CODES;
+                }
+            }
+            row++;
+            continue;
+        }
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        AnimFrame frame;
+        char kind[16];
+        if (sscanf(line, "%15s %d", kind, &frame.holdMs) != 2 || (strcmp(kind, "key") && strcmp(kind, "frame"))) {
+            *error = where + "expected 'key <ms>' or 'frame <ms>'";
+            ok = false;
+            break;
+        }
+        frame.key = (strcmp(kind, "key") == 0);
+        animation->frames.push_back(frame);
+        row = 0;
+    }
+    fclose(in);
+    if (ok && row < ANIM_HEIGHT) {
+        *error = std::string(path) + ": the last frame is cut short";
+        ok = false;
+    }
+    if (ok && animation->frames.empty()) {
+        *error = std::string(path) + ": no frames";
+        ok = false;
+    }
+    return ok && anim_Compile(animation, error);
+}
+
+// the name of an animation from its source path: animations/win.txt is win
+static std::string anim_Name(const char* path) {
+    std::string name = path;
+    size_t slash = name.find_last_of('/');
+    if (slash != std::string::npos) {
+        name = name.substr(slash + 1);
+    }
+    return name.substr(0, name.find('.'));
+}
+
+// the records as a PROGMEM array, one frame a line and the end marker
+static void anim_Write(FILE* out, const Animation& animation) {
+    fprintf(out, "// %s: %zu frames, %zu bytes\n", animation.name.c_str(), animation.frames.size(),
+            animation.records.size());
+    fprintf(out, "const byte %sAnimation[] PROGMEM = {\n", animation.name.c_str());
+    std::vector<size_t> starts = animation.recordStarts;
+    starts.push_back(animation.records.size() - 1);
+    starts.push_back(animation.records.size());
+    for (size_t i = 0; i + 1 < starts.size(); i++) {
+        fprintf(out, "   ");
+        for (size_t b = starts[i]; b < starts[i + 1]; b++) {
+            if (b > starts[i] && (b - starts[i]) % 16 == 0) {
+                fprintf(out, "\n       ");
+            }
+            fprintf(out, " %u,", animation.records[b]);
+        }
+        fprintf(out, "\n");
+    }
+    fprintf(out, "};\n");
+}
+
+#endif
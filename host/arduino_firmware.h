@@ -0,0 +1,44 @@
+// The whole sketch on the host: scoreboard_LED.ino made into C++ by
+// ino2cpp.py, run on the virtual clock of arduino_host.h.
+// A test includes this once, after defining any trace hooks it wants.
+
+#include "scoreboard_LED.cpp"
+#include "arduino_host.h"
+
+// palette indexes as letters, '.' is 0, like the matrix dump
+const char arduinoCodes[] = ".GBRYPOWamknsdlg";
+
+// the matrix in leds[] as 8 lines of 32 letters
+void arduino_Matrix(char lines[HEIGHT][WIDTH + 1]) {
+    for (byte y = 0; y < HEIGHT; y++) {
+        for (byte x = 0; x < WIDTH; x++) {
+            lines[y][x] = arduinoCodes[getPixel(leds, pixelLed(x, y))];
+        }
+        lines[y][WIDTH] = '\0';
+    }
+}
+
+void arduino_PrintMatrix(FILE* out) {
+    char lines[HEIGHT][WIDTH + 1];
+    arduino_Matrix(lines);
+    for (byte y = 0; y < HEIGHT; y++) {
+        fprintf(out, "%s\n", lines[y]);
+    }
+}
+
+// sends a frame straight to the Wire interrupt, as if the master had just written it
+bool arduino_Send(const uint8_t* data, uint8_t length) {
+    bool acked = wire_Receive(SLAVE_ADDRESS, data, length);
+    wire_Stop();
+    return acked;
+}
+
+// runs until the strip has latched a frame after the current one, or ms pass
+bool arduino_RunUntilShown(uint32_t ms) {
+    unsigned long before = stripFrames;
+    uint64_t end = arduinoNanos + ms * 1000000ULL;
+    while (stripFrames == before && arduinoNanos < end) {
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    return stripFrames != before;
+}
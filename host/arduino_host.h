@@ -0,0 +1,170 @@
+// Virtual time and the peripherals behind host/shim for the Arduino side.
+// arduino_Run() runs passes of loop(), each taking ARDUINO_PASS_NS of the
+// virtual clock on top of the time the strip and Serial take. The master
+// is a callback, arduinoBus, that moves the bus on to the current time and
+// hands transactions to the Wire interrupt through wire_Receive() and
+// wire_Request(); it is called between passes and whenever the sketch
+// lets interrupts in, so a transaction waits while they are off. The
+// stop at the end of a write has its own interrupt, see wire_Stop().
+// Include after the sketch.
+
+#define ARDUINO_PASS_NS 50000ULL     // one pass of loop() besides the strip and Serial
+#define STRIP_BYTES (NUM_LEDS * 3)
+#define STRIP_BYTE_NS 10000ULL       // 8 bits of 1.25us
+#define STRIP_LATCH_NS 50000ULL      // line low this long latches the frame
+
+// The strip: bytes shift in until the line has been low for
+// STRIP_LATCH_NS, then the leds show them. A show cut short latches only
+// the leds it reached, the rest keep the last frame (a torn frame).
+uint8_t stripShift[STRIP_BYTES];     // clocked in since the last latch, GRB
+int stripCount = 0;
+uint64_t stripLastByte = 0;
+uint8_t stripFrame[STRIP_BYTES];     // what the leds show
+unsigned long stripFrames = 0;       // latches
+unsigned long stripTorn = 0;         // latches of less than the whole strip
+uint64_t stripLatchedAt = 0;
+void (*stripLatched)(void);          // called on every latch, may be NULL
+
+void strip_Latch(void) {
+    memcpy(stripFrame, stripShift, stripCount);
+    stripFrames++;
+    stripTorn += (stripCount < STRIP_BYTES);
+    stripCount = 0;
+    stripLatchedAt = stripLastByte + STRIP_LATCH_NS;
+    if (stripLatched != NULL) {
+        stripLatched();
+    }
+}
+
+// latches the strip if the line has been low long enough
+void strip_Check(void) {
+    if (stripCount > 0 && arduinoNanos - stripLastByte >= STRIP_LATCH_NS) {
+        strip_Latch();
+    }
+}
+
+// the host side of ws2812Byte() in the sketch
+void ws2812Byte(byte data, byte high, byte low) {
+    strip_Check();
+    if (stripCount < STRIP_BYTES) {
+        stripShift[stripCount++] = data;
+    }
+    arduinoNanos += STRIP_BYTE_NS;
+    stripLastByte = arduinoNanos;
+}
+
+uint8_t arduino_Tcnt0(void) {
+    return arduinoNanos / 4000;
+}
+
+void (*arduinoBus)(void);            // the master, may be NULL
+
+// The Wire interrupt for the stop after a write: the library copies the
+// frame out of the TWI buffer and receiveEvent() reads it byte by byte
+#define WIRE_STOP_NS 8000ULL
+#define WIRE_STOP_BYTE_NS 2000ULL
+
+// Runs the Wire interrupt for the stop of the last write, if it waits.
+// onReceive runs with interrupts off, like the TWI interrupt, and the
+// interrupt takes its time on the virtual clock.
+void wire_Stop(void) {
+    if (!(TWCR & _BV(TWINT)) || TW_STATUS != TW_SR_STOP) {
+        return;
+    }
+    uint8_t sreg = SREG;
+    cli();
+    arduinoNanos += WIRE_STOP_NS + Wire.rxLength * WIRE_STOP_BYTE_NS;
+    timer0_Update();
+    if (Wire.receive != NULL) {
+        Wire.receive(Wire.rxLength);
+    }
+    TWCR &= ~_BV(TWINT);
+    TWSR = 0xF8;                   // no state
+    SREG = sreg;
+}
+
+void arduino_Interrupts(void) {
+    if (SREG & _BV(SREG_I)) {
+        wire_Stop();
+        if (arduinoBus != NULL) {
+            arduinoBus();
+        }
+    }
+}
+
+// A write transaction from the master, returns false if nobody acked the
+// address; the general call is acked once the sketch sets TWGCE. The Wire library takes at most WIRE_BUFFER bytes, more are
+// nacked. The bytes are taken as they come, their interrupts are short and
+// not modelled; the stop's interrupt waits for wire_Stop(), the next time
+// the sketch lets interrupts in. A stop still waiting from the write
+// before runs first, the master having been held off until it did.
+bool wire_Receive(uint8_t address, const uint8_t* data, uint8_t length) {
+    wire_Stop();
+    bool general = (address == 0) && (TWAR & _BV(TWGCE));
+    if (address != Wire.address && !general) {
+        return false;
+    }
+    Wire.rxLength = (length < WIRE_BUFFER) ? length : WIRE_BUFFER;
+    Wire.rxIndex = 0;
+    memcpy(Wire.rx, data, Wire.rxLength);
+    TWCR |= _BV(TWINT);
+    TWSR = TW_SR_STOP;
+    return true;
+}
+
+// A read transaction, fills length bytes (0xFF past what onRequest wrote),
+// returns false if nobody acked the address
+bool wire_Request(uint8_t address, uint8_t* data, uint8_t length) {
+    wire_Stop();
+    if (address != Wire.address) {
+        return false;
+    }
+    Wire.txLength = 0;
+    uint8_t sreg = SREG;
+    cli();
+    if (Wire.request != NULL) {
+        Wire.request();
+    }
+    SREG = sreg;
+    for (uint8_t i = 0; i < length; i++) {
+        data[i] = (i < Wire.txLength) ? Wire.tx[i] : 0xFF;
+    }
+    return true;
+}
+
+// bytes typed into the Serial monitor
+void arduino_Type(const char* text) {
+    while (*text && Serial.inputTail < sizeof(Serial.input)) {
+        Serial.input[Serial.inputTail++] = *text++;
+    }
+}
+
+// Runs loop() for ns of virtual time
+void arduino_Run(uint64_t ns) {
+    uint64_t end = arduinoNanos + ns;
+    while (arduinoNanos < end) {
+        arduino_Interrupts();
+        wire_Stop();            // interrupts are on between passes, a write just made lands now
+        loop();
+        arduinoNanos += ARDUINO_PASS_NS;
+        strip_Check();
+    }
+}
+
+void arduino_RunMs(uint32_t ms) {
+    arduino_Run(ms * 1000000ULL);
+}
+
+// Power up and setup()
+void arduino_Boot(void) {
+    arduinoNanos = 0;
+    timer0Seen = timer0Missed = 0;
+    timer0Pending = false;
+    timer0_millis = timer0_overflow_count = 0;
+    TWCR = 0;
+    Serial.emptyAt = 0;            // the line is idle, whatever a run before left queued
+    stripCount = 0;
+    stripFrames = stripTorn = 0;
+    setup();
+    arduino_Run(STRIP_LATCH_NS);
+}
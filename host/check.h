@@ -0,0 +1,29 @@
+#include <stdio.h>
+
+// The checks every test makes: check() prints one line of the report and
+// counts it if it failed, checkQuietly() prints only a failure, for checks
+// made over and over in a loop, and main() ends with
+// return checkSummary() for the last line and the exit code.
+// Details a check line has no room for go to failures by hand.
+
+int failures = 0;
+
+void check(int ok, const char* what) {
+    printf("  %s %s\n", ok ? "ok  " : "FAIL", what);
+    failures += !ok;
+}
+
+void checkQuietly(int ok, const char* what) {
+    if (!ok) {
+        check(ok, what);
+    }
+}
+
+int checkSummary(void) {
+    if (failures > 0) {
+        printf("FAIL: %d checks\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Fuzzes the sketch's I2C command parser, processI2CData(), under ASan and
+// UBSan, which are the checks: any read past a frame, overflow or bad shift
+// stops the run. An input is a list of frames, each
+//   [0] length in the low 7 bits; with the top bit set the frame goes in
+//       through the Wire interrupt and a pass of loop(), as from the master,
+//       capped at WIRE_BUFFER; without it straight to processI2CData() in a
+//       buffer of exactly its length, so the sanitizer sees a byte too far
+//   then that many bytes, fewer if the input ends first
+// Every input starts from a cleared display, and the clock moves on a few
+// ms a frame so marquees and animations step over what the frames drew.
+//
+// Built with clang (make fuzz) this is a libFuzzer target. Built with gcc,
+// as for make test, main() below runs it over generated inputs, mostly
+// well formed commands with a length or a byte wrong, and over any input
+// files given, e.g. a crash libFuzzer saved:
+//
+//   fuzz_i2c                     RUNS generated inputs, seed 1
+//   fuzz_i2c --runs N --seed S
+//   fuzz_i2c FILE...             each file as one input
+
+#include "arduino_firmware.h"
+
+#define FUZZ_FRAME_WIRE 0x80
+#define FUZZ_FRAME_LENGTH 0x7F
+
+static bool fuzzBooted = false;
+static unsigned long fuzzFrames = 0;
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (!fuzzBooted) {
+        arduino_Boot();
+        fuzzBooted = true;
+    }
+    const byte clear = 0x05;
+    processI2CData(&clear, 1);
+    rxTail = rxHead;
+    size_t at = 0;
+    while (at < size) {
+        uint8_t header = data[at++];
+        size_t length = header & FUZZ_FRAME_LENGTH;
+        if (length > size - at) {
+            length = size - at;
+        }
+        if (header & FUZZ_FRAME_WIRE) {
+            wire_Receive(SLAVE_ADDRESS, data + at, length);
+            arduino_Run(ARDUINO_PASS_NS);
+        } else {
+            byte* frame = (byte*)malloc(length > 0 ? length : 1);
+            memcpy(frame, data + at, length);
+            processI2CData(frame, length);
+            free(frame);
+        }
+        at += length;
+        fuzzFrames++;
+        arduino_Run((1 + header % 4) * 1000000ULL);
+    }
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+#define FUZZ_RUNS 3000
+#define FUZZ_INPUT_MAX 4096
+
+// a command with the lengths it claims mostly right
+int fuzzCommand(uint8_t* out, int room) {
+    static const uint8_t commands[] = {0x01, 0x02, 0x03, 0x04, 0x05, 0x07, 0x08, 0x09,
+                                       0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x00, 0xFF};
+    int length = 1 + rand() % 12;
+    if (rand() % 4 == 0) {
+        length = rand() % 40;
+    }
+    if (length > room) {
+        length = room;
+    }
+    if (length == 0) {
+        return 0;
+    }
+    out[0] = commands[rand() % sizeof(commands)];
+    for (int i = 1; i < length; i++) {
+        out[i] = (rand() % 3 == 0) ? rand() : (rand() % 3 == 0) ? 0x20 + rand() % 64 : rand() % 10;
+    }
+    // text, and the counts that follow a command, said to be what is there
+    if ((out[0] == 0x01 || out[0] == 0x02) && length > 3 && rand() % 4 != 0) {
+        out[2] = length - 3;
+    }
+    if ((out[0] == 0x0D || out[0] == 0x07) && length > 2 && rand() % 4 != 0) {
+        out[1] = length - 2;
+    }
+    int size = commandLength(out, length);
+    if (size > 0 && rand() % 4 != 0) {
+        length = size;             // just the command, so a batch goes on to the next one
+    }
+    return length;
+}
+
+// frames of one command, a batch of a few, or bytes
+int fuzzInput(uint8_t* out) {
+    int size = 0;
+    int frames = 1 + rand() % 16;
+    for (int f = 0; f < frames && size < FUZZ_INPUT_MAX - 128; f++) {
+        uint8_t* frame = out + size + 1;
+        int length = 0;
+        int kind = rand() % 8;
+        if (kind < 4) {
+            length = fuzzCommand(frame, FUZZ_FRAME_LENGTH);
+        } else if (kind < 7) {
+            frame[length++] = 0x06;
+            int commands = 1 + rand() % 5;
+            for (int c = 0; c < commands; c++) {
+                length += fuzzCommand(frame + length, FUZZ_FRAME_LENGTH - length);
+            }
+        } else {
+            length = rand() % (FUZZ_FRAME_LENGTH + 1);
+            for (int i = 0; i < length; i++) {
+                frame[i] = rand();
+            }
+        }
+        out[size] = length | ((rand() % 2) ? FUZZ_FRAME_WIRE : 0);
+        size += 1 + length;
+    }
+    return size;
+}
+
+int fuzzFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "fuzz_i2c: cannot open %s\n", path);
+        return 1;
+    }
+    static uint8_t input[1 << 20];
+    size_t size = fread(input, 1, sizeof(input), file);
+    fclose(file);
+    LLVMFuzzerTestOneInput(input, size);
+    printf("  ok   %s, %zu bytes\n", path, size);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    long runs = FUZZ_RUNS;
+    unsigned seed = 1;
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = atoi(argv[++i]);
+        } else if (fuzzFile(argv[i]) != 0) {
+            return 1;
+        } else {
+            files++;
+        }
+    }
+    if (files > 0) {
+        printf("PASS\n");
+        return 0;
+    }
+    srand(seed);
+    static uint8_t input[FUZZ_INPUT_MAX];
+    unsigned long bytes = 0;
+    for (long run = 0; run < runs; run++) {
+        int size = fuzzInput(input);
+        LLVMFuzzerTestOneInput(input, size);
+        bytes += size;
+    }
+    printf("  ok   %ld inputs, %lu bytes, seed %u: %lu frames, %lu of them malformed\n", runs, bytes, seed,
+           fuzzFrames, (unsigned long)rxMalformed);
+    printf("PASS\n");
+    return 0;
+}
+#endif
@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+"""Turns a sketch into the C++ the Arduino IDE would compile.
+
+Like arduino-builder it includes Arduino.h and declares every function
+before the first definition, so the sketch can call functions it defines
+further down. #line directives keep errors pointing into the .ino.
+
+    ino2cpp.py scoreboard_LED.ino > scoreboard_LED.cpp
+"""
+import re
+import sys
+
+# a function definition at the start of a line: return type, name, arguments, {
+DEFINITION = re.compile(r'^((?:inline\s+)?[A-Za-z_][\w<>:]*\**\s+\**([A-Za-z_]\w*)\s*\(([^;{)]*)\))\s*\{', re.M)
+KEYWORDS = {'if', 'for', 'while', 'switch', 'return', 'else'}
+
+
+def prototypes(source):
+    found = []
+    for match in DEFINITION.finditer(source):
+        if match.group(2) in KEYWORDS or match.group(1).split()[0] in KEYWORDS:
+            continue
+        # default arguments belong on the prototype only once, drop them
+        found.append(re.sub(r'\s*=\s*[^,)]+', '', match.group(1)) + ';')
+    return found
+
+
+def main():
+    path = sys.argv[1]
+    source = open(path).read()
+    name = path.split('/')[-1]
+    first = DEFINITION.search(source)
+    line = source.count('\n', 0, first.start()) + 1
+    print('#include <Arduino.h>')
+    print('#line 1 "%s"' % name)
+    print(source[:first.start()], end='')
+    print('\n'.join(prototypes(source)))
+    print('#line %d "%s"' % (line, name))
+    print(source[first.start():], end='')
+
+
+if __name__ == '__main__':
+    main()
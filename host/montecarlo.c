@@ -0,0 +1,163 @@
+// Plays millions of games on the game core (montecarlo.h) over every core
+// of the machine, to tune the targets and the win score before a cabinet
+// is flashed. Reports per player model the win rate and how the scores
+// spread, with the games a second.
+//
+//   montecarlo                       every model, the cabinet's rules
+//   --games N                        games per model, 1000000
+//   --threads N                      the number of CPUs
+//   --seed S
+//   --model NAME                     one of the models in montecarlo.h
+//   --chance P5,P10,P50,P100         a model of your own, chance per target
+//   --throw MIN,MAX                  ms between throws of your model
+//   --rattle P                       chance a ball hits its switch twice
+//   --points A,B,C,D                 points per target
+//   --win N                          score to win
+//   --balls N                        balls a game
+//   --lockout MS
+//   --histogram                      scores in 20 bands, with a bar each
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "montecarlo.h"
+
+#define MC_GAMES 1000000
+#define MC_BANDS 20
+
+double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// reads count comma separated numbers, returns 0 if there are fewer
+int parseList(const char* text, double* values, int count) {
+    for (int i = 0; i < count; i++) {
+        char* end;
+        values[i] = strtod(text, &end);
+        if (end == text || (i < count - 1 && *end != ',')) {
+            return 0;
+        }
+        text = end + 1;
+    }
+    return 1;
+}
+
+void printHistogram(const McResult* result) {
+    int band = (result->scoreMax + MC_BANDS - 1) / MC_BANDS;   // the top score gets a band of its own
+    unsigned long most = 1;
+    unsigned long counts[MC_BANDS + 1] = {0};
+    for (int score = 0; score <= result->scoreMax; score++) {
+        counts[score / band] += result->scores[score];
+    }
+    for (int i = 0; i <= MC_BANDS; i++) {
+        most = (counts[i] > most) ? counts[i] : most;
+    }
+    for (int i = 0; i <= MC_BANDS && i * band <= result->scoreMax; i++) {
+        printf("    %5d-%-5d %6.2f%% ", i * band, i * band + band - 1, 100.0 * counts[i] / result->games);
+        for (unsigned long bar = 0; bar < counts[i] * 50 / most; bar++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+}
+
+void report(const McModel* model, const McResult* result, double took, int histogram) {
+    unsigned long finished = result->games - result->unfinished;
+    printf("%-8s %6.3f%% %6.1f %5d %5d %5d %5d %5.1f %6.2f %6.3f %6.2f\n", model->name,
+           100.0 * result->wins / result->games, finished ? (double)result->scoreSum / finished : 0.0,
+           mc_Percentile(result, 0.10), mc_Percentile(result, 0.50), mc_Percentile(result, 0.90),
+           mc_Percentile(result, 0.99), (double)result->throws / result->games,
+           (double)result->lockedOut / result->games, 100.0 * result->unfinished / result->games,
+           result->games / took / 1e6);
+    if (histogram) {
+        printHistogram(result);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint64_t games = MC_GAMES;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    uint64_t seed = 1;
+    int histogram = 0;
+    const char* only = NULL;
+    McModel custom = {"custom", {0.25, 0.25, 0.25, 0.25}, 1000, 2500, 0.10};
+    int useCustom = 0;
+    GameRules rules = gameRules;
+    for (int i = 1; i < argc; i++) {
+        double values[CORE_TARGETS];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : "";
+        int ok = 1;
+        if (!strcmp(argv[i], "--histogram")) {
+            histogram = 1;
+            continue;
+        } else if (!strcmp(argv[i], "--games")) {
+            games = strtoull(value, NULL, 10);
+        } else if (!strcmp(argv[i], "--threads")) {
+            threads = atoi(value);
+        } else if (!strcmp(argv[i], "--seed")) {
+            seed = strtoull(value, NULL, 10);
+        } else if (!strcmp(argv[i], "--model")) {
+            only = value;
+        } else if (!strcmp(argv[i], "--chance")) {
+            ok = parseList(value, custom.chance, CORE_TARGETS);
+            useCustom = 1;
+        } else if (!strcmp(argv[i], "--throw")) {
+            ok = parseList(value, values, 2) && values[0] >= 0 && values[0] <= values[1] && values[1] < 65536;
+            custom.throwMinMs = values[0];
+            custom.throwMaxMs = values[1];
+            useCustom = 1;
+        } else if (!strcmp(argv[i], "--rattle")) {
+            custom.rattle = atof(value);
+            useCustom = 1;
+        } else if (!strcmp(argv[i], "--points")) {
+            ok = parseList(value, values, CORE_TARGETS);
+            for (int t = 0; t < CORE_TARGETS; t++) {
+                rules.points[t] = values[t];
+            }
+        } else if (!strcmp(argv[i], "--win")) {
+            rules.winScore = atoi(value);
+        } else if (!strcmp(argv[i], "--balls")) {
+            rules.ballsPerGame = atoi(value);
+        } else if (!strcmp(argv[i], "--lockout")) {
+            rules.lockoutMs = atoi(value);
+        } else {
+            ok = 0;
+        }
+        if (!ok || i + 1 >= argc) {
+            fprintf(stderr, "montecarlo: bad option %s, see montecarlo.c\n", argv[i]);
+            return 2;
+        }
+        i++;
+    }
+    if (mc_ScoreMax(&rules) > 32767 || rules.ballsPerGame < 1) {
+        fprintf(stderr, "montecarlo: the score must fit in an int16_t and a game needs a ball\n");
+        return 2;
+    }
+
+    printf("points %d/%d/%d/%d, win at %d, %d balls, lockout %u ms; %llu games a model on %d threads, seed %llu\n",
+           rules.points[0], rules.points[1], rules.points[2], rules.points[3], rules.winScore,
+           rules.ballsPerGame, rules.lockoutMs, (unsigned long long)games, threads, (unsigned long long)seed);
+    printf("model       win    mean   p10   p50   p90   p99 throws locked unfin%% Mgames/s\n");
+    int played = 0;
+    for (unsigned m = 0; m <= MC_MODEL_COUNT; m++) {
+        const McModel* model = (m < MC_MODEL_COUNT) ? &mcModels[m] : &custom;
+        if ((m == MC_MODEL_COUNT) != useCustom || (only != NULL && strcmp(only, model->name) != 0)) {
+            continue;
+        }
+        McResult result;
+        mc_ResultInit(&result, &rules);
+        double start = seconds();
+        mc_Run(model, &rules, games, threads, seed, &result);
+        report(model, &result, seconds() - start, histogram);
+        mc_ResultFree(&result);
+        played++;
+    }
+    if (played == 0) {
+        fprintf(stderr, "montecarlo: no model called %s\n", only);
+        return 2;
+    }
+    return 0;
+}
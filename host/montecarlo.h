@@ -0,0 +1,216 @@
+// Games played on the game core (../game_core.h) with no hardware at all:
+// a player model throws balls at the targets and the core scores them as
+// the PIC does, lockout and all. Built without the shim, which is how the
+// core is kept free of registers.
+// Every game is numbered and draws its random numbers from its number and
+// the seed, so the results are the same whatever the number of threads.
+
+#ifndef HOST_MONTECARLO_H
+#define HOST_MONTECARLO_H
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "game_core.h"
+
+#define MC_THREADS_MAX 64
+#define MC_THROWS_MAX 1000          // a game still going after this many throws is given up
+#define MC_START_MS 60000UL         // the clock at the start of a game, past every lockout
+
+// How a player throws. A throw goes into target i with chance[i] and
+// misses with what is left, a miss comes back and is thrown again.
+typedef struct {
+    const char* name;
+    double chance[CORE_TARGETS];    // same order as the rules' points
+    uint16_t throwMinMs;            // time between throws, uniform between these
+    uint16_t throwMaxMs;
+    double rattle;                  // chance a ball hits its switch again 20-300 ms later
+} McModel;
+
+// players to tune against, from a first timer to a regular
+const McModel mcModels[] = {
+    //  name       5     10    50    100   throw ms     rattle
+    { "novice",  {0.40, 0.25, 0.10, 0.03}, 1500, 4000, 0.10 },
+    { "casual",  {0.30, 0.30, 0.20, 0.08}, 1200, 3000, 0.10 },
+    { "regular", {0.15, 0.25, 0.30, 0.20}, 1000, 2500, 0.10 },
+    { "expert",  {0.05, 0.10, 0.35, 0.45},  800, 2000, 0.10 },
+};
+#define MC_MODEL_COUNT (sizeof(mcModels) / sizeof(mcModels[0]))
+
+typedef struct {
+    unsigned long games;
+    unsigned long wins;
+    unsigned long unfinished;       // gave up after MC_THROWS_MAX throws
+    uint64_t throws;
+    uint64_t rattles;               // second hits of a rattling ball, all stopped by the lockout if it works
+    uint64_t lockedOut;             // hits the lockout stopped, rattles or not
+    uint64_t scoreSum;
+    int scoreMax;                   // highest score the rules allow, the size of scores - 1
+    unsigned long* scores;          // games ending on each score
+} McResult;
+
+// splitmix64, one state per game
+static uint64_t mc_Next(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static double mc_Uniform(uint64_t* state) {
+    return (mc_Next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t mc_Between(uint64_t* state, uint32_t low, uint32_t high) {
+    return low + (uint32_t)(mc_Uniform(state) * (high - low + 1));
+}
+
+// highest score a game can end on
+static int mc_ScoreMax(const GameRules* rules) {
+    int most = 0;
+    for (int i = 0; i < CORE_TARGETS; i++) {
+        if (rules->points[i] > most) {
+            most = rules->points[i];
+        }
+    }
+    return most * rules->ballsPerGame;
+}
+
+static void mc_ResultInit(McResult* result, const GameRules* rules) {
+    memset(result, 0, sizeof(*result));
+    result->scoreMax = mc_ScoreMax(rules);
+    result->scores = (unsigned long*)calloc(result->scoreMax + 1, sizeof(unsigned long));
+}
+
+static void mc_ResultFree(McResult* result) {
+    free(result->scores);
+    result->scores = NULL;
+}
+
+// adds from into to, both made by mc_ResultInit with the same rules
+static void mc_ResultAdd(McResult* to, const McResult* from) {
+    to->games += from->games;
+    to->wins += from->wins;
+    to->unfinished += from->unfinished;
+    to->throws += from->throws;
+    to->rattles += from->rattles;
+    to->lockedOut += from->lockedOut;
+    to->scoreSum += from->scoreSum;
+    for (int score = 0; score <= to->scoreMax; score++) {
+        to->scores[score] += from->scores[score];
+    }
+}
+
+// the target a throw goes into, or CORE_TARGETS for a miss
+static uint8_t mc_Throw(const McModel* model, uint64_t* random) {
+    double roll = mc_Uniform(random);
+    for (uint8_t target = 0; target < CORE_TARGETS; target++) {
+        if (roll < model->chance[target]) {
+            return target;
+        }
+        roll -= model->chance[target];
+    }
+    return CORE_TARGETS;
+}
+
+// a hit on the core at ms, counting the ones the lockout stopped
+static void mc_Hit(GameCore* game, const GameRules* rules, uint8_t target, unsigned long ms, McResult* result) {
+    if (ms - game->lastScoreTime[target] <= rules->lockoutMs) {
+        result->lockedOut++;
+    }
+    core_Hit(game, rules, target, ms);
+}
+
+// plays game number n from the start button to the end screen
+static void mc_PlayGame(const McModel* model, const GameRules* rules, uint64_t seed, uint64_t n,
+                        McResult* result) {
+    uint64_t random = seed ^ (n * 0xD1B54A32D192ED03ULL);
+    GameCore game;
+    unsigned long ms = MC_START_MS;
+    core_Init(&game, rules);
+    core_Start(&game, rules);
+    int throws = 0;
+    while (game.state == STATE_ACTIVE_GAME && throws < MC_THROWS_MAX) {
+        ms += mc_Between(&random, model->throwMinMs, model->throwMaxMs);
+        throws++;
+        uint8_t target = mc_Throw(model, &random);
+        if (target < CORE_TARGETS) {
+            mc_Hit(&game, rules, target, ms, result);
+            if (mc_Uniform(&random) < model->rattle) {
+                result->rattles++;
+                mc_Hit(&game, rules, target, ms + mc_Between(&random, 20, 300), result);
+            }
+        }
+        core_Update(&game, rules);
+    }
+    result->games++;
+    result->throws += throws;
+    if (game.state == STATE_ACTIVE_GAME) {
+        result->unfinished++;
+        return;
+    }
+    result->wins += (game.state == STATE_WIN_GAME);
+    result->scoreSum += game.score;
+    if (game.score >= 0 && game.score <= result->scoreMax) {
+        result->scores[game.score]++;
+    }
+}
+
+typedef struct {
+    const McModel* model;
+    const GameRules* rules;
+    uint64_t seed;
+    uint64_t first;                 // game numbers first to last - 1
+    uint64_t last;
+    McResult result;
+} McThread;
+
+static void* mc_ThreadMain(void* argument) {
+    McThread* thread = (McThread*)argument;
+    for (uint64_t n = thread->first; n < thread->last; n++) {
+        mc_PlayGame(thread->model, thread->rules, thread->seed, n, &thread->result);
+    }
+    return NULL;
+}
+
+// plays games 0 to games - 1 split over threads, into result (mc_ResultInit)
+static void mc_Run(const McModel* model, const GameRules* rules, uint64_t games, int threads, uint64_t seed,
+                   McResult* result) {
+    McThread work[MC_THREADS_MAX];
+    pthread_t ids[MC_THREADS_MAX];
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (threads > MC_THREADS_MAX) {
+        threads = MC_THREADS_MAX;
+    }
+    for (int i = 0; i < threads; i++) {
+        work[i].model = model;
+        work[i].rules = rules;
+        work[i].seed = seed;
+        work[i].first = games * i / threads;
+        work[i].last = games * (i + 1) / threads;
+        mc_ResultInit(&work[i].result, rules);
+        pthread_create(&ids[i], NULL, mc_ThreadMain, &work[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+        mc_ResultAdd(result, &work[i].result);
+        mc_ResultFree(&work[i].result);
+    }
+}
+
+// the score at or below which fraction of the finished games ended
+static int mc_Percentile(const McResult* result, double fraction) {
+    unsigned long finished = result->games - result->unfinished;
+    unsigned long want = (unsigned long)(fraction * finished);
+    unsigned long seen = 0;
+    for (int score = 0; score <= result->scoreMax; score++) {
+        seen += result->scores[score];
+        if (seen > want) {
+            return score;
+        }
+    }
+    return result->scoreMax;
+}
+
+#endif
@@ -0,0 +1,147 @@
+// MSSP1 in I2C master mode, on the virtual clock of pic_host.h.
+// The firmware drives it the way it drives the chip: setting SEN, PEN,
+// RCEN or ACKEN, or writing SSP1BUF, starts an operation, and when the bus
+// time for it has passed the model clears the bit, sets SSP1IF and, for a
+// byte sent, ACKSTAT from the slave. Slaves are callbacks, so a test can
+// make one busy, missing, or slow. A collision can be injected on the next
+// start condition, the module then sets BCL1IF instead and goes idle.
+// Include after pic_host.h and call mssp_Attach() once.
+
+// a bit at the clock SSP1ADD gives, Fosc/4 divided by SSP1ADD + 1
+#define MSSP_BIT_NS (4000000000ULL * (SSP1ADD + 1) / _XTAL_FREQ)
+
+#define MSSP_IDLE 0
+#define MSSP_START 1         // start condition, 1 bit time
+#define MSSP_BYTE 2          // byte and its ack, 9 bit times
+#define MSSP_RECEIVE 3       // byte from the slave, 8 bit times
+#define MSSP_ACK 4           // ack or nack to the slave, 1 bit time
+#define MSSP_STOP 5          // stop condition, 1 bit time
+
+// Slave callbacks, all optional. msspAck answers the address byte,
+// msspWrite gets a write transaction at its stop, msspRead fills the
+// bytes the master will clock in for a read.
+uint8_t (*msspAck)(uint8_t address);                                   // 1 acks, 0 nacks
+void (*msspWrite)(uint8_t address, const uint8_t* data, uint8_t length);
+void (*msspRead)(uint8_t address, uint8_t* data, uint8_t length);
+
+uint8_t msspOperation = MSSP_IDLE;
+uint64_t msspDone;                   // when the operation in progress ends
+uint8_t msspCollisions = 0;          // start conditions still to lose arbitration
+uint8_t msspFirst;                   // next byte is the address byte
+uint8_t msspAddress;                 // 7 bit address of the transaction
+uint8_t msspReadMode;
+uint8_t msspAcked;                   // the slave acked the address
+uint8_t msspData[256];               // payload of a write, or the bytes of a read
+uint8_t msspLength;
+uint8_t msspReadIndex;
+uint8_t msspHolding;                 // SSP1BUF holds a byte from the slave
+
+// counters a test can check
+uint64_t msspBusyNs = 0;             // time the bus was not idle
+unsigned long msspStarts = 0;
+unsigned long msspWrites = 0;        // write transactions completed with a stop
+unsigned long msspReads = 0;         // read transactions completed with a stop
+unsigned long msspBytes = 0;         // bytes clocked, address bytes included
+
+void mssp_Begin(uint8_t operation, uint8_t bits) {
+    msspOperation = operation;
+    msspDone = picNanos + bits * MSSP_BIT_NS;
+    msspBusyNs += bits * MSSP_BIT_NS;
+}
+
+// looks for an operation the firmware asked for since the last event
+void mssp_Poll(void) {
+    if (msspOperation != MSSP_IDLE) {
+        return;
+    }
+    if (SSP1CON2bits.SEN) {
+        mssp_Begin(MSSP_START, 1);
+    } else if (SSP1CON2bits.PEN) {
+        mssp_Begin(MSSP_STOP, 1);
+    } else if (SSP1CON2bits.RCEN) {
+        mssp_Begin(MSSP_RECEIVE, 8);
+    } else if (SSP1CON2bits.ACKEN) {
+        msspHolding = 0;
+        SSP1BUF = PIC_SSPBUF_EMPTY;
+        mssp_Begin(MSSP_ACK, 1);
+    } else if (!msspHolding && SSP1BUF != PIC_SSPBUF_EMPTY) {
+        mssp_Begin(MSSP_BYTE, 9);
+    }
+}
+
+uint64_t mssp_NextEvent(void) {
+    mssp_Poll();
+    return msspOperation == MSSP_IDLE ? UINT64_MAX : msspDone;
+}
+
+// finishes the operation that is due and raises the interrupt
+void mssp_Event(void) {
+    uint8_t operation = msspOperation;
+    msspOperation = MSSP_IDLE;
+    switch (operation) {
+        case MSSP_START:
+            SSP1CON2bits.SEN = 0;
+            if (msspCollisions > 0) {
+                msspCollisions--;
+                PIR2bits.BCL1IF = 1;
+                return;
+            }
+            msspStarts++;
+            msspFirst = 1;
+            msspLength = 0;
+            break;
+        case MSSP_BYTE: {
+            uint8_t byte = SSP1BUF;
+            SSP1BUF = PIC_SSPBUF_EMPTY;
+            msspBytes++;
+            if (msspFirst) {
+                msspFirst = 0;
+                msspAddress = byte >> 1;
+                msspReadMode = byte & 1;
+                msspAcked = (msspAck == NULL) || msspAck(msspAddress);
+                if (msspReadMode && msspAcked) {
+                    memset(msspData, 0xFF, sizeof(msspData));
+                    if (msspRead != NULL) {
+                        msspRead(msspAddress, msspData, sizeof(msspData) - 1);
+                    }
+                    msspReadIndex = 0;
+                }
+                SSP1CON2bits.ACKSTAT = !msspAcked;
+            } else {
+                msspData[msspLength++] = byte;
+                SSP1CON2bits.ACKSTAT = 0;
+            }
+            break;
+        }
+        case MSSP_RECEIVE:
+            SSP1CON2bits.RCEN = 0;
+            msspBytes++;
+            SSP1BUF = msspData[msspReadIndex++];
+            msspHolding = 1;
+            break;
+        case MSSP_ACK:
+            SSP1CON2bits.ACKEN = 0;
+            break;
+        case MSSP_STOP:
+            SSP1CON2bits.PEN = 0;
+            if (msspAcked && !msspReadMode) {
+                msspWrites++;
+                if (msspWrite != NULL) {
+                    msspWrite(msspAddress, msspData, msspLength);
+                }
+            } else if (msspAcked) {
+                msspReads++;
+            }
+            msspAcked = 0;
+            break;
+    }
+    PIR1bits.SSP1IF = 1;
+}
+
+void mssp_Attach(void) {
+    msspOperation = MSSP_IDLE;
+    msspHolding = 0;
+    SSP1BUF = PIC_SSPBUF_EMPTY;
+    picNextEvent = mssp_NextEvent;
+    picEvent = mssp_Event;
+}
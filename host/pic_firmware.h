@@ -0,0 +1,41 @@
+// The whole PIC firmware on the host: pic_scoreboard.c with its main()
+// renamed, started and run on the virtual clock of pic_host.h.
+// A test includes this once, after defining any trace hooks it wants.
+
+#define main pic_main
+#include "../pic_scoreboard.c"
+#undef main
+#include "pic_host.h"
+
+// one pass of the firmware's main loop, see main()
+void pic_MainPass(void) {
+    scheduler_Run(tasks, TASK_COUNT);
+    loopCount++;
+}
+
+// everything main() does before its loop
+void pic_Boot(void) {
+    pic_PowerUp();
+    PORTCbits.RC7 = 1;      // Start button released, it pulls low
+    initialSetup();
+    setupSwitches();
+    core_Init(&game, &gameRules);
+    newGameEnter();
+    picMainPass = pic_MainPass;
+}
+
+// holds the switches in events (EVENT_ bits) closed or open
+void pic_Switches(uint8_t events, uint8_t closed) {
+    if (events & EVENT_RB7) PORTBbits.RB7 = closed;
+    if (events & EVENT_RA0) PORTAbits.RA0 = closed;
+    if (events & EVENT_RA1) PORTAbits.RA1 = closed;
+    if (events & EVENT_RA4) PORTAbits.RA4 = closed;
+    if (events & EVENT_START) PORTCbits.RC7 = !closed;
+}
+
+// closes the switches for ms, long enough for the debouncer, then opens them
+void pic_Press(uint8_t events, uint32_t ms) {
+    pic_Switches(events, 1);
+    pic_RunMs(ms);
+    pic_Switches(events, 0);
+}
@@ -0,0 +1,164 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Virtual time and the peripheral models behind host/shim/xc.h.
+// Nothing runs on its own: pic_Run() moves the clock from one event to the
+// next (the 1ms Timer0 overflow, an EEPROM write finishing), raises the
+// interrupt flags, calls the firmware's isr() the way the chip would, and
+// then runs one pass of the main loop. The firmware itself takes no time,
+// so every delay measured here comes from the timers and the peripherals.
+
+#define PIC_MS 1000000ULL                 // ns per ms
+#define PIC_EEPROM_SIZE 256
+#define PIC_EEPROM_WRITE_NS (4 * PIC_MS)  // one data EEPROM byte write
+
+uint64_t picNanos = 0;          // virtual time since power up, in ns
+uint64_t picNextTick = PIC_MS;  // when Timer0 overflows next
+void (*picMainPass)(void);      // one pass of the firmware's main loop, may be NULL
+void isr();                     // the firmware's interrupt routine
+
+// Timer1 counts at 1MHz (Fosc/4 with a 1:8 prescale) from power up
+volatile uint8_t picTimer1[2];
+
+volatile uint8_t* pic_Timer1(uint8_t high) {
+    uint16_t count = picNanos / 1000;
+    picTimer1[0] = count;
+    picTimer1[1] = count >> 8;
+    return &picTimer1[high];
+}
+
+// Data EEPROM, erased to 0xFF. A read lands in EEDATL as soon as RD is set,
+// a write starts when the harness sees WR set after the unlock sequence and
+// takes PIC_EEPROM_WRITE_NS like the real cell.
+uint8_t picEeprom[PIC_EEPROM_SIZE];
+volatile uint8_t picEedat;
+uint64_t picEepromDone = 0;       // when the write in progress ends, 0 if none
+uint8_t picEepromAddress;
+uint8_t picEepromValue;
+unsigned long picEepromWrites = 0;  // bytes written since power up
+unsigned long picEepromReads = 0;   // bytes read since power up
+unsigned long picEepromWear[PIC_EEPROM_SIZE];   // writes to each cell since it was erased
+
+volatile uint8_t* pic_EepromData(void) {
+    if (EECON1bits.RD) {
+        EECON1bits.RD = 0;
+        picEepromReads++;
+        picEedat = picEeprom[EEADRL];
+    }
+    return &picEedat;
+}
+
+// starts a write the firmware has just asked for
+void pic_EepromStart(void) {
+    if (!EECON1bits.WR || picEepromDone != 0) {
+        return;
+    }
+    if (EECON2 != 0xAA) {
+        EECON1bits.WR = 0;      // No unlock sequence, the chip ignores WR
+        return;
+    }
+    EECON2 = 0;
+    picEepromAddress = EEADRL;
+    picEepromValue = picEedat;
+    picEepromDone = picNanos + PIC_EEPROM_WRITE_NS;
+}
+
+void pic_EepromFinish(void) {
+    picEeprom[picEepromAddress] = picEepromValue;
+    picEepromWrites++;
+    picEepromWear[picEepromAddress]++;
+    picEepromDone = 0;
+    EECON1bits.WR = 0;
+    PIR2bits.EEIF = 1;
+}
+
+// Power loss: a byte being written is left holding anything
+void pic_EepromPowerLoss(void) {
+    if (picEepromDone != 0) {
+        picEeprom[picEepromAddress] = rand();
+        picEepromDone = 0;
+    }
+    EECON1bits.WR = 0;
+}
+
+// Calls isr() until no enabled interrupt is pending, like the chip does
+// once GIE is set. A flag the handler never clears is a firmware bug.
+void pic_Interrupt(void) {
+    for (uint8_t guard = 0; guard < 16; guard++) {
+        if (!INTCONbits.GIE) {
+            return;
+        }
+        uint8_t pending = (INTCONbits.TMR0IF && INTCONbits.TMR0IE);
+        if (INTCONbits.PEIE) {
+            pending |= (PIR1bits.SSP1IF && PIE1bits.SSP1IE);
+            pending |= (PIR2bits.BCL1IF && PIE2bits.BCL1IE);
+        }
+        if (!pending) {
+            return;
+        }
+        isr();
+    }
+    abort();
+}
+
+// Optional extra event source, see the MSSP model
+uint64_t (*picNextEvent)(void);     // time of its next event, UINT64_MAX if none
+void (*picEvent)(void);             // handles the event that is due now
+
+// Runs the firmware for ns of virtual time
+void pic_Run(uint64_t ns) {
+    uint64_t end = picNanos + ns;
+    for (;;) {
+        uint64_t next = picNextTick;
+        if (picEepromDone != 0 && picEepromDone < next) {
+            next = picEepromDone;
+        }
+        if (picNextEvent != NULL && picNextEvent() < next) {
+            next = picNextEvent();
+        }
+        if (next > end) {
+            picNanos = end;
+            return;
+        }
+        picNanos = next;
+        if (picNanos == picNextTick) {
+            picNextTick += PIC_MS;
+            INTCONbits.TMR0IF = 1;
+        }
+        if (picEepromDone == picNanos) {
+            pic_EepromFinish();
+        }
+        if (picNextEvent != NULL && picNextEvent() == picNanos) {
+            picEvent();
+        }
+        pic_Interrupt();
+        if (picMainPass != NULL) {
+            picMainPass();
+        }
+        pic_EepromStart();
+    }
+}
+
+void pic_RunMs(uint32_t ms) {
+    pic_Run(ms * PIC_MS);
+}
+
+// Power up: every register as after a reset, the EEPROM erased
+void pic_PowerUp(void) {
+    picNanos = 0;
+    picNextTick = PIC_MS;
+    picEepromDone = 0;
+    picEepromWrites = picEepromReads = 0;
+    memset(picEeprom, 0xFF, sizeof(picEeprom));
+    memset(picEepromWear, 0, sizeof(picEepromWear));
+}
+
+// Power lost and back: the clock starts over, the EEPROM keeps what it
+// held but for a byte being written, see pic_EepromPowerLoss()
+void pic_PowerCycle(void) {
+    pic_EepromPowerLoss();
+    picNanos = 0;
+    picNextTick = PIC_MS;
+    picEepromWrites = picEepromReads = 0;
+}
@@ -0,0 +1,156 @@
+// The renderer scoreboard_LED.ino started from, kept as the reference the
+// host tests compare the current sketch against: the per character int
+// pixel lists, the 16 int position maps, the ball leds, and the drawing
+// functions that used them, writing CRGB into refLeds[] as FastLED did.
+// Only the drawing is kept; the I2C handling around it is not.
+
+#define REF_LEDS 256
+#define REF_MAP_SIZE 15
+
+CRGB refLeds[REF_LEDS];
+
+// The top characters are mapped left adj
+const int refTop[8][REF_MAP_SIZE] = {
+    {0, 1, 2, 3, 4, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20},
+    {32, 33, 34, 35, 36, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52},
+    {64, 65, 66, 67, 68, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84},
+    {96, 97, 98, 99, 100, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116},
+    {128, 129, 130, 131, 132, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148},
+    {160, 161, 162, 163, 164, 171, 172, 173, 174, 175, 176, 177, 178, 179, 180},
+    {192, 193, 194, 195, 196, 203, 204, 205, 206, 207, 208, 209, 210, 211, 212},
+    {224, 225, 226, 227, 228, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244},
+};
+
+// the bottom characters are mapped righ adj
+const int refBottom[8][REF_MAP_SIZE] = {
+    {12, 11, 10, 9, 8, 23, 22, 21, 20, 19, 28, 27, 26, 25, 24},
+    {44, 43, 42, 41, 40, 55, 54, 53, 52, 51, 60, 59, 58, 57, 56},
+    {76, 75, 74, 73, 72, 87, 86, 85, 84, 83, 92, 91, 90, 89, 88},
+    {108, 107, 106, 105, 104, 119, 118, 117, 116, 115, 124, 123, 122, 121, 120},
+    {140, 139, 138, 137, 136, 151, 150, 149, 148, 147, 156, 155, 154, 153, 152},
+    {172, 171, 170, 169, 168, 183, 182, 181, 180, 179, 188, 187, 186, 185, 184},
+    {204, 203, 202, 201, 200, 215, 214, 213, 212, 211, 220, 219, 218, 217, 216},
+    {236, 235, 234, 233, 232, 247, 246, 245, 244, 243, 252, 251, 250, 249, 248},
+};
+
+const int refBallLeds[10] = {9, 25, 41, 57, 73, 89, 105, 121, 137, 153};
+
+// one pixel list per character, -1 ends it
+struct RefGlyph {
+    char character;
+    int pixels[16];
+};
+
+// '?' was declared with a count of 9 but lists 7 pixels, so the old code
+// read two words past the end of its table; only the 7 are kept here
+const RefGlyph refFont[] = {
+    {'A', {0,1,2,3,4,7,9,10,11,12,13,14, -1}},
+    {'B', {0,1,2,3,4,5,7,9,10,11,13,14, -1}},
+    {'C', {0,1,2,3,4,5,9,10,14, -1}},
+    {'D', {0,1,2,3,4,5,9,11,12,13, -1}},
+    {'E', {0,1,2,3,4,5,7,9,10,12,14, -1}},
+    {'F', {0,1,2,3,4,7,9,10,12, -1}},
+    {'G', {0,1,2,3,4,5,9,10,12,13,14, -1}},
+    {'H', {0,1,2,3,4,7,10,11,12,13,14, -1}},
+    {'I', {0,4,5,6,7,8,9,10,14, -1}},
+    {'J', {3,4,5,10,11,12,13,14, -1}},
+    {'K', {0,1,2,3,4,7,10,11,13,14, -1}},
+    {'L', {0,1,2,3,4,5,14, -1}},
+    {'M', {0,1,2,3,4,7,8,10,11,12,13,14, -1}},
+    {'N', {0,1,2,3,4,9,11,12,13,14, -1}},
+    {'O', {0,1,2,3,4,5,9,10,11,12,13,14, -1}},
+    {'P', {0,1,2,3,4,7,9,10,11,12, -1}},
+    {'Q', {0,1,2,3,6,9,10,11,12,13,14, -1}},
+    {'R', {0,1,2,3,4,7,9,10,11,13,14, -1}},
+    {'S', {0,1,2,4,5,7,9,10,12,13,14, -1}},
+    {'T', {0,5,6,7,8,9,10, -1}},
+    {'U', {0,1,2,3,4,5,10,11,12,13,14, -1}},
+    {'V', {0,1,2,3,5,10,11,12,13, -1}},
+    {'W', {0,1,2,3,4,6,7,10,11,12,13,14, -1}},
+    {'X', {0,1,3,4,7,10,11,13,14, -1}},
+    {'Y', {0,1,2,5,6,7,10,11,12, -1}},
+    {'Z', {0,3,4,5,7,9,10,11,14, -1}},
+    {'0', {0,1,2,3,4,5,9,10,11,12,13,14, -1}},
+    {'1', {0,4,5,6,7,8,9,14, -1}},
+    {'2', {0,2,3,4,5,7,9,10,11,12,14, -1}},
+    {'3', {0,4,5,7,9,10,11,12,13,14, -1}},
+    {'4', {0,1,2,7,10,11,12,13,14, -1}},
+    {'5', {0,1,2,4,5,7,9,10,12,13,14, -1}},
+    {'6', {0,1,2,3,4,5,7,9,10,12,13,14, -1}},
+    {'7', {0,5,6,7,9,10,11, -1}},
+    {'8', {0,1,2,3,4,5,7,9,10,11,12,13,14, -1}},
+    {'9', {0,1,2,7,9,10,11,12,13,14, -1}},
+    {'?', {0,5,7,9,10,11,12, -1}},
+};
+
+// Function to assign a cgrb color to integers 0-9
+CRGB ref_ColorSelect(int color) {
+    switch (color) {
+        case 1: return CRGB::Green;
+        case 2: return CRGB::Blue;
+        case 3: return CRGB::Red;
+        case 4: return CRGB::Yellow;
+        case 5: return CRGB::Purple;
+        case 6: return CRGB::Orange;
+        case 7: return CRGB::White;
+        default: return CRGB::Black;
+    }
+}
+
+void ref_ClearMapping(const int* mapping) {
+    for (int i = 0; i < REF_MAP_SIZE; i++) {
+        refLeds[mapping[i]] = CRGB::Black;
+    }
+}
+
+// displayCharacterFromChar() as it was: a space erases the position, '_'
+// leaves it, anything else erases it and lights its pixels
+void ref_Character(char character, const int* mapping, CRGB color) {
+    if (character == '_') {
+        return;
+    }
+    ref_ClearMapping(mapping);
+    for (const RefGlyph& glyph : refFont) {
+        if (glyph.character == character) {
+            for (int i = 0; glyph.pixels[i] >= 0; i++) {
+                refLeds[mapping[glyph.pixels[i]]] = color;
+            }
+        }
+    }
+}
+
+// a text command on one row, 0x01 top or 0x02 bottom
+void ref_Text(char command, int color, const char* text) {
+    for (int i = 0; i < 8 && text[i]; i++) {
+        ref_Character(text[i], command == 0x01 ? refTop[i] : refBottom[i], ref_ColorSelect(color));
+    }
+}
+
+// displayNumber() as it was: %d into 5 chars, so at most 4 digits, right
+// aligned on the bottom row in red, and only positions 5-7 cleared first
+void ref_Number(int number) {
+    char numStr[5];
+    snprintf(numStr, sizeof(numStr), "%d", number);
+    for (int i = 5; i < 8; i++) {
+        ref_ClearMapping(refBottom[i]);
+    }
+    int len = strlen(numStr);
+    for (int i = 0; i < len; i++) {
+        ref_Character(numStr[i], refBottom[7 - (len - 1 - i)], CRGB::Red);
+    }
+}
+
+void ref_Balls(int count) {
+    for (int i = 0; i < 10; i++) {
+        refLeds[refBallLeds[i]] = CRGB::Black;
+    }
+    for (int i = 0; i < count && i < 10; i++) {
+        refLeds[refBallLeds[i]] = CRGB::Orange;
+    }
+}
+
+void ref_Clear() {
+    for (int i = 0; i < REF_LEDS; i++) {
+        refLeds[i] = CRGB::Black;
+    }
+}
@@ -0,0 +1,71 @@
+// Replays traces recorded by the sim (sim --trace FILE) into the sketch,
+// see replay.h.
+//
+//   replay TRACE                 checks leds[] after every write against the
+//                                trace's checks, exits 1 on any mismatch
+//   replay --bless OUT TRACE     writes the trace to OUT with the checks of
+//                                this build
+//
+// Reports the games, writes and checks, and how fast it went.
+
+#include "arduino_firmware.h"
+#include "replay.h"
+#include <time.h>
+
+double seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv) {
+    const char* blessPath = NULL;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--bless") && i + 1 < argc) {
+            blessPath = argv[++i];
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "usage: %s [--bless OUT] TRACE\n", argv[0]);
+        return 2;
+    }
+
+    Trace in, bless;
+    if (!trace_Open(&in, path)) {
+        fprintf(stderr, "%s: not a trace\n", path);
+        return 1;
+    }
+    if (blessPath != NULL && !trace_Create(&bless, blessPath)) {
+        fprintf(stderr, "%s: cannot create\n", blessPath);
+        return 1;
+    }
+    ReplayStats stats;
+    double start = seconds();
+    replay_Trace(&in, blessPath ? &bless : NULL, &stats, stdout);
+    double took = seconds() - start;
+    fclose(in.file);
+    if (blessPath != NULL) {
+        trace_Close(&bless);
+    }
+
+    printf("%s: %lu games, %lu writes, %lu switch changes, %.0f s of play\n", path, stats.games, stats.writes,
+           stats.switches, stats.us / 1e6);
+    printf("replayed in %.3f s, %lu passes of loop(): %.0f games/s, %.0fx real time\n", took, stats.passes,
+           stats.games / took, stats.us / 1e6 / took);
+    if (blessPath != NULL) {
+        printf("blessed: %lu checks written to %s\n", stats.writes, blessPath);
+        return 0;
+    }
+    printf("%lu checks, %lu mismatches\n", stats.checks, stats.mismatches);
+    if (stats.checks == 0) {
+        printf("no checks in the trace, bless it first\n");
+        return 1;
+    }
+    return stats.mismatches > 0;
+}
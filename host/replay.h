@@ -0,0 +1,135 @@
+// Plays a trace (trace.h) into the sketch and checks leds[] after every
+// write against the trace's TRACE_CHECK records. Include after
+// arduino_firmware.h.
+// Only the writes drive the sketch, so time is not run pass by pass as in
+// arduino_Run(): the clock jumps to each write, which is received and
+// processed in one pass of loop(). While a marquee scrolls or an animation
+// plays, loop() also runs at each ms one of them is due to move, which is
+// where a pass every ms would have moved it too, millis() being what they
+// step on. A game of a few minutes replays in well under a millisecond.
+// The checks are what replay --bless recorded from a build known to be
+// good, so a replay compares builds frame by frame, not against the
+// capture.
+
+#ifndef HOST_REPLAY_H
+#define HOST_REPLAY_H
+#include "trace.h"
+
+#define REPLAY_STEP_NS 1000000ULL   // millis() moves on in these
+
+struct ReplayStats {
+    unsigned long games;
+    unsigned long writes;
+    unsigned long switches;
+    unsigned long checks;
+    unsigned long mismatches;
+    unsigned long passes;
+    uint64_t us;                     // of play, the time of the last record
+};
+
+void replay_Pass(ReplayStats* stats) {
+    loop();
+    strip_Check();
+    stats->passes++;
+}
+
+// when the next marquee step or animation frame is due, in ns, UINT64_MAX
+// when nothing moves
+uint64_t replay_NextStep() {
+    uint64_t due = UINT64_MAX;
+    for (byte row = 0; row < 2; row++) {
+        if (marquees[row].length > 0) {
+            due = min(due, (uint64_t)(marquees[row].lastStep + marquees[row].stepMs) * REPLAY_STEP_NS);
+        }
+    }
+    if (animation.playing) {
+        due = min(due, (uint64_t)(animation.lastFrame + animation.holdMs) * REPLAY_STEP_NS);
+    }
+    return due;
+}
+
+// moves the clock on to ns with a pass of loop() wherever something on
+// screen is due to move, at the ms it is due
+void replay_RunTo(uint64_t ns, ReplayStats* stats) {
+    while (arduinoNanos < ns) {
+        uint64_t due = replay_NextStep();
+        if (due <= arduinoNanos) {
+            due = (arduinoNanos / REPLAY_STEP_NS + 1) * REPLAY_STEP_NS;   // late after a show, or a step of 0ms
+        }
+        if (due >= ns) {
+            arduinoNanos = ns;
+            break;
+        }
+        arduinoNanos = due;
+        replay_Pass(stats);
+    }
+}
+
+uint32_t replay_Hash() {
+    return trace_Hash(leds, sizeof(leds));
+}
+
+// Plays every record of in from a freshly booted sketch. With bless set, the
+// trace is copied there with a new TRACE_CHECK after every write, and the
+// checks of in are ignored. Mismatches are reported to report, if not NULL,
+// with the write before them and the matrix, the first few only.
+void replay_Trace(Trace* in, Trace* bless, ReplayStats* stats, FILE* report) {
+    memset(stats, 0, sizeof(*stats));
+    // as after power up, when a trace was played before: empty layers and
+    // nothing waiting to be shown
+    const byte clear = 0x05;
+    processI2CData(&clear, 1);
+    rxTail = rxHead;
+    framePending = false;
+    pendingUpdates = 0;
+    pendingSince = lastShowTime = 0;
+    timer0Fraction = 0;
+    arduino_Boot();
+    TraceRecord record;
+    TraceRecord lastWrite;
+    lastWrite.length = 0;
+    while (trace_Get(in, &record) != TRACE_END) {
+        replay_RunTo(record.us * 1000, stats);
+        stats->us = record.us;
+        switch (record.type) {
+            case TRACE_WRITE:
+                wire_Receive(record.payload[0], record.payload + 2, record.payload[1]);
+                wire_Stop();
+                replay_Pass(stats);
+                stats->writes++;
+                lastWrite = record;
+                if (bless != NULL) {
+                    trace_Put(bless, TRACE_WRITE, record.us, record.payload, record.length);
+                    trace_PutCheck(bless, record.us, replay_Hash());
+                }
+                break;
+            case TRACE_CHECK:
+                if (bless != NULL) {
+                    break;
+                }
+                stats->checks++;
+                if (replay_Hash() != trace_CheckHash(&record)) {
+                    stats->mismatches++;
+                    if (report != NULL && stats->mismatches <= 3) {
+                        fprintf(report, "mismatch at %.3f s, after write %lu:", record.us / 1e6, stats->writes);
+                        for (int i = 2; i < lastWrite.length; i++) {
+                            fprintf(report, " %02x", lastWrite.payload[i]);
+                        }
+                        fprintf(report, "\n");
+                        arduino_PrintMatrix(report);
+                    }
+                }
+                break;
+            case TRACE_SWITCH:
+            case TRACE_GAME:
+                stats->switches += (record.type == TRACE_SWITCH);
+                stats->games += (record.type == TRACE_GAME);
+                if (bless != NULL) {
+                    trace_Put(bless, record.type, record.us, record.payload, record.length);
+                }
+                break;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+// Stand-in for the Arduino core so scoreboard_LED.ino builds on Linux.
+// Time is the virtual clock arduinoNanos, moved on by host/arduino_host.h;
+// Serial keeps what is written in serialOutput and drains its 64 byte
+// transmit buffer at the baud rate, so a sketch that writes more than the
+// buffer holds waits here just like on the board.
+
+#define F_CPU 16000000L
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define constrain(amount, low, high) ((amount) < (low) ? (low) : ((amount) > (high) ? (high) : (amount)))
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+template <typename A, typename B>
+auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+template <typename A, typename B>
+auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+
+uint64_t arduinoNanos = 0;      // virtual time since power up, in ns
+
+// Timer0 overflows every 1024us and the core's interrupt counts them for
+// millis() and micros(). One that comes while interrupts are off waits in
+// TOV0, any more are lost, and so is one a sketch clears itself; those the
+// core misses are taken off the clock here. timer0_millis and
+// timer0_overflow_count only hold what a sketch adds to the core's counts.
+#define TIMER0_OVERFLOW_NS 1024000ULL
+volatile unsigned long timer0_overflow_count = 0;
+volatile unsigned long timer0_millis = 0;
+uint64_t timer0Seen = 0;        // overflows settled
+bool timer0Pending = false;     // TOV0
+unsigned long timer0Missed = 0; // overflows the core's interrupt never got
+
+// settles the overflows since the last call, under the interrupt flag as
+// it is now: cli(), sei() and the time the sketch spends with interrupts
+// off call it, so every stretch of time is settled under its own flag
+void timer0_Update(void) {
+    uint64_t overflows = arduinoNanos / TIMER0_OVERFLOW_NS;
+    bool on = SREG & _BV(SREG_I);
+    for (; timer0Seen < overflows; timer0Seen++) {
+        if (!on) {
+            timer0Missed += timer0Pending;
+            timer0Pending = true;
+        }
+    }
+    if (on) {
+        timer0Pending = false;  // the interrupt takes it
+    }
+}
+
+Tifr0::operator uint8_t() {
+    timer0_Update();
+    return timer0Pending ? _BV(TOV0) : 0;
+}
+
+void Tifr0::operator=(uint8_t bits) {
+    timer0_Update();
+    if ((bits & _BV(TOV0)) && timer0Pending) {
+        timer0Pending = false;
+        timer0Missed++;
+    }
+}
+
+// the clock as the core would keep it
+uint64_t timer0Nanos(void) {
+    timer0_Update();
+    return arduinoNanos - timer0Missed * TIMER0_OVERFLOW_NS;
+}
+
+unsigned long millis() { return timer0Nanos() / 1000000 + timer0_millis; }
+unsigned long micros() { return timer0Nanos() / 1000 + timer0_overflow_count * 1024; }
+void delay(unsigned long ms) { arduinoNanos += ms * 1000000ULL; }
+void delayMicroseconds(unsigned int us) { arduinoNanos += us * 1000ULL; }
+
+#define SERIAL_TX_BUFFER 64
+#define SERIAL_OUTPUT_MAX (1 << 20)
+
+struct HardwareSerial {
+    uint64_t byteNs = 0;                // one byte on the line, 10 bits
+    uint64_t emptyAt = 0;               // when the transmit buffer has drained
+    uint64_t waitedNs = 0;              // time write() spent waiting for room
+    uint8_t output[SERIAL_OUTPUT_MAX];  // everything written, oldest first
+    size_t outputLength = 0;
+    uint8_t input[64];                  // bytes the host has typed, see arduino_Type()
+    size_t inputHead = 0;
+    size_t inputTail = 0;
+
+    void begin(unsigned long baud) { byteNs = 10000000000ULL / baud; }
+    int pending() {
+        if (emptyAt <= arduinoNanos || byteNs == 0) return 0;
+        return (emptyAt - arduinoNanos + byteNs - 1) / byteNs;
+    }
+    int availableForWrite() { return SERIAL_TX_BUFFER - 1 - pending(); }
+    size_t write(uint8_t value) {
+        if (availableForWrite() <= 0) {
+            // The buffer is full, wait for the line like the real write() does
+            uint64_t room = emptyAt - (SERIAL_TX_BUFFER - 2) * byteNs;
+            waitedNs += room - arduinoNanos;
+            arduinoNanos = room;
+        }
+        emptyAt = ((emptyAt > arduinoNanos) ? emptyAt : arduinoNanos) + byteNs;
+        if (outputLength < SERIAL_OUTPUT_MAX) output[outputLength++] = value;
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        for (size_t i = 0; i < length; i++) write(data[i]);
+        return length;
+    }
+    size_t print(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+    size_t print(long value) {
+        char text[16];
+        snprintf(text, sizeof(text), "%ld", value);
+        return print(text);
+    }
+    size_t print(int value) { return print((long)value); }
+    size_t print(unsigned long value) { return print((long)value); }
+    size_t println() { return print("\r\n"); }
+    template <typename T>
+    size_t println(T value) { return print(value) + println(); }
+    int available() { return inputTail - inputHead; }
+    int read() { return (inputHead < inputTail) ? input[inputHead++] : -1; }
+};
+HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_FASTLED_H
+#define HOST_FASTLED_H
+#include "Arduino.h"
+
+// Stand-in for FastLED. The sketch only takes CRGB and its color names
+// from it and drives the strip itself; the frames it sends are recorded
+// by the ws2812Byte() of host/arduino_host.h.
+
+struct CRGB {
+    uint8_t r, g, b;
+    enum HTMLColorCode : uint32_t {
+        Black = 0x000000, Green = 0x008000, Blue = 0x0000FF, Red = 0xFF0000,
+        Yellow = 0xFFFF00, Purple = 0x800080, Orange = 0xFFA500, White = 0xFFFFFF,
+        Aqua = 0x00FFFF, Magenta = 0xFF00FF, Pink = 0xFFC0CB, Navy = 0x000080,
+        Gray = 0x808080, Maroon = 0x800000, Lime = 0x00FF00, Gold = 0xFFD700
+    };
+    CRGB() : r(0), g(0), b(0) {}
+    CRGB(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue) {}
+    CRGB(uint32_t code) : r(code >> 16), g(code >> 8), b(code) {}
+    CRGB(HTMLColorCode code) : CRGB((uint32_t)code) {}
+};
+
+#endif
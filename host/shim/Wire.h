@@ -0,0 +1,40 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+#include "Arduino.h"
+
+// Stand-in for the Wire library in slave mode. host/arduino_host.h plays
+// the master: it fills the receive buffer and calls onReceive, or calls
+// onRequest and takes what was written.
+
+#define WIRE_BUFFER 32           // BUFFER_LENGTH of the AVR Wire library
+
+struct TwoWire {
+    uint8_t address = 0;
+    void (*receive)(int) = nullptr;
+    void (*request)(void) = nullptr;
+    uint8_t rx[WIRE_BUFFER];
+    uint8_t rxLength = 0;
+    uint8_t rxIndex = 0;
+    uint8_t tx[WIRE_BUFFER];
+    uint8_t txLength = 0;
+
+    void begin(uint8_t slave) { address = slave; TWAR = slave << 1; }
+    void onReceive(void (*handler)(int)) { receive = handler; }
+    void onRequest(void (*handler)(void)) { request = handler; }
+    int available() { return rxLength - rxIndex; }
+    int read() { return (rxIndex < rxLength) ? rx[rxIndex++] : -1; }
+    size_t write(uint8_t value) {
+        if (txLength >= WIRE_BUFFER) return 0;
+        tx[txLength++] = value;
+        return 1;
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        size_t n = 0;
+        while (n < length && write(data[n])) n++;
+        return n;
+    }
+    void setClock(uint32_t) {}
+};
+TwoWire Wire;
+
+#endif
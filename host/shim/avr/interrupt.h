@@ -0,0 +1,13 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+#include <avr/io.h>
+
+// sei() lets in the interrupts that are due on the virtual clock,
+// see arduino_Interrupts() in host/arduino_host.h. Both settle Timer0 up
+// to now first, see timer0_Update() in host/shim/Arduino.h.
+void arduino_Interrupts(void);
+void timer0_Update(void);
+#define cli() (timer0_Update(), SREG &= ~_BV(SREG_I))
+#define sei() (timer0_Update(), SREG |= _BV(SREG_I), arduino_Interrupts())
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+#include <stdint.h>
+
+// ATmega328P registers the sketch touches, as plain variables.
+// TCNT0 counts with the virtual clock, 4us a tick like Timer0 on a
+// 16MHz Uno with the 1:64 prescale, and TIFR0 has its overflow flag, see
+// the Timer0 model in host/shim/Arduino.h. The TWI registers are written
+// by host/arduino_host.h as the bus model goes through a transaction.
+
+volatile uint8_t PINC = 0x30;    // SDA and SCL idle high
+volatile uint8_t PORTC, DDRC, PORTD, DDRD;
+volatile uint8_t TWAR, TWCR, TWSR, TWBR;
+volatile uint8_t SREG = 0x80;    // interrupts on, as after init() in the core
+
+uint8_t arduino_Tcnt0(void);
+#define TCNT0 arduino_Tcnt0()
+
+// TOV0 reads set while a Timer0 overflow waits for its interrupt, and
+// writing it 1 clears it
+struct Tifr0 {
+    operator uint8_t();
+    void operator=(uint8_t bits);
+};
+Tifr0 TIFR0;
+
+#define PC4 4
+#define PC5 5
+#define PD2 2
+#define TOV0 0
+#define TWGCE 0
+#define TWEN 2
+#define TWEA 6
+#define TWINT 7
+#define SREG_I 7
+
+#define _BV(bit) (1 << (bit))
+#define _SFR_IO_ADDR(reg) 0
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+#include <stdint.h>
+#include <string.h>
+
+// Flash and RAM are the same on the host
+#define PROGMEM
+#define PSTR(text) (text)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define pgm_read_ptr(address) (*(const void* const*)(address))
+#define pgm_read_byte_near(address) pgm_read_byte(address)
+#define pgm_read_word_near(address) pgm_read_word(address)
+#define memcpy_P memcpy
+
+#endif
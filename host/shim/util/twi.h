@@ -0,0 +1,8 @@
+#ifndef HOST_UTIL_TWI_H
+#define HOST_UTIL_TWI_H
+#include <avr/io.h>
+
+#define TW_STATUS (TWSR & 0xF8)
+#define TW_SR_STOP 0xA0
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef HOST_XC_H
+#define HOST_XC_H
+#include <stdint.h>
+
+// Stand-in for XC8's <xc.h> so the PIC firmware builds on Linux.
+// Every special function register the firmware touches is a plain variable
+// with the same bit layout as the PIC16F1829, so NAME and NAMEbits alias
+// like they do on the chip. The peripherals behind them (Timer1, the data
+// EEPROM, and the MSSP once the harness drives it) are modelled in
+// pic_host.h, the registers only hold what the firmware last wrote or the
+// model last set.
+
+#define __interrupt()
+#define __delay_ms(x) ((void)(x))
+#define __delay_us(x) ((void)(x))
+#define NOP() ((void)0)
+#define di() (INTCONbits.GIE = 0)
+#define ei() (INTCONbits.GIE = 1)
+
+#define PIC_BITS(name, ...) \
+    typedef union { struct { unsigned __VA_ARGS__; }; uint8_t value; } name##bits_t; \
+    volatile name##bits_t name##bits
+
+PIC_BITS(INTCON, IOCIF:1, INTF:1, TMR0IF:1, IOCIE:1, INTE:1, TMR0IE:1, PEIE:1, GIE:1);
+PIC_BITS(OPTION_REG, PS:3, PSA:1, T0SE:1, T0CS:1, INTEDG:1, nWPUEN:1);
+PIC_BITS(PIR1, TMR1IF:1, TMR2IF:1, CCP1IF:1, SSP1IF:1, TXIF:1, RCIF:1, ADIF:1, TMR1GIF:1);
+PIC_BITS(PIE1, TMR1IE:1, TMR2IE:1, CCP1IE:1, SSP1IE:1, TXIE:1, RCIE:1, ADIE:1, TMR1GIE:1);
+PIC_BITS(PIR2, CCP2IF:1, :2, BCL1IF:1, EEIF:1, C1IF:1, C2IF:1, OSFIF:1);
+PIC_BITS(PIE2, CCP2IE:1, :2, BCL1IE:1, EEIE:1, C1IE:1, C2IE:1, OSFIE:1);
+PIC_BITS(SSP1CON1, SSPM:4, CKP:1, SSPEN:1, SSPOV:1, WCOL:1);
+PIC_BITS(SSP1CON2, SEN:1, RSEN:1, PEN:1, RCEN:1, ACKEN:1, ACKDT:1, ACKSTAT:1, GCEN:1);
+PIC_BITS(SSP1STAT, BF:1, UA:1, R_nW:1, S:1, P:1, D_nA:1, CKE:1, SMP:1);
+PIC_BITS(T1CON, TMR1ON:1, :1, nT1SYNC:1, T1OSCEN:1, T1CKPS:2, TMR1CS:2);
+PIC_BITS(EECON1, RD:1, WR:1, WREN:1, WRERR:1, FREE:1, LWLO:1, CFGS:1, EEPGD:1);
+PIC_BITS(PORTA, RA0:1, RA1:1, RA2:1, RA3:1, RA4:1, RA5:1);
+PIC_BITS(PORTB, :4, RB4:1, RB5:1, RB6:1, RB7:1);
+PIC_BITS(PORTC, RC0:1, RC1:1, RC2:1, RC3:1, RC4:1, RC5:1, RC6:1, RC7:1);
+PIC_BITS(TRISA, TRISA0:1, TRISA1:1, TRISA2:1, TRISA3:1, TRISA4:1, TRISA5:1);
+PIC_BITS(TRISB, :4, TRISB4:1, TRISB5:1, TRISB6:1, TRISB7:1);
+PIC_BITS(TRISC, TRISC0:1, TRISC1:1, TRISC2:1, TRISC3:1, TRISC4:1, TRISC5:1, TRISC6:1, TRISC7:1);
+PIC_BITS(LATA, LATA0:1, LATA1:1, LATA2:1, LATA3:1, LATA4:1, LATA5:1);
+PIC_BITS(WPUA, WPUA0:1, WPUA1:1, WPUA2:1, WPUA3:1, WPUA4:1, WPUA5:1);
+PIC_BITS(WPUB, :4, WPUB4:1, WPUB5:1, WPUB6:1, WPUB7:1);
+PIC_BITS(WPUC, WPUC0:1, WPUC1:1, WPUC2:1, WPUC3:1, WPUC4:1, WPUC5:1, WPUC6:1, WPUC7:1);
+PIC_BITS(ANSELA, ANSA0:1, ANSA1:1, ANSA2:1, :1, ANSA4:1);
+PIC_BITS(ANSELC, ANSC0:1, ANSC1:1, ANSC2:1, ANSC3:1, :2, ANSC6:1, ANSC7:1);
+PIC_BITS(INLVLA, INLVLA0:1, INLVLA1:1, INLVLA2:1, INLVLA3:1, INLVLA4:1, INLVLA5:1);
+
+#define INTCON INTCONbits.value
+#define OPTION_REG OPTION_REGbits.value
+#define PIR1 PIR1bits.value
+#define PIE1 PIE1bits.value
+#define PIR2 PIR2bits.value
+#define PIE2 PIE2bits.value
+#define SSP1CON1 SSP1CON1bits.value
+#define SSP1CON2 SSP1CON2bits.value
+#define SSP1STAT SSP1STATbits.value
+#define T1CON T1CONbits.value
+#define EECON1 EECON1bits.value
+#define PORTA PORTAbits.value
+#define PORTB PORTBbits.value
+#define PORTC PORTCbits.value
+#define TRISA TRISAbits.value
+#define TRISB TRISBbits.value
+#define TRISC TRISCbits.value
+#define LATA LATAbits.value
+#define WPUA WPUAbits.value
+#define WPUB WPUBbits.value
+#define WPUC WPUCbits.value
+#define ANSELA ANSELAbits.value
+#define ANSELC ANSELCbits.value
+#define INLVLA INLVLAbits.value
+#define TRISB4 TRISBbits.TRISB4
+#define TRISB6 TRISBbits.TRISB6
+
+volatile uint8_t OSCCON;
+volatile uint8_t TMR0;
+volatile uint8_t SSP1ADD;
+volatile uint8_t SSP1CON3;
+volatile uint8_t EEADRL;
+volatile uint8_t EECON2;
+
+// SSP1BUF is wider than the real register so the MSSP model can tell a
+// byte written by the firmware (0-255) from PIC_SSPBUF_EMPTY, see pic_host.h
+#define PIC_SSPBUF_EMPTY 0x100
+volatile unsigned int SSP1BUF = PIC_SSPBUF_EMPTY;
+
+// Timer1 and the EEPROM data register are read through the models
+volatile uint8_t* pic_Timer1(uint8_t high);
+volatile uint8_t* pic_EepromData(void);
+#define TMR1L (*pic_Timer1(0))
+#define TMR1H (*pic_Timer1(1))
+#define EEDATL (*pic_EepromData())
+
+#endif
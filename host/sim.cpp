@@ -0,0 +1,336 @@
+// Both firmwares joined by the virtual bus, see sim.h. Plays scripted games
+// on the PIC's switches and measures what reaches the leds:
+//   switch to led latency   from a target closing to the first frame the
+//                           strip latches that differs from the one before
+//   frames per second       latches, and latches that changed something
+//   bus utilization         share of the time the bus was not idle
+//   frame latency           from the PIC queueing a frame for the lane to
+//                           the sketch having processed it
+// Every changed frame can be written out as a text matrix (--dump FILE)
+// or a PPM image (--ppm DIR), so two builds can be diffed frame by frame.
+// The writes the sketch received and the switches can be recorded as a
+// trace (--trace FILE) for replay, see trace.h and replay.h. With --load N
+// the PIC queues N frames more for the lane just before every hit, as a
+// busier display would, so the hit's frame waits behind them. What the
+// sketch wrote on its serial port, the telemetry with the PIC's inside, can
+// be saved for the telemetry tool (--telemetry FILE).
+//
+//   sim [--games N] [--load N] [--dump FILE] [--ppm DIR] [--trace FILE] [--telemetry FILE]
+
+#include "trace.h"
+
+void traceReceived(const volatile uint8_t* data, int length);
+#define TRACE_RX(data, length) traceReceived(data, length)
+
+#include "arduino_firmware.h"
+#include "sim.h"
+
+Trace trace;                         // recording when trace.file is set
+
+void traceReceived(const volatile uint8_t* data, int length) {
+    if (trace.file != NULL) {
+        uint8_t copy[BUFFER_SIZE];
+        for (int i = 0; i < length; i++) {
+            copy[i] = data[i];
+        }
+        trace_PutWrite(&trace, arduinoNanos / 1000, Wire.address, copy, length);
+    }
+}
+
+void traceSwitches(uint8_t events, uint8_t closed) {
+    if (trace.file != NULL) {
+        const uint8_t payload[2] = {events, closed};
+        trace_Put(&trace, TRACE_SWITCH, sim_PicNanos() / 1000, payload, 2);
+    }
+}
+
+// the lane's Arduino, which also takes the general call
+uint8_t sim_SlaveAck(uint8_t address) {
+    return address == Wire.address || (address == 0 && (TWAR & _BV(TWGCE)));
+}
+
+void sim_SlaveWrite(uint8_t address, const uint8_t* data, uint8_t length) {
+    wire_Receive(address, data, length);
+}
+
+void sim_SlaveRead(uint8_t address, uint8_t* data, uint8_t length) {
+    wire_Request(address, data, length);
+}
+
+// Frames queued for the lane, in order, with the time they were queued,
+// taken off as loop() processes them
+#define MAX_FRAMES 8192
+#define FRAME_QUEUE 64
+uint64_t queuedAt[FRAME_QUEUE];
+unsigned long framesQueued = 0;
+unsigned long framesTaken = 0;
+byte lastProcessed = 0;
+double frameLatencies[MAX_FRAMES];
+int frameCount = 0;
+
+void sim_FrameQueued(uint8_t address) {
+    if (address == SLAVE_ADDRESS && framesQueued - framesTaken < FRAME_QUEUE) {
+        queuedAt[framesQueued++ % FRAME_QUEUE] = sim_PicNanos();
+    }
+}
+
+void takeProcessed(void) {
+    while (lastProcessed != framesProcessed && framesTaken < framesQueued) {
+        lastProcessed++;
+        uint64_t at = queuedAt[framesTaken++ % FRAME_QUEUE];
+        if (frameCount < MAX_FRAMES) {
+            frameLatencies[frameCount++] = (arduinoNanos - at) / 1000.0;
+        }
+    }
+}
+
+// the master catches up whenever the sketch lets interrupts in
+void catchUp(void) {
+    sim_PicRunTo(arduinoNanos);
+    PINC = sim_PicBusActive() ? _BV(PC5) : (_BV(PC4) | _BV(PC5));
+    takeProcessed();
+}
+
+// Frames the strip latched
+uint8_t lastFrame[STRIP_BYTES];
+unsigned long changedFrames = 0;
+uint64_t lastChangeAt = 0;
+FILE* dumpFile = NULL;
+const char* ppmDirectory = NULL;
+
+// The strip's levels scaled back up by the brightness, 10x10 pixels a led
+void writePpm(unsigned long number) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/frame%05lu.ppm", ppmDirectory, number);
+    FILE* out = fopen(path, "wb");
+    if (out == NULL) {
+        return;
+    }
+    const int scale = 10;
+    fprintf(out, "P6\n%d %d\n255\n", WIDTH * scale, HEIGHT * scale);
+    for (int py = 0; py < HEIGHT * scale; py++) {
+        for (int px = 0; px < WIDTH * scale; px++) {
+            const uint8_t* grb = stripFrame + 3 * pixelLed(px / scale, py / scale);
+            uint8_t rgb[3] = {grb[1], grb[0], grb[2]};
+            for (int c = 0; c < 3; c++) {
+                unsigned level = rgb[c] * 256u / (brightness + 1);
+                rgb[c] = (px % scale == 0 || py % scale == 0) ? 0 : (level > 255 ? 255 : level);
+            }
+            fwrite(rgb, 1, 3, out);
+        }
+    }
+    fclose(out);
+}
+
+void latched(void) {
+    if (memcmp(lastFrame, stripFrame, STRIP_BYTES) == 0) {
+        return;
+    }
+    memcpy(lastFrame, stripFrame, STRIP_BYTES);
+    changedFrames++;
+    lastChangeAt = stripLatchedAt;
+    if (dumpFile != NULL) {
+        fprintf(dumpFile, "frame %lu at %.3f ms\n", changedFrames, stripLatchedAt / 1e6);
+        arduino_PrintMatrix(dumpFile);
+    }
+    if (ppmDirectory != NULL) {
+        writePpm(changedFrames);
+    }
+}
+
+// runs both sides until the sketch's clock reads ns
+void runTo(uint64_t ns) {
+    while (arduinoNanos < ns) {
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    catchUp();
+}
+
+void runMs(uint32_t ms) {
+    runTo(arduinoNanos + ms * 1000000ULL);
+}
+
+// Latency of every scored hit, in us
+#define MAX_HITS 1024
+double latencies[MAX_HITS];
+int scoredHits = 0;
+
+// closes a switch, holds it 40ms, and returns when the press was made
+uint64_t press(uint8_t events) {
+    sim_PicRunTo(arduinoNanos);
+    uint64_t at = sim_PicNanos();
+    sim_PicSwitches(events, 1);
+    traceSwitches(events, 1);
+    runMs(40);
+    sim_PicSwitches(events, 0);
+    traceSwitches(events, 0);
+    return at;
+}
+
+// a target hit during play, with the time until the screen changed
+void hit(uint8_t target) {
+    int16_t score = sim_PicScore();
+    unsigned long changes = changedFrames;
+    uint64_t at = press(SIM_TARGET(target));
+    uint64_t limit = arduinoNanos + 1000 * 1000000ULL;
+    while (changedFrames == changes && arduinoNanos < limit) {
+        runMs(1);
+    }
+    if (sim_PicScore() != score && changedFrames != changes && scoredHits < MAX_HITS) {
+        latencies[scoredHits++] = (lastChangeAt - at) / 1000.0;
+    }
+}
+
+int compare(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+struct Window {
+    uint64_t start;
+    unsigned long frames;
+    unsigned long changed;
+    uint64_t busBusy;
+    unsigned long busBytes;
+    unsigned long busTransactions;
+};
+
+Window beginWindow() {
+    return Window{arduinoNanos, stripFrames, changedFrames, sim_PicBusBusyNs(),
+                  sim_PicBusBytes(), sim_PicBusTransactions()};
+}
+
+void reportWindow(const char* name, const Window& w) {
+    double seconds = (arduinoNanos - w.start) / 1e9;
+    printf("  %-10s %6.1f s  %5.1f fps  %5.1f changed fps  bus %5.2f%% busy, %6.0f bytes/s, %5.1f transactions/s\n",
+           name, seconds, (stripFrames - w.frames) / seconds, (changedFrames - w.changed) / seconds,
+           100.0 * (sim_PicBusBusyNs() - w.busBusy) / (arduinoNanos - w.start),
+           (sim_PicBusBytes() - w.busBytes) / seconds, (sim_PicBusTransactions() - w.busTransactions) / seconds);
+}
+
+int main(int argc, char** argv) {
+    int games = 5;
+    int load = 0;
+    const char* telemetryPath = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+            games = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--load") && i + 1 < argc) {
+            load = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--dump") && i + 1 < argc) {
+            dumpFile = fopen(argv[++i], "w");
+        } else if (!strcmp(argv[i], "--ppm") && i + 1 < argc) {
+            ppmDirectory = argv[++i];
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            if (!trace_Create(&trace, argv[++i])) {
+                fprintf(stderr, "%s: cannot create\n", argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "--telemetry") && i + 1 < argc) {
+            telemetryPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--games N] [--load N] [--dump FILE] [--ppm DIR] [--trace FILE] [--telemetry FILE]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+
+    srand(6);
+    stripLatched = latched;
+    arduinoBus = catchUp;
+    sim_PicBoot();
+    arduino_Boot();
+
+    printf("simulation, %d games\n", games);
+    Window attract = beginWindow();
+    runMs(3000);
+    reportWindow("attract", attract);
+    bool attractLooping = animation.playing;
+    bool attractStopped = false;
+
+    Window play = beginWindow();
+    uint64_t playNs = 0;
+    for (int g = 0; g < games; g++) {
+        if (trace.file != NULL) {
+            trace_Put(&trace, TRACE_GAME, arduinoNanos / 1000, NULL, 0);
+        }
+        press(SIM_START);
+        runMs(200);
+        if (g == 0) {
+            attractStopped = !animation.playing;
+        }
+        uint64_t start = arduinoNanos;
+        int shots = 0;
+        while (sim_PicState() == 1 && shots++ < 40) {
+            runMs(1100 + rand() % 900);     // Past the lockout, so every hit scores
+            if (load > 0) {
+                sim_PicRunTo(arduinoNanos);
+                sim_PicLoad(load);
+            }
+            hit(rand() % 4);
+        }
+        playNs += arduinoNanos - start;
+        runMs(4000);                         // End screen
+    }
+    reportWindow("play + end", play);
+
+    qsort(frameLatencies, frameCount, sizeof(double), compare);
+    if (frameCount > 0) {
+        printf("  frame latency over %d frames: median %.1f ms, p95 %.1f ms, max %.1f ms\n", frameCount,
+               frameLatencies[frameCount / 2] / 1000, frameLatencies[frameCount * 95 / 100] / 1000,
+               frameLatencies[frameCount - 1] / 1000);
+    }
+    qsort(latencies, scoredHits, sizeof(double), compare);
+    double sum = 0;
+    for (int i = 0; i < scoredHits; i++) {
+        sum += latencies[i];
+    }
+    if (scoredHits > 0) {
+        printf("  switch to led latency over %d hits: min %.1f ms, median %.1f ms, p95 %.1f ms, max %.1f ms, mean %.1f ms\n",
+               scoredHits, latencies[0] / 1000, latencies[scoredHits / 2] / 1000,
+               latencies[scoredHits * 95 / 100] / 1000, latencies[scoredHits - 1] / 1000, sum / scoredHits / 1000);
+    }
+    printf("  frames: %lu latched, %lu changed, %lu torn, %u shows aborted, %u received, %u dropped\n",
+           stripFrames, changedFrames, stripTorn, showAborted, rxFrames, rxDropped);
+    printf("final screen\n");
+    arduino_PrintMatrix(stdout);
+    if (dumpFile != NULL) {
+        fclose(dumpFile);
+    }
+    trace_Close(&trace);
+    if (telemetryPath != NULL) {
+        FILE* out = fopen(telemetryPath, "wb");
+        if (out == NULL || fwrite(Serial.output, 1, Serial.outputLength, out) != Serial.outputLength) {
+            fprintf(stderr, "%s: cannot write\n", telemetryPath);
+            return 1;
+        }
+        fclose(out);
+    }
+
+    // The debouncer needs 4ms, the display task runs every 50ms and the
+    // sketch shows at most every 1000 / MAX_FPS ms, so a hit should reach
+    // the leds within about 100ms
+    int failures = 0;
+    if (scoredHits < games * 5) {
+        printf("FAIL: only %d scored hits measured\n", scoredHits);
+        failures++;
+    }
+    if (scoredHits > 0 && latencies[scoredHits - 1] > 100000) {
+        printf("FAIL: a hit took over 100ms to reach the leds\n");
+        failures++;
+    }
+    if (stripTorn > 0) {
+        printf("FAIL: torn frames latched\n");
+        failures++;
+    }
+    if (!attractLooping || !attractStopped) {
+        printf("FAIL: the attract animation does not loop until a game starts\n");
+        failures++;
+    }
+    if (failures > 0) {
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,45 @@
+// The joined simulation: the PIC firmware (sim_pic.c, C) and the sketch
+// (sim.cpp, C++) are built as two programs in one, each on its own
+// virtual clock, joined by the MSSP model as the bus. The sketch's side
+// leads: whenever it lets interrupts in, the PIC is run up to its time and
+// every transaction the PIC completed meanwhile reaches the Wire interrupt.
+// While the sketch has interrupts off (a forced show) the PIC waits with
+// it, which stands in for the slave stretching the clock.
+
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the EVENT_ bits of pic_scoreboard.c
+#define SIM_TARGET(n) (1 << (n))
+#define SIM_START 0x10
+
+// PIC side, sim_pic.c
+void sim_PicBoot(void);
+void sim_PicRunTo(uint64_t ns);                  // runs the PIC until its clock reads ns
+uint64_t sim_PicNanos(void);
+void sim_PicSwitches(uint8_t events, uint8_t closed);
+uint8_t sim_PicBusActive(void);                  // a transaction is on the bus
+uint64_t sim_PicBusBusyNs(void);                 // time the bus was not idle
+unsigned long sim_PicBusBytes(void);
+unsigned long sim_PicBusTransactions(void);
+int sim_PicState(void);
+int16_t sim_PicScore(void);
+uint8_t sim_PicBalls(void);
+uint8_t sim_PicLoad(uint8_t frames);             // queues frames of extra lane traffic, returns how many fit
+
+// sketch side, sim.cpp: the slave the MSSP model talks to
+uint8_t sim_SlaveAck(uint8_t address);
+void sim_SlaveWrite(uint8_t address, const uint8_t* data, uint8_t length);
+void sim_SlaveRead(uint8_t address, uint8_t* data, uint8_t length);
+void sim_FrameQueued(uint8_t address);           // the PIC committed a frame for address
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
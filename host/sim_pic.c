@@ -0,0 +1,73 @@
+// PIC half of the joined simulation, see sim.h
+
+#include "sim.h"
+#define I2C_TRACE_FRAME(address, frame) sim_FrameQueued(address)
+#include "pic_firmware.h"
+#include "mssp_host.h"
+
+void sim_PicBoot(void) {
+    mssp_Attach();
+    msspAck = sim_SlaveAck;
+    msspWrite = sim_SlaveWrite;
+    msspRead = sim_SlaveRead;
+    pic_Boot();
+}
+
+void sim_PicRunTo(uint64_t ns) {
+    if (ns > picNanos) {
+        pic_Run(ns - picNanos);
+    }
+}
+
+uint64_t sim_PicNanos(void) {
+    return picNanos;
+}
+
+void sim_PicSwitches(uint8_t events, uint8_t closed) {
+    pic_Switches(events, closed);
+}
+
+uint8_t sim_PicBusActive(void) {
+    return msspOperation != MSSP_IDLE || i2cState != I2C_IDLE;
+}
+
+uint64_t sim_PicBusBusyNs(void) {
+    return msspBusyNs;
+}
+
+unsigned long sim_PicBusBytes(void) {
+    return msspBytes;
+}
+
+unsigned long sim_PicBusTransactions(void) {
+    return msspStarts;
+}
+
+int sim_PicState(void) {
+    return game.state;
+}
+
+int16_t sim_PicScore(void) {
+    return game.score;
+}
+
+uint8_t sim_PicBalls(void) {
+    return game.balls;
+}
+
+// frames more for the lane, as a busier display would send: batches that
+// redraw the balls as they are, so the screen does not change
+uint8_t sim_PicLoad(uint8_t frames) {
+    uint8_t queued = 0;
+    while (queued < frames) {
+        I2cFrame* frame = i2c_BeginBatch(I2C_CHANNEL_LANE);
+        if (frame == NULL) {
+            break;
+        }
+        while (i2c_PutBalls(frame, game.balls)) {
+        }
+        i2c_CommitFrame(I2C_CHANNEL_LANE);
+        queued++;
+    }
+    return queued;
+}
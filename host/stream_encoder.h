@@ -0,0 +1,136 @@
+// Encoder for the sketch's streamed frames (0x07 chunks, see "Streamed
+// frames" in scoreboard_LED.ino). A frame is NUM_LEDS palette indexes in
+// strip order, like leds[].
+// Only the leds that changed are sent: against black for a keyframe, or
+// against the frame sent before for a delta frame. Changed leds close
+// together are sent as one span, and each chunk of a span goes as packed
+// pixels or as runs, whichever covers more leds in one Wire buffer.
+
+#ifndef HOST_STREAM_ENCODER_H
+#define HOST_STREAM_ENCODER_H
+#include <stdint.h>
+#include <string.h>
+
+#define STREAM_LEDS 256
+#define STREAM_CHUNK_MAX 32                  // the Wire buffer
+#define STREAM_CHUNKS_MAX 64                 // chunk numbers are 6 bits
+#define STREAM_GAP 8                         // unchanged leds bridged rather than starting a new chunk
+
+#ifndef STREAM_HEADER                        // the sketch defines these too
+#define STREAM_HEADER 5
+#define STREAM_LAST 0x80
+#define STREAM_KEY 0x40
+#define STREAM_PACKED 0
+#define STREAM_RLE 1
+#endif
+#define STREAM_PAYLOAD_MAX (STREAM_CHUNK_MAX - STREAM_HEADER)
+
+typedef struct {
+    uint8_t data[STREAM_CHUNK_MAX];
+    uint8_t length;
+} StreamChunk;
+
+// leds from first that runs cover in at most STREAM_PAYLOAD_MAX bytes, up
+// to end, and the bytes they take
+static int stream_RleLeds(const uint8_t* frame, int first, int end, int* bytes) {
+    int led = first;
+    *bytes = 0;
+    while (led < end && *bytes < STREAM_PAYLOAD_MAX) {
+        int run = 1;
+        while (run < 16 && led + run < end && frame[led + run] == frame[led]) {
+            run++;
+        }
+        led += run;
+        (*bytes)++;
+    }
+    return led - first;
+}
+
+// writes one chunk header and payload covering leds from first, returns the leds covered
+static int stream_Chunk(StreamChunk* chunk, const uint8_t* frame, int first, int end,
+                        uint8_t seq, uint8_t number, uint8_t key) {
+    int rleBytes;
+    int rleLeds = stream_RleLeds(frame, first, end, &rleBytes);
+    int packedLeds = end - first;
+    if (packedLeds > 2 * STREAM_PAYLOAD_MAX) {
+        packedLeds = 2 * STREAM_PAYLOAD_MAX;
+    }
+    int packedCover = packedLeds;            // of the span
+    packedLeds += packedLeds & 1;            // whole bytes, the odd led out is sent as it is
+    uint8_t packed = (first + packedLeds <= STREAM_LEDS) &&
+                     (packedCover > rleLeds || (packedCover == rleLeds && packedLeds / 2 < rleBytes));
+
+    uint8_t* data = chunk->data;
+    data[0] = 0x07;
+    data[1] = seq;
+    data[2] = number | (key ? STREAM_KEY : 0);
+    data[3] = packed ? STREAM_PACKED : STREAM_RLE;
+    data[4] = first;
+    int n = STREAM_HEADER;
+    if (packed) {
+        for (int led = first; led < first + packedLeds; led += 2) {
+            data[n++] = (frame[led] & 0x0F) | (frame[led + 1] << 4);
+        }
+        chunk->length = n;
+        return packedLeds;
+    }
+    int led = first;
+    while (led < first + rleLeds) {
+        int run = 1;
+        while (run < 16 && led + run < end && frame[led + run] == frame[led]) {
+            run++;
+        }
+        data[n++] = ((run - 1) << 4) | (frame[led] & 0x0F);
+        led += run;
+    }
+    chunk->length = n;
+    return rleLeds;
+}
+
+// Encodes frame as chunks, a keyframe when base is NULL, else a delta from
+// base. Returns the chunk count, at least 1: a frame with no change is one
+// empty chunk, which still commits it.
+static int stream_Encode(const uint8_t* frame, const uint8_t* base, uint8_t seq,
+                         StreamChunk chunks[STREAM_CHUNKS_MAX]) {
+    uint8_t key = (base == NULL);
+    int count = 0;
+    int led = 0;
+    while (led < STREAM_LEDS && count < STREAM_CHUNKS_MAX) {
+        while (led < STREAM_LEDS && frame[led] == (key ? 0 : base[led])) {
+            led++;
+        }
+        if (led == STREAM_LEDS) {
+            break;
+        }
+        // the span runs on while the next change is at most STREAM_GAP leds away
+        int end = led + 1;
+        int quiet = 0;
+        for (int i = end; i < STREAM_LEDS && quiet <= STREAM_GAP; i++) {
+            if (frame[i] != (key ? 0 : base[i])) {
+                end = i + 1;
+                quiet = 0;
+            } else {
+                quiet++;
+            }
+        }
+        while (led < end && count < STREAM_CHUNKS_MAX) {
+            led += stream_Chunk(&chunks[count], frame, led, end, seq, count, key);
+            count++;
+        }
+    }
+    if (count == 0) {
+        StreamChunk* chunk = &chunks[count++];
+        uint8_t header[STREAM_HEADER] = {0x07, seq, (uint8_t)(key ? STREAM_KEY : 0), STREAM_RLE, 0};
+        memcpy(chunk->data, header, STREAM_HEADER);
+        chunk->length = STREAM_HEADER;
+    }
+    chunks[count - 1].data[2] |= STREAM_LAST;
+    return count;
+}
+
+// bits on the bus for a chunk: start, address and payload with their acks, stop
+static unsigned long stream_BusBits(const StreamChunk* chunk) {
+    return 1 + 9 * (1 + chunk->length) + 1;
+}
+
+#endif
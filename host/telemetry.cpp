@@ -0,0 +1,228 @@
+// Turns the sketch's binary telemetry (telemetry.h) into a line a second
+// of rates and, at the end, histograms of the rates, the commands the
+// sketch ran and the PIC's profile. Reads a capture of the Arduino's
+// serial port, or the sim's (sim --telemetry FILE).
+//
+//   telemetry [--quiet] [FILE]        stdin without FILE
+//   --quiet                           only the summary, no line a second
+//
+// A capture from the board, e.g.
+//   stty -F /dev/ttyACM0 9600 raw && cat /dev/ttyACM0 > board.telemetry
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "telemetry.h"
+
+#define BANDS 10
+
+const char* profileNames[TM_PROFILE_SLOTS] = {"main loop", "switches", "flush", "i2c isr"};
+const char* taskNames[TM_TASKS] = {"input", "game", "display", "storage", "telemetry"};
+
+// one column of the per second lines, kept for its histogram
+struct Series {
+    const char* name;
+    std::vector<double> values;
+};
+
+void histogram(const Series& s) {
+    if (s.values.empty()) {
+        return;
+    }
+    double low = s.values[0], high = s.values[0], sum = 0;
+    for (double v : s.values) {
+        low = (v < low) ? v : low;
+        high = (v > high) ? v : high;
+        sum += v;
+    }
+    printf("%s: min %.1f, mean %.1f, max %.1f over %zu s\n", s.name, low, sum / s.values.size(), high,
+           s.values.size());
+    if (high == low) {
+        return;
+    }
+    double band = (high - low) / BANDS;
+    unsigned counts[BANDS] = {0};
+    unsigned most = 1;
+    for (double v : s.values) {
+        int i = (int)((v - low) / band);
+        counts[(i < BANDS) ? i : BANDS - 1]++;
+    }
+    for (int i = 0; i < BANDS; i++) {
+        most = (counts[i] > most) ? counts[i] : most;
+    }
+    for (int i = 0; i < BANDS; i++) {
+        printf("  %8.1f-%-8.1f %5u ", low + i * band, low + (i + 1) * band, counts[i]);
+        for (unsigned bar = 0; bar < counts[i] * 40 / most; bar++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quiet = false;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quiet")) {
+            quiet = true;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "usage: %s [--quiet] [FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    FILE* in = (path != NULL) ? fopen(path, "rb") : stdin;
+    if (in == NULL) {
+        fprintf(stderr, "%s: cannot open\n", path);
+        return 1;
+    }
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        data.insert(data.end(), chunk, chunk + got);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    Series rx = {"frames received/s", {}};
+    Series shows = {"shows/s", {}};
+    Series showUs = {"last show us", {}};
+    Series loops = {"PIC main loop passes/s", {}};
+    Series hits = {"PIC hits/s", {}};
+
+    TmStats stats = {};
+    TmPacket packet;
+    TmCounters last = {}, counters;
+    bool haveCounters = false;
+    TmCommands firstCommands = {}, commands = {};
+    uint16_t commandMaxUs[TM_COMMAND_MAX + 1] = {0};
+    int commandPackets = 0;
+    TmPicCounters pic = {}, picLast = {};
+    int picPages = 0;
+    unsigned long hitsLost = 0, nacks = 0, full = 0, collisions = 0;
+    uint8_t latenessMax[TM_TASKS] = {0};
+    TmPicProfile profile;
+    uint16_t profileMin[TM_PROFILE_SLOTS], profileMax[TM_PROFILE_SLOTS] = {0};
+    memset(profileMin, 0xFF, sizeof(profileMin));
+    double profileSum[TM_PROFILE_SLOTS] = {0};
+    int profilePages = 0;
+    unsigned long unknownPages = 0;
+    size_t at = 0;
+
+    if (!quiet) {
+        printf("     s   rx/s drop/s  bad/s shows/s merged/s show us max us comp us aborts  "
+               "loops/s hits/s nacks full lost\n");
+    }
+    while (tm_Next(data.data(), data.size(), &at, &packet, &stats)) {
+        if (packet.type == TM_MASTER) {
+            int page = tm_Page(&packet);
+            if (page == TM_PAGE_COUNTERS) {
+                picLast = pic;
+                tm_PicCounters(&packet, &pic);
+                for (int i = 0; i < TM_TASKS; i++) {
+                    latenessMax[i] = (pic.latenessMs[i] > latenessMax[i]) ? pic.latenessMs[i] : latenessMax[i];
+                }
+                if (picPages++ > 0) {
+                    unsigned total = 0;
+                    for (int i = 0; i < TM_TARGETS; i++) {
+                        total += (uint16_t)(pic.hits[i] - picLast.hits[i]);
+                    }
+                    hits.values.push_back(total);
+                    loops.values.push_back(pic.loops);
+                    hitsLost += (uint8_t)(pic.hitsLost - picLast.hitsLost);
+                    nacks += (uint8_t)(pic.nacks - picLast.nacks);
+                    full += (uint8_t)(pic.full - picLast.full);
+                    collisions += (uint8_t)(pic.collisions - picLast.collisions);
+                }
+            } else if (page == TM_PAGE_PROFILE) {
+                tm_PicProfile(&packet, &profile);
+                for (int i = 0; i < TM_PROFILE_SLOTS; i++) {
+                    if (profile.max[i] == 0) {
+                        continue;   // the slot did not run that second
+                    }
+                    profileMin[i] = (profile.min[i] < profileMin[i]) ? profile.min[i] : profileMin[i];
+                    profileMax[i] = (profile.max[i] > profileMax[i]) ? profile.max[i] : profileMax[i];
+                    profileSum[i] += profile.average[i];
+                }
+                profilePages++;
+            } else {
+                unknownPages++;
+            }
+        } else if (packet.type == TM_COMMANDS) {
+            tm_Commands(&packet, &commands);
+            if (commandPackets++ == 0) {
+                firstCommands = commands;
+            }
+            for (int c = 1; c <= commands.last; c++) {
+                commandMaxUs[c] = (commands.maxUs[c] > commandMaxUs[c]) ? commands.maxUs[c] : commandMaxUs[c];
+            }
+        } else if (packet.type == TM_COUNTERS) {
+            tm_Counters(&packet, &counters);
+            if (haveCounters && counters.ms > last.ms) {
+                double seconds = (counters.ms - last.ms) / 1000.0;
+                double received = (uint16_t)(counters.received - last.received) / seconds;
+                double shown = (uint16_t)(counters.shown - last.shown) / seconds;
+                rx.values.push_back(received);
+                shows.values.push_back(shown);
+                showUs.values.push_back(counters.showUs);
+                if (!quiet) {
+                    printf("%6.1f %6.1f %6.1f %6.1f %7.1f %8.1f %7u %6u %7u %6u", counters.ms / 1000.0, received,
+                           (uint16_t)(counters.dropped - last.dropped) / seconds,
+                           (uint16_t)(counters.malformed - last.malformed) / seconds, shown,
+                           (uint16_t)(counters.coalesced - last.coalesced) / seconds, counters.showUs,
+                           counters.showMaxUs, counters.compositeMaxUs,
+                           (unsigned)(uint16_t)(counters.aborted - last.aborted));
+                    if (!loops.values.empty()) {
+                        printf("  %7.0f %6.0f %5u %4u %4u", loops.values.back(), hits.values.back(),
+                               (uint8_t)(pic.nacks - picLast.nacks), (uint8_t)(pic.full - picLast.full),
+                               (uint8_t)(pic.hitsLost - picLast.hitsLost));
+                    }
+                    putchar('\n');
+                }
+            }
+            last = counters;
+            haveCounters = true;
+        }
+    }
+
+    printf("%lu packets, %lu bad checksums, %lu bad lengths, %lu bytes skipped, %lu unknown master pages\n",
+           stats.packets, stats.badChecksum, stats.badLength, stats.skipped, unknownPages);
+    histogram(rx);
+    histogram(shows);
+    histogram(showUs);
+    histogram(loops);
+    histogram(hits);
+    if (picPages > 1) {
+        printf("PIC: %lu hits lost, %lu I2C nacks, %lu frames refused for a full channel, %lu collisions\n",
+               hitsLost, nacks, full, collisions);
+        printf("PIC tasks, the latest a run started in any second:");
+        for (int i = 0; i < TM_TASKS; i++) {
+            printf(" %s %u ms%s", taskNames[i], latenessMax[i], (i + 1 < TM_TASKS) ? "," : "\n");
+        }
+    }
+    if (haveCounters) {
+        printf("%u PIC pages lost on the Arduino for want of serial room\n", counters.masterLost);
+    }
+    if (commandPackets > 0) {
+        printf("command  runs  longest us\n");
+        for (int c = 1; c <= commands.last; c++) {
+            unsigned runs = (uint16_t)(commands.count[c] - firstCommands.count[c]);
+            if (runs > 0 || commandMaxUs[c] > 0) {
+                printf("   0x%02X %6u %8u\n", c, runs, commandMaxUs[c]);
+            }
+        }
+    }
+    if (profilePages > 0) {
+        printf("PIC profile    min us  mean us  max us\n");
+        for (int i = 0; i < TM_PROFILE_SLOTS; i++) {
+            if (profileMax[i] > 0) {
+                printf("  %-10s %7u %8.1f %7u\n", profileNames[i], profileMin[i], profileSum[i] / profilePages,
+                       profileMax[i]);
+            }
+        }
+    }
+    return 0;
+}
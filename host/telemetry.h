@@ -0,0 +1,184 @@
+// Decoder for the sketch's telemetry stream (see the telemetry section of
+// scoreboard_LED.ino), shared by the telemetry tool and its test.
+// Packets are found by their sync byte and kept only if the checksum and
+// the length of their type agree, so a stream picked up halfway or with
+// bytes lost on the line falls back in step at the next good packet.
+// The PIC's pages come inside TELEMETRY_MASTER packets, laid out as
+// telemetryTask() in pic_scoreboard.c packs them.
+
+#ifndef HOST_TELEMETRY_H
+#define HOST_TELEMETRY_H
+#include <stdint.h>
+#include <string.h>
+
+#define TM_SYNC 0xA5
+#define TM_COUNTERS 1
+#define TM_MASTER 2
+#define TM_COMMANDS 3
+#define TM_COUNTERS_SIZE 29
+#define TM_COMMAND_MAX 32           // commands a COMMANDS packet can hold
+
+#define TM_PAGE_COUNTERS 0          // the PIC's pages, first byte of a MASTER payload
+#define TM_PAGE_PROFILE 1
+#define TM_TARGETS 4                // CORE_TARGETS
+#define TM_TASKS 5                  // TASK_COUNT
+#define TM_PROFILE_SLOTS 4          // PROFILE_SLOTS
+#define TM_PAGE_COUNTERS_SIZE (1 + 2 + 2 * TM_TARGETS + 1 + 2 + 4 + TM_TASKS)
+#define TM_PAGE_PROFILE_SIZE (1 + 6 * TM_PROFILE_SLOTS)
+
+// TELEMETRY_COUNTERS
+struct TmCounters {
+    uint32_t ms;
+    uint16_t received, dropped, malformed, rejected;
+    uint8_t highWater;
+    uint16_t shown, coalesced, showUs, showMaxUs, compositeMaxUs, aborted, deferred;
+    uint16_t masterLost;            // the PIC's pages the Arduino had no room to pass on
+};
+
+// TELEMETRY_COMMANDS, entry 0 is unused like the sketch's commandCount[0]
+struct TmCommands {
+    int last;                       // highest command in the packet
+    uint16_t count[TM_COMMAND_MAX + 1];
+    uint16_t maxUs[TM_COMMAND_MAX + 1];
+};
+
+// the PIC's counters page
+struct TmPicCounters {
+    uint16_t loops;                 // main loop passes in the last second
+    uint16_t hits[TM_TARGETS];      // wraps
+    uint8_t hitsLost;
+    uint16_t hitLatencyMaxMs;
+    uint8_t full, nacks, collisions, eepromWrites;
+    uint8_t latenessMs[TM_TASKS];   // longest each task started late in the last second
+};
+
+// the PIC's profile page, us over the last second
+struct TmPicProfile {
+    uint16_t min[TM_PROFILE_SLOTS], max[TM_PROFILE_SLOTS], average[TM_PROFILE_SLOTS];
+};
+
+struct TmPacket {
+    uint8_t type;
+    uint8_t length;
+    const uint8_t* payload;
+};
+
+struct TmStats {
+    unsigned long packets;
+    unsigned long badChecksum;      // a sync byte that did not start a good packet
+    unsigned long badLength;        // a good checksum on a length its type cannot have
+    unsigned long skipped;          // bytes between packets
+};
+
+uint16_t tm_Get16(const uint8_t* data) {
+    return data[0] | (data[1] << 8);
+}
+
+// Finds the next good packet from *at in data, moves *at past it and
+// returns true, or returns false at the end of the data. A packet cut off
+// by the end is left for a later call with more data.
+bool tm_Next(const uint8_t* data, size_t length, size_t* at, TmPacket* packet, TmStats* stats) {
+    while (*at < length) {
+        if (data[*at] != TM_SYNC) {
+            stats->skipped++;
+            (*at)++;
+            continue;
+        }
+        if (*at + 3 > length || *at + 4 + data[*at + 2] > length) {
+            return false;
+        }
+        uint8_t type = data[*at + 1];
+        uint8_t size = data[*at + 2];
+        uint8_t sum = type + size;
+        for (uint8_t i = 0; i < size; i++) {
+            sum += data[*at + 3 + i];
+        }
+        bool known = (type == TM_COUNTERS && size == TM_COUNTERS_SIZE) ||
+                     (type == TM_COMMANDS && size % 4 == 0 && size / 4 <= TM_COMMAND_MAX) || type == TM_MASTER;
+        if (sum != data[*at + 3 + size] || !known) {
+            if (sum != data[*at + 3 + size]) {
+                stats->badChecksum++;
+            } else {
+                stats->badLength++;
+            }
+            stats->skipped++;
+            (*at)++;                // it was not a packet, look for the next sync byte
+            continue;
+        }
+        packet->type = type;
+        packet->length = size;
+        packet->payload = data + *at + 3;
+        *at += 4 + size;
+        stats->packets++;
+        return true;
+    }
+    return false;
+}
+
+void tm_Counters(const TmPacket* packet, TmCounters* c) {
+    const uint8_t* p = packet->payload;
+    c->ms = tm_Get16(p) | ((uint32_t)tm_Get16(p + 2) << 16);
+    c->received = tm_Get16(p + 4);
+    c->dropped = tm_Get16(p + 6);
+    c->malformed = tm_Get16(p + 8);
+    c->rejected = tm_Get16(p + 10);
+    c->highWater = p[12];
+    c->shown = tm_Get16(p + 13);
+    c->coalesced = tm_Get16(p + 15);
+    c->showUs = tm_Get16(p + 17);
+    c->showMaxUs = tm_Get16(p + 19);
+    c->compositeMaxUs = tm_Get16(p + 21);
+    c->aborted = tm_Get16(p + 23);
+    c->deferred = tm_Get16(p + 25);
+    c->masterLost = tm_Get16(p + 27);
+}
+
+void tm_Commands(const TmPacket* packet, TmCommands* c) {
+    memset(c, 0, sizeof(*c));
+    c->last = packet->length / 4;
+    for (int command = 1; command <= c->last; command++) {
+        c->count[command] = tm_Get16(packet->payload + (command - 1) * 4);
+        c->maxUs[command] = tm_Get16(packet->payload + (command - 1) * 4 + 2);
+    }
+}
+
+// the page a MASTER packet holds, or -1 if it is not one the PIC sends
+int tm_Page(const TmPacket* packet) {
+    if (packet->length == TM_PAGE_COUNTERS_SIZE && packet->payload[0] == TM_PAGE_COUNTERS) {
+        return TM_PAGE_COUNTERS;
+    }
+    if (packet->length == TM_PAGE_PROFILE_SIZE && packet->payload[0] == TM_PAGE_PROFILE) {
+        return TM_PAGE_PROFILE;
+    }
+    return -1;
+}
+
+void tm_PicCounters(const TmPacket* packet, TmPicCounters* c) {
+    const uint8_t* p = packet->payload + 1;
+    c->loops = tm_Get16(p);
+    p += 2;
+    for (int i = 0; i < TM_TARGETS; i++, p += 2) {
+        c->hits[i] = tm_Get16(p);
+    }
+    c->hitsLost = *p++;
+    c->hitLatencyMaxMs = tm_Get16(p);
+    p += 2;
+    c->full = *p++;
+    c->nacks = *p++;
+    c->collisions = *p++;
+    c->eepromWrites = *p++;
+    for (int i = 0; i < TM_TASKS; i++) {
+        c->latenessMs[i] = *p++;
+    }
+}
+
+void tm_PicProfile(const TmPacket* packet, TmPicProfile* c) {
+    const uint8_t* p = packet->payload + 1;
+    for (int i = 0; i < TM_PROFILE_SLOTS; i++, p += 6) {
+        c->min[i] = tm_Get16(p);
+        c->max[i] = tm_Get16(p + 2);
+        c->average[i] = tm_Get16(p + 4);
+    }
+}
+
+#endif
@@ -0,0 +1,161 @@
+// The sketch's animations (0x0B) against their sources in animations/:
+//   the records in flash are what anim_compile makes of the sources, so
+//     animations.h is up to date
+//   played once on a clear screen, each animation shows as many frames as
+//     its source has, each one exactly as drawn, for about as long as the
+//     holds add up to
+//   flash: bytes per animation against storing every frame whole, and the
+//     total against ANIM_FLASH_BUDGET
+//   a malformed source is refused with the line it is on
+
+#include "arduino_firmware.h"
+#include "anim_compiler.h"
+#include "check.h"
+
+#define ANIM_FLASH_BUDGET 512       // bytes for every animation together
+
+struct Compiled {
+    const char* source;
+    const byte* records;            // in the sketch
+    size_t size;
+};
+
+const Compiled compiled[] = {
+    {"animations/win.txt", winAnimation, sizeof(winAnimation)},
+    {"animations/drain.txt", drainAnimation, sizeof(drainAnimation)},
+    {"animations/attract.txt", attractAnimation, sizeof(attractAnimation)},
+};
+#define COMPILED_COUNT (sizeof(compiled) / sizeof(compiled[0]))
+
+// frame records up to the end marker
+int recordCount(const byte* records) {
+    int count = 0;
+    while (records[0] != 0) {
+        const byte* frame = records + 3;
+        for (byte spans = records[2]; spans > 0; spans--) {
+            frame += 2 + frame[1];
+        }
+        records = frame;
+        count++;
+    }
+    return count;
+}
+
+// every change of leds[] the strip latches, with its time
+std::vector<std::vector<uint8_t> > shownFrames;
+std::vector<uint64_t> shownAt;
+
+std::vector<uint8_t> shown() {
+    std::vector<uint8_t> frame(NUM_LEDS);
+    for (int led = 0; led < NUM_LEDS; led++) {
+        frame[led] = getPixel(leds, led);
+    }
+    return frame;
+}
+
+void latched() {
+    std::vector<uint8_t> frame = shown();
+    if (shownFrames.empty() || shownFrames.back() != frame) {
+        shownFrames.push_back(frame);
+        shownAt.push_back(stripLatchedAt);
+    }
+}
+
+// plays an animation once on a clear screen and checks what it showed
+void testPlay(int number, const Animation& source) {
+    const uint8_t clear[] = {0x05};
+    arduino_Send(clear, sizeof(clear));
+    arduino_RunMs(200);
+    shownFrames.assign(1, shown());
+    shownAt.assign(1, arduinoNanos);
+    const uint8_t play[] = {0x0B, (uint8_t)number, 1, 0};
+    arduino_Send(play, sizeof(play));
+    int holdMs = 0;
+    for (const AnimFrame& frame : source.frames) {
+        holdMs += frame.holdMs;
+    }
+    arduino_RunMs(holdMs + 500);
+
+    int wrong = 0;
+    for (size_t i = 0; i < source.frames.size() && i + 1 < shownFrames.size(); i++) {
+        wrong += memcmp(shownFrames[i + 1].data(), source.frames[i].pixels, NUM_LEDS) != 0;
+    }
+    int frames = shownFrames.size() - 1;
+    double playedMs = frames > 0 ? (shownAt.back() - shownAt[1]) / 1e6 : 0;
+    double lastHoldMs = holdMs - source.frames.back().holdMs;     // the last frame stays up
+    char line[128];
+    snprintf(line, sizeof(line), "%s: %d frames shown of %zu, %d wrong", source.name.c_str(), frames,
+             source.frames.size(), wrong);
+    check(frames == (int)source.frames.size() && wrong == 0, line);
+    snprintf(line, sizeof(line), "%s: first to last frame %.0f ms, the holds before it %.0f ms",
+             source.name.c_str(), playedMs, lastHoldMs);
+    check(playedMs >= lastHoldMs - FRAME_INTERVAL_MS && playedMs <= lastHoldMs + FRAME_INTERVAL_MS, line);
+}
+
+void testMalformed() {
+    printf("malformed sources\n");
+    const char* path = "build/malformed.txt";
+    FILE* out = fopen(path, "w");
+    fprintf(out, "key 100\n");
+    for (int row = 0; row < HEIGHT; row++) {
+        fprintf(out, "%s\n", row == 5 ? "........X......................." : "................................");
+    }
+    fclose(out);
+    Animation animation;
+    std::string error;
+    bool parsed = anim_Parse(path, &animation, &error);
+    check(!parsed && error.find(":7:") != std::string::npos, ("refused: " + error).c_str());
+
+    out = fopen(path, "w");
+    fprintf(out, "key 105\n");
+    for (int row = 0; row < HEIGHT; row++) {
+        fprintf(out, "................................\n");
+    }
+    fclose(out);
+    parsed = anim_Parse(path, &animation, &error);
+    check(!parsed, ("refused: " + error).c_str());
+    remove(path);
+}
+
+int main() {
+    arduino_Boot();
+    stripLatched = latched;
+    char line[128];
+
+    printf("animations.h against the sources\n");
+    std::vector<Animation> sources(COMPILED_COUNT);
+    for (size_t i = 0; i < COMPILED_COUNT; i++) {
+        std::string error;
+        sources[i].name = anim_Name(compiled[i].source);
+        bool parsed = anim_Parse(compiled[i].source, &sources[i], &error);
+        bool same = parsed && sources[i].records.size() == compiled[i].size &&
+                    memcmp(sources[i].records.data(), compiled[i].records, compiled[i].size) == 0;
+        snprintf(line, sizeof(line), "%s: %s", sources[i].name.c_str(),
+                 !parsed ? error.c_str() : same ? "up to date" : "differs, run make animations");
+        check(same, line);
+        snprintf(line, sizeof(line), "%s: %d frame records in flash, %zu frames in the source",
+                 sources[i].name.c_str(), recordCount(compiled[i].records), sources[i].frames.size());
+        check(recordCount(compiled[i].records) == (int)sources[i].frames.size(), line);
+    }
+    check(COMPILED_COUNT == ANIM_COUNT, "every animation in animations[] is checked");
+
+    printf("played once on a clear screen\n");
+    for (size_t i = 0; i < COMPILED_COUNT; i++) {
+        testPlay(i, sources[i]);
+    }
+
+    printf("flash\n");
+    printf("  animation  frames  bytes  whole frames\n");
+    size_t total = ANIM_COUNT * 2;             // the table, pointers are 2 bytes on the AVR
+    for (size_t i = 0; i < COMPILED_COUNT; i++) {
+        size_t whole = sources[i].frames.size() * (3 + NUM_LEDS / 2) + 1;    // packed, 2 leds a byte
+        printf("  %-9s  %6zu  %5zu  %12zu\n", sources[i].name.c_str(), sources[i].frames.size(),
+               compiled[i].size, whole);
+        total += compiled[i].size;
+    }
+    snprintf(line, sizeof(line), "%zu bytes with the table, ANIM_FLASH_BUDGET is %d", total, ANIM_FLASH_BUDGET);
+    check(total <= ANIM_FLASH_BUDGET, line);
+
+    testMalformed();
+    return checkSummary();
+}
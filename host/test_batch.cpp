@@ -0,0 +1,256 @@
+// Batch frames (0x06) from the PIC's encoder through the sketch's decoder:
+// a refresh encoded with i2c_BeginBatch and the i2c_Put functions splits
+// back into exactly the commands the old protocol sent one by one, draws
+// the same screen, and is shown once; a truncated batch changes nothing.
+// The leaderboard's 0x0E lane bests from every lane draw the lane with the
+// top score and that score, as the text and score commands would.
+// Then the bus bytes and transactions per refresh, batch against the old
+// protocol of one transaction per command.
+
+#include "arduino_firmware.h"
+
+#define _XTAL_FREQ 32000000
+#include <xc.h>
+#include "i2c_arduino.h"
+#include "check.h"
+
+struct Refresh {
+    bool clear;
+    char top[9];
+    char bottom[9];
+    bool score;
+    uint16_t number;
+    uint8_t color;
+    bool balls;
+    uint8_t ballCount;
+};
+
+void randomText(char* text) {
+    const char characters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789?_ ";
+    int length = rand() % 9;
+    for (int i = 0; i < length; i++) {
+        text[i] = characters[rand() % (sizeof(characters) - 1)];
+    }
+    text[length] = '\0';
+}
+
+Refresh randomRefresh() {
+    Refresh r;
+    memset(&r, 0, sizeof(r));
+    r.clear = rand() % 4 == 0;
+    if (rand() % 2) randomText(r.top);
+    if (rand() % 2) randomText(r.bottom);
+    r.score = rand() % 4 != 0;
+    r.number = rand() % 65536;
+    r.color = rand() % 8;
+    r.balls = rand() % 2;
+    r.ballCount = rand() % 11;
+    return r;
+}
+
+// the commands of a refresh, in the order they are applied
+// each goes into its own frame, the way the old protocol sent them
+int encodeSingles(const Refresh& r, I2cFrame* frames) {
+    int count = 0;
+    if (r.clear) i2c_PutClear(&frames[count++]);
+    if (r.top[0]) i2c_PutText(&frames[count++], 0x01, 1, r.top);
+    if (r.bottom[0]) i2c_PutText(&frames[count++], 0x02, 2, r.bottom);
+    if (r.score) i2c_PutScore(&frames[count++], r.number, r.color);
+    if (r.balls) i2c_PutBalls(&frames[count++], r.ballCount);
+    return count;
+}
+
+// the same refresh as one batch, through the PIC's queue
+I2cFrame encodeBatch(const Refresh& r) {
+    I2cFrame* frame = i2c_BeginBatch(I2C_CHANNEL_LANE);
+    if (r.clear) i2c_PutClear(frame);
+    if (r.top[0]) i2c_PutText(frame, 0x01, 1, r.top);
+    if (r.bottom[0]) i2c_PutText(frame, 0x02, 2, r.bottom);
+    if (r.score) i2c_PutScore(frame, r.number, r.color);
+    if (r.balls) i2c_PutBalls(frame, r.ballCount);
+    return *frame;          // Never committed, the next batch takes the same slot
+}
+
+void snapshot(byte* copy) {
+    memcpy(copy, leds, sizeof(leds));
+}
+
+void testRoundTrip() {
+    printf("round trip\n");
+    const int refreshes = 5000;
+    int truncated = 0;
+    for (int n = 0; n < refreshes; n++) {
+        Refresh r = randomRefresh();
+        I2cFrame singles[5];
+        memset(singles, 0, sizeof(singles));
+        int count = encodeSingles(r, singles);
+        I2cFrame batch = encodeBatch(r);
+        checkQuietly(batch.length <= BUFFER_SIZE, "a refresh fits the Wire buffer");
+
+        // The decoder splits the batch into exactly the single commands
+        int offset = 1;
+        for (int i = 0; i < count; i++) {
+            int size = commandLength(batch.data + offset, batch.length - offset);
+            checkQuietly(size == singles[i].length && memcmp(batch.data + offset, singles[i].data, size) == 0,
+                         "the batch holds each command as the old protocol sent it");
+            offset += size;
+        }
+        checkQuietly(offset == batch.length, "nothing left over after the last command");
+
+        // A batch cut short anywhere but between two commands is dropped whole
+        if (batch.length > 2 && rand() % 4 == 0) {
+            uint8_t cut = 1 + rand() % (batch.length - 1);
+            bool boundary = false;
+            for (int i = 0, at = 1; i <= count; i++) {
+                boundary |= (cut == at);
+                if (i < count) at += singles[i].length;
+            }
+            if (!boundary) {
+                byte before[sizeof(leds)];
+                snapshot(before);
+                unsigned int malformed = rxMalformed;
+                arduino_Send(batch.data, cut);
+                arduino_RunMs(40);
+                checkQuietly(rxMalformed == malformed + 1, "a truncated batch is counted malformed");
+                checkQuietly(memcmp(before, leds, sizeof(leds)) == 0, "a truncated batch changes nothing");
+                truncated++;
+            }
+        }
+
+        // The batch is drawn and shown once
+        unsigned long shownBefore = framesShown;
+        unsigned int malformed = rxMalformed;
+        arduino_Send(batch.data, batch.length);
+        arduino_RunMs(2 * FRAME_INTERVAL_MS);
+        checkQuietly(rxMalformed == malformed, "a whole batch is accepted");
+        checkQuietly(framesShown - shownBefore <= 1, "a batch is shown at most once");
+        byte afterBatch[sizeof(leds)];
+        snapshot(afterBatch);
+
+        // The same commands one by one change nothing more: the batch drew what they draw
+        for (int i = 0; i < count; i++) {
+            arduino_Send(singles[i].data, singles[i].length);
+        }
+        arduino_RunMs(2 * FRAME_INTERVAL_MS);
+        checkQuietly(memcmp(afterBatch, leds, sizeof(leds)) == 0,
+                     "the batch draws the same screen as the single commands");
+        if (failures > 0) {
+            printf("  refresh %d: clear %d top \"%s\" bottom \"%s\" score %d %u balls %d %u\n", n,
+                   r.clear, r.top, r.bottom, r.score, r.number, r.balls, r.ballCount);
+            return;
+        }
+    }
+    check(stripTorn == 0, "no torn frame");
+    printf("  %d refreshes, %d truncated batches\n", refreshes, truncated);
+}
+
+// Every lane sends its best as it goes up, in any order. After each the
+// board must show the same screen as a clear, "LANE n" and the top score.
+void testLeaderboard() {
+    printf("leaderboard over %d lanes\n", LANES_MAX);
+    uint16_t best[LANES_MAX] = {0};
+    int wrong = 0;
+    for (int n = 0; n < 2000; n++) {
+        uint8_t lane = rand() % LANES_MAX;
+        best[lane] += rand() % 200;
+        I2cFrame* frame = i2c_BeginBatch(I2C_CHANNEL_LEADERBOARD);
+        i2c_PutClear(frame);
+        i2c_PutLaneBest(frame, lane, best[lane]);
+        arduino_Send(frame->data, frame->length);
+        arduino_RunMs(2 * FRAME_INTERVAL_MS);
+        byte aggregate[sizeof(leds)];
+        snapshot(aggregate);
+
+        uint8_t leader = 0;
+        for (uint8_t i = 1; i < LANES_MAX; i++) {
+            leader = (best[i] > best[leader]) ? i : leader;
+        }
+        char text[] = "LANE 1";
+        text[5] = '1' + leader;
+        frame = i2c_BeginBatch(I2C_CHANNEL_LEADERBOARD);
+        i2c_PutClear(frame);
+        i2c_PutText(frame, 0x01, LEADER_COLOR, text);
+        i2c_PutScore(frame, best[leader], LEADER_COLOR);
+        arduino_Send(frame->data, frame->length);
+        arduino_RunMs(2 * FRAME_INTERVAL_MS);
+        wrong += memcmp(aggregate, leds, sizeof(leds)) != 0;
+    }
+    char line[80];
+    snprintf(line, sizeof(line), "%d of 2000 lane bests drew a different leader", wrong);
+    check(wrong == 0, line);
+    uint8_t lane[] = {0x0E, LANES_MAX, 0xFF, 0xFF};
+    byte before[sizeof(leds)];
+    snapshot(before);
+    arduino_Send(lane, sizeof(lane));
+    arduino_RunMs(2 * FRAME_INTERVAL_MS);
+    check(memcmp(before, leds, sizeof(leds)) == 0, "a lane past LANES_MAX is ignored");
+}
+
+// Bus cost of a refresh: a start, the address byte, the payload, and a
+// stop per transaction, a byte is 9 bit times and a start or stop one.
+struct Cost {
+    int transactions;
+    int bytes;
+};
+
+int busBits(Cost c) {
+    return c.transactions * 2 + c.bytes * 9;
+}
+
+// old protocol: text 0x01/0x02 color length chars, score 0x03 high low,
+// balls 0x04 count, clear 0x05, each in its own transaction
+Cost oldCost(const Refresh& r) {
+    Cost c = {0, 0};
+    if (r.clear) { c.transactions++; c.bytes += 1 + 1; }
+    if (r.top[0]) { c.transactions++; c.bytes += 1 + 3 + (int)strlen(r.top); }
+    if (r.bottom[0]) { c.transactions++; c.bytes += 1 + 3 + (int)strlen(r.bottom); }
+    if (r.score) { c.transactions++; c.bytes += 1 + 3; }
+    if (r.balls) { c.transactions++; c.bytes += 1 + 2; }
+    return c;
+}
+
+Cost batchCost(const Refresh& r) {
+    I2cFrame batch = encodeBatch(r);
+    return Cost{1, 1 + batch.length};
+}
+
+void bench(const char* name, const Refresh& r) {
+    Cost old = oldCost(r);
+    Cost batch = batchCost(r);
+    printf("  %-28s old %d tx %3d bytes %4d bits   batch %d tx %3d bytes %4d bits (%.0f us at %lu Hz)\n",
+           name, old.transactions, old.bytes, busBits(old), batch.transactions, batch.bytes, busBits(batch),
+           busBits(batch) * 1e6 / I2C_BUS_HZ, (unsigned long)I2C_BUS_HZ);
+    check(batch.transactions < old.transactions || old.transactions <= 1, "fewer transactions");
+    check(busBits(batch) <= busBits(old), "no more bus time");
+}
+
+void testBench() {
+    printf("bus cost per refresh\n");
+    Refresh play = {};
+    strcpy(play.bottom, "SCORE");
+    play.score = true;
+    play.number = 12345;
+    play.color = 3;
+    play.balls = true;
+    play.ballCount = 7;
+    bench("score, balls and text", play);
+    Refresh full = play;
+    full.clear = true;
+    strcpy(full.top, "PLAYER 1");
+    bench("clear and everything", full);
+    Refresh end = {};
+    end.clear = true;
+    strcpy(end.top, "GAME");
+    strcpy(end.bottom, "____OVER");
+    bench("end screen", end);
+}
+
+int main() {
+    arduino_Boot();
+    i2c_Init();
+    srand(3);
+    testRoundTrip();
+    testLeaderboard();
+    testBench();
+    return checkSummary();
+}
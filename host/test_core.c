@@ -0,0 +1,124 @@
+// The game core (../game_core.h) driven with no hardware, built without
+// the shim so a register in it would not compile:
+//   a whole game through the state table: start, scoring, lockout, the
+//     end screens, reverse play and a new start
+//   the Monte Carlo players (montecarlo.h): the same results on 1 and 4
+//     threads, a player who always hits 100 always wins, a rattling ball
+//     is held off by the lockout and scores twice without it, and the
+//     mean score is what the chances say when the lockout never bites
+
+#include <stdio.h>
+#include <math.h>
+#include "montecarlo.h"
+#include "check.h"
+
+void testStates(void) {
+    printf("a game through the state table\n");
+    GameCore game;
+    unsigned long ms = MC_START_MS;
+    core_Init(&game, &gameRules);
+    check(game.state == STATE_NEW_GAME, "power up waits for a new game");
+    check(core_Hit(&game, &gameRules, 3, ms) == 0 && game.state == STATE_NEW_GAME,
+          "a hit before the start does nothing");
+    check(core_Start(&game, &gameRules) == CORE_NEW_STATE && game.state == STATE_ACTIVE_GAME &&
+          game.score == 0 && game.balls == gameRules.ballsPerGame, "start begins a fresh game");
+    check(core_Start(&game, &gameRules) == 0, "start during a game does nothing");
+
+    ms += gameRules.lockoutMs + 1;
+    check(core_Hit(&game, &gameRules, 3, ms) == CORE_SCORED && game.score == 100 &&
+          game.balls == gameRules.ballsPerGame - 1, "a hit scores its target's points and uses a ball");
+    check(core_Hit(&game, &gameRules, 3, ms + gameRules.lockoutMs) == 0 && game.score == 100,
+          "the same target inside the lockout does not score");
+    check(core_Hit(&game, &gameRules, 2, ms + 10) == CORE_SCORED && game.score == 150,
+          "another target scores inside the first one's lockout");
+    check(core_Hit(&game, &gameRules, CORE_TARGETS, ms) == 0, "a target out of range is ignored");
+
+    int early = 0;
+    while (game.balls > 0) {
+        ms += gameRules.lockoutMs + 1;
+        core_Hit(&game, &gameRules, 0, ms);
+        early += (game.balls > 0 && core_Update(&game, &gameRules) != 0);
+    }
+    check(early == 0, "no change of state while balls are left");
+    check(core_Update(&game, &gameRules) == CORE_NEW_STATE, "the last ball changes it");
+    check(game.state == STATE_END_GAME && game.score == 150 + 8 * 5, "the last ball under the win score ends it");
+
+    ms += gameRules.lockoutMs + 1;
+    check(core_Hit(&game, &gameRules, 1, ms) == (CORE_SCORED | CORE_NEW_STATE) &&
+          game.state == STATE_REVERSE_GAME && game.score == 180 && game.balls == 1,
+          "a hit on the end screen starts reverse play and takes its points back");
+    while (game.state == STATE_REVERSE_GAME) {
+        ms += gameRules.lockoutMs + 1;
+        core_Hit(&game, &gameRules, 3, ms);
+        core_Update(&game, &gameRules);
+    }
+    check(game.state == STATE_REVERSE_RESULT && game.score == 0 && game.balls == 3,
+          "reverse play ends when the score is gone");
+    check(core_Start(&game, &gameRules) == CORE_NEW_STATE && game.state == STATE_ACTIVE_GAME &&
+          game.score == 0 && game.balls == gameRules.ballsPerGame, "start from the result begins a fresh game");
+
+    while (game.balls > 0) {
+        ms += gameRules.lockoutMs + 1;
+        core_Hit(&game, &gameRules, 3, ms);
+    }
+    core_Update(&game, &gameRules);
+    check(game.state == STATE_WIN_GAME && game.score == 1000, "ten 100s win");
+    check(core_Start(&game, &gameRules) == CORE_NEW_STATE && game.state == STATE_NEW_GAME,
+          "start from the end screen goes back to new game");
+}
+
+int sameResult(const McResult* a, const McResult* b) {
+    return a->games == b->games && a->wins == b->wins && a->throws == b->throws &&
+           a->lockedOut == b->lockedOut && a->scoreSum == b->scoreSum &&
+           memcmp(a->scores, b->scores, (a->scoreMax + 1) * sizeof(unsigned long)) == 0;
+}
+
+// plays games with model under rules on threads into result
+void play(const McModel* model, const GameRules* rules, int games, int threads, McResult* result) {
+    mc_ResultInit(result, rules);
+    mc_Run(model, rules, games, threads, 17, result);
+}
+
+void testMonteCarlo(void) {
+    printf("Monte Carlo players\n");
+    char line[120];
+    McResult one, four;
+    play(&mcModels[2], &gameRules, 20000, 1, &one);
+    play(&mcModels[2], &gameRules, 20000, 4, &four);
+    snprintf(line, sizeof(line), "%s on 1 and 4 threads: the same %lu wins and score spread",
+             mcModels[2].name, one.wins);
+    check(sameResult(&one, &four) && one.games == 20000, line);
+    mc_ResultFree(&one);
+    mc_ResultFree(&four);
+
+    McModel perfect = {"perfect", {0, 0, 0, 1}, 1500, 2000, 0};
+    play(&perfect, &gameRules, 1000, 2, &one);
+    check(one.wins == 1000 && one.scores[1000] == 1000 && one.throws == 10000, "always 100: every game won on 1000");
+    mc_ResultFree(&one);
+
+    McModel rattling = {"rattling", {0.25, 0.25, 0.25, 0.25}, 1500, 2000, 1};
+    play(&rattling, &gameRules, 1000, 2, &one);
+    snprintf(line, sizeof(line), "every ball rattles: %llu rattles, %llu held off by the lockout",
+             (unsigned long long)one.rattles, (unsigned long long)one.lockedOut);
+    check(one.rattles > 0 && one.lockedOut == one.rattles && one.throws == 10000, line);
+    mc_ResultFree(&one);
+    GameRules noLockout = gameRules;
+    noLockout.lockoutMs = 0;
+    play(&rattling, &noLockout, 1000, 2, &one);
+    check(one.lockedOut == 0 && one.throws == 5000, "without the lockout each rattle scores a ball");
+    mc_ResultFree(&one);
+
+    McModel steady = {"steady", {0.2, 0.3, 0.3, 0.1}, 1100, 3000, 0};
+    play(&steady, &gameRules, 100000, 2, &one);
+    double expected = gameRules.ballsPerGame * (0.2 * 5 + 0.3 * 10 + 0.3 * 50 + 0.1 * 100) / 0.9;
+    double mean = (double)one.scoreSum / one.games;
+    snprintf(line, sizeof(line), "mean score %.2f, expected %.2f", mean, expected);
+    check(fabs(mean - expected) < expected * 0.01 && one.lockedOut == 0 && one.unfinished == 0, line);
+    mc_ResultFree(&one);
+}
+
+int main(void) {
+    testStates();
+    testMonteCarlo();
+    return checkSummary();
+}
@@ -0,0 +1,224 @@
+// The Timer0 debouncer fed bouncing switches. Each switch gets its own
+// waveform, all five at once, so the bit-parallel counters are exercised
+// together. A waveform is a list of edges in us: a press starts at the
+// first contact, bounces, settles closed, is held, then bounces open.
+// Checked for every press:
+//   it is detected exactly once
+//   it is detected within 4ms of the contact settling (4 agreeing samples)
+// and over all of them no press is seen that was not made: release
+// bounce, glitches on an open line and dropouts on a closed one are
+// shorter than 3ms and must never get through.
+
+#include <stdio.h>
+#include <stdint.h>
+
+void recordPress(uint8_t pressed);
+#define TRACE_SWITCH(pressed, time) recordPress(pressed)
+#include "pic_firmware.h"
+#include "check.h"
+
+#define SWITCHES 5
+#define MAX_EDGES 4096
+#define MAX_PRESSES 512
+#define US 1000ULL
+
+const uint8_t switchBits[SWITCHES] = {EVENT_RB7, EVENT_RA0, EVENT_RA1, EVENT_RA4, EVENT_START};
+const char* switchNames[SWITCHES] = {"RB7", "RA0", "RA1", "RA4", "RC7"};
+
+typedef struct {
+    uint64_t at;        // ns
+    uint8_t closed;
+} Edge;
+
+typedef struct {
+    uint64_t contact;   // first contact, ns
+    uint64_t settled;   // last edge of the press bounce, closed from here on
+    uint64_t seen;      // when the debouncer reported it, 0 if not yet
+} Press;
+
+typedef struct {
+    Edge edges[MAX_EDGES];
+    int edgeCount;
+    int next;
+    Press presses[MAX_PRESSES];
+    int pressCount;
+    unsigned long falsePresses;
+    uint64_t end;       // ns, the line is open from here on
+} Line;
+
+Line lines[SWITCHES];
+
+void addEdge(Line* line, uint64_t at, uint8_t closed) {
+    if (line->edgeCount < MAX_EDGES) {
+        line->edges[line->edgeCount].at = at;
+        line->edges[line->edgeCount].closed = closed;
+        line->edgeCount++;
+    }
+    line->end = at;
+}
+
+// Presses shaped after typical scope traces of the kinds of switch on a
+// cabinet, edges in us from first contact, closed on even entries:
+// a clean microswitch, a lever switch that chatters, and a worn leaf
+// switch that bounces for almost 3ms
+const uint16_t shapes[][16] = {
+    {0, 40, 90, 120, 0},
+    {0, 15, 60, 110, 180, 230, 260, 400, 470, 490, 0},
+    {0, 300, 700, 1100, 1300, 2000, 2150, 2900, 0},
+};
+#define SHAPE_COUNT (sizeof(shapes) / sizeof(shapes[0]))
+
+// bounce: count edges alternating from closing, each 20-800us apart
+uint64_t bounce(Line* line, uint64_t at, uint8_t closing, int count) {
+    for (int i = 0; i < count; i++) {
+        addEdge(line, at, (i & 1) ? !closing : closing);
+        at += (20 + rand() % 780) * US;
+    }
+    addEdge(line, at, closing);
+    return at;
+}
+
+// one press from at: bounce closed, hold, bounce open, rest
+uint64_t addPress(Line* line, uint64_t at, int shape) {
+    Press* press = &line->presses[line->pressCount++];
+    press->contact = at;
+    press->seen = 0;
+    if (shape >= 0) {
+        const uint16_t* edges = shapes[shape];
+        int i = 0;
+        do {
+            addEdge(line, at + edges[i] * US, !(i & 1));
+            i++;
+        } while (edges[i] != 0);
+        at += edges[i - 1] * US;
+        if (line->edges[line->edgeCount - 1].closed == 0) {
+            at += 10 * US;
+            addEdge(line, at, 1);
+        }
+    } else {
+        at = bounce(line, at, 1, rand() % 16);
+    }
+    press->settled = at;
+
+    // held 20-200ms, a dropout shorter than 3ms now and then
+    uint64_t release = at + (20 + rand() % 180) * PIC_MS;
+    if (rand() % 4 == 0) {
+        uint64_t dropout = at + 10 * PIC_MS + rand() % (5 * PIC_MS);
+        addEdge(line, dropout, 0);
+        addEdge(line, dropout + (50 + rand() % 2900) * US, 1);
+    }
+    at = bounce(line, release, 0, rand() % 12);
+
+    // open 30-300ms, a glitch shorter than 3ms now and then
+    uint64_t rest = at + (30 + rand() % 270) * PIC_MS;
+    if (rand() % 4 == 0) {
+        uint64_t glitch = at + 10 * PIC_MS + rand() % (5 * PIC_MS);
+        addEdge(line, glitch, 1);
+        addEdge(line, glitch + (50 + rand() % 2900) * US, 0);
+    }
+    return rest;
+}
+
+void recordPress(uint8_t pressed) {
+    for (int s = 0; s < SWITCHES; s++) {
+        if (!(pressed & switchBits[s])) {
+            continue;
+        }
+        Line* line = &lines[s];
+        // the press under way, the latest one to have started
+        Press* match = NULL;
+        for (int i = 0; i < line->pressCount && line->presses[i].contact <= picNanos; i++) {
+            match = &line->presses[i];
+        }
+        if (match == NULL || match->seen != 0) {
+            line->falsePresses++;
+        } else {
+            match->seen = picNanos;
+        }
+    }
+}
+
+// plays every line's edges in time order
+void play(void) {
+    for (;;) {
+        int first = -1;
+        for (int s = 0; s < SWITCHES; s++) {
+            Line* line = &lines[s];
+            if (line->next < line->edgeCount &&
+                (first < 0 || line->edges[line->next].at < lines[first].edges[lines[first].next].at)) {
+                first = s;
+            }
+        }
+        if (first < 0) {
+            break;
+        }
+        Edge* edge = &lines[first].edges[lines[first].next++];
+        if (edge->at > picNanos) {
+            pic_Run(edge->at - picNanos);
+        }
+        pic_Switches(switchBits[first], edge->closed);
+    }
+    pic_RunMs(100);
+}
+
+int main(void) {
+    srand(7);
+    pic_Boot();
+    pic_RunMs(100);
+    uint64_t start = picNanos;
+
+    for (int s = 0; s < SWITCHES; s++) {
+        uint64_t at = start + s * 337 * US;     // out of step with each other and the tick
+        for (int p = 0; p < 200; p++) {
+            int shape = (p < 3 * (int)SHAPE_COUNT) ? p % (int)SHAPE_COUNT : -1;
+            at = addPress(&lines[s], at, shape);
+        }
+    }
+    play();
+
+    uint64_t worst = 0;
+    uint64_t total = 0;
+    unsigned long presses = 0;
+    printf("switch  presses  missed  false  latency after settling: mean  max (us)\n");
+    for (int s = 0; s < SWITCHES; s++) {
+        Line* line = &lines[s];
+        unsigned long missed = 0;
+        uint64_t lineWorst = 0;
+        uint64_t lineTotal = 0;
+        for (int i = 0; i < line->pressCount; i++) {
+            Press* press = &line->presses[i];
+            if (press->seen == 0) {
+                missed++;
+                continue;
+            }
+            uint64_t latency = press->seen - press->settled;
+            if (press->seen < press->settled) {
+                latency = 0;        // seen before the last bounce, it never opened for long
+            }
+            lineTotal += latency;
+            if (latency > lineWorst) {
+                lineWorst = latency;
+            }
+            if (press->seen - press->contact < 3 * PIC_MS || latency > 4 * PIC_MS) {
+                printf("  FAIL %s press %d seen %llu us after contact, %llu us after settling\n",
+                       switchNames[s], i, (unsigned long long)((press->seen - press->contact) / US),
+                       (unsigned long long)(latency / US));
+                failures++;
+            }
+        }
+        unsigned long seen = line->pressCount - missed;
+        printf("%-6s  %7d  %6lu  %5lu  %31.0f  %4llu\n", switchNames[s], line->pressCount, missed,
+               line->falsePresses, seen ? (double)lineTotal / seen / US : 0.0,
+               (unsigned long long)(lineWorst / US));
+        failures += missed + line->falsePresses;
+        presses += seen;
+        total += lineTotal;
+        if (lineWorst > worst) {
+            worst = lineWorst;
+        }
+    }
+    printf("all: %lu presses, mean %.0f us, max %llu us after settling\n",
+           presses, presses ? (double)total / presses / US : 0.0, (unsigned long long)(worst / US));
+
+    return checkSummary();
+}
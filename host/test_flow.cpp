@@ -0,0 +1,211 @@
+// Flow control between the PIC and the sketch:
+//   the status block says busy exactly while show() is running: every
+//     read that lands in a show's interrupt windows has STATUS_BUSY set,
+//     every read between shows has it clear
+//   a write the master finishes in the middle of a show: its stop
+//     interrupt, which copies the whole frame, waits for the show to end
+//     instead of running in a window and cutting the show short
+//   millis() across shows forced out with interrupts off: the Timer0
+//     overflows the core's interrupt misses are made up by the sketch
+//   refresh latency with credits against the fixed waits they replaced:
+//     the joined sim (sim.h) plays the same games with the PIC reading
+//     the status and sending on credits, then built to wait a fixed 10ms
+//     (the first queue) and 50ms (the blind delay before it) after every
+//     frame. Two frames more are queued before every hit (sim --load), as
+//     a busier display would send. With credits a frame must reach the
+//     sketch sooner at p95 and at worst, a hit must reach the leds sooner
+//     on average, and no frame may be lost
+// The sims are the build/sim* programs, run from here.
+
+#include "arduino_firmware.h"
+#include "check.h"
+
+#define SIM_GAMES "5"
+#define SIM_LOAD "2"
+
+// status reads in the middle of a show, and between shows
+unsigned long readsInShow = 0;
+unsigned long busyInShow = 0;
+unsigned long readsBetween = 0;
+unsigned long busyBetween = 0;
+
+// the master reads the status whenever the sketch lets interrupts in
+void readStatus(void) {
+    uint8_t status[STATUS_SIZE];
+    wire_Request(SLAVE_ADDRESS, status, STATUS_SIZE);
+    bool busy = status[1] & STATUS_BUSY;
+    if (stripCount > 0 && stripCount < STRIP_BYTES) {
+        readsInShow++;
+        busyInShow += busy;
+    } else if (stripCount == 0) {
+        readsBetween++;
+        busyBetween += busy;
+    }
+}
+
+void testBusyFlag() {
+    printf("busy flag around show()\n");
+    arduino_Boot();
+    arduinoBus = readStatus;
+    for (uint16_t score = 1; score <= 50; score++) {
+        uint8_t frame[] = {0x0C, (uint8_t)(score >> 8), (uint8_t)score, 3};
+        arduino_Send(frame, sizeof(frame));
+        arduino_RunMs(30);
+    }
+    arduinoBus = NULL;
+    char line[120];
+    snprintf(line, sizeof(line), "%lu of %lu reads inside a show said busy", busyInShow, readsInShow);
+    check(readsInShow > 0 && busyInShow == readsInShow, line);
+    snprintf(line, sizeof(line), "%lu of %lu reads between shows said busy", busyBetween, readsBetween);
+    check(readsBetween > 0 && busyBetween == 0, line);
+}
+
+// the master writes a full frame in the middle of every show
+unsigned long writesInShow = 0;
+
+void writeInShow(void) {
+    if (stripCount > 0 && stripCount < STRIP_BYTES && !(TWCR & _BV(TWINT))) {
+        uint8_t frame[WIRE_BUFFER] = {0x0D, WIRE_BUFFER - 2};   // a master page
+        wire_Receive(SLAVE_ADDRESS, frame, sizeof(frame));
+        writesInShow++;
+    }
+}
+
+void testWriteInShow() {
+    printf("writes finishing inside a show\n");
+    uint64_t stopNs = WIRE_STOP_NS + WIRE_BUFFER * WIRE_STOP_BYTE_NS;
+    char line[120];
+    snprintf(line, sizeof(line), "the stop of a %d byte write takes %llu us, a window at most %d",
+             WIRE_BUFFER, (unsigned long long)stopNs / 1000, WS2812_WINDOW_TICKS * 4);
+    check(stopNs > WS2812_WINDOW_TICKS * 4000ULL, line);
+    arduino_Boot();
+    unsigned int aborted = showAborted;
+    unsigned int received = rxFrames;
+    unsigned long shown = framesShown;
+    arduinoBus = writeInShow;
+    const int scores = 50;
+    for (uint16_t score = 1; score <= scores; score++) {
+        uint8_t frame[] = {0x0C, (uint8_t)(score >> 8), (uint8_t)score, 3};
+        arduino_Send(frame, sizeof(frame));
+        arduino_RunMs(30);
+    }
+    arduinoBus = NULL;
+    arduino_RunMs(10);
+    snprintf(line, sizeof(line), "%lu shows, %lu writes in them, %u shows cut short, %lu torn",
+             framesShown - shown, writesInShow, showAborted - aborted, stripTorn);
+    check(writesInShow > 0 && writesInShow == framesShown - shown && showAborted == aborted && stripTorn == 0,
+          line);
+    check((unsigned)(rxFrames - received) == scores + writesInShow, "every write received");
+}
+
+void testMillis() {
+    printf("millis() across forced shows\n");
+    arduino_Boot();
+    unsigned long shown = framesShown;
+    PINC = _BV(PC5);             // SDA held low, the bus never goes quiet
+    const int scores = 100;
+    for (uint16_t score = 1; score <= scores; score++) {
+        uint8_t frame[] = {0x0C, (uint8_t)(score >> 8), (uint8_t)score, 3};
+        arduino_Send(frame, sizeof(frame));
+        arduino_RunMs(100);
+    }
+    PINC = _BV(PC4) | _BV(PC5);
+    unsigned long forced = framesShown - shown;
+    long drift = (long)millis() - (long)(arduinoNanos / 1000000);
+    char line[120];
+    snprintf(line, sizeof(line), "%lu forced shows, %lu Timer0 overflows the core missed, millis() off by %ld ms",
+             forced, timer0Missed, drift);
+    check(forced >= scores && timer0Missed >= forced * 6 && drift >= -1 && drift <= 1, line);
+    long microsDrift = (long)micros() - (long)(arduinoNanos / 1000);
+    snprintf(line, sizeof(line), "micros() off by %ld us", microsDrift);
+    check(microsDrift > -1000 && microsDrift < 1000, line);
+}
+
+struct SimResult {
+    bool ran;
+    int hits;
+    double median;                // switch to led, ms
+    double p95;
+    double max;
+    double mean;
+    double frameMedian;           // frame queued on the PIC to processed by the sketch, ms
+    double frameP95;
+    double frameMax;
+    double busy;                  // % of the time the bus was in use while playing
+    unsigned received;
+    unsigned dropped;
+};
+
+// runs a sim and picks its numbers out of the report
+SimResult runSim(const char* program) {
+    SimResult r;
+    memset(&r, 0, sizeof(r));
+    char command[160];
+    snprintf(command, sizeof(command), "build/%s --games " SIM_GAMES " --load " SIM_LOAD, program);
+    FILE* out = popen(command, "r");
+    if (out == NULL) {
+        return r;
+    }
+    char line[256];
+    int found = 0;
+    while (fgets(line, sizeof(line), out) != NULL) {
+        double min;
+        int frames;
+        unsigned latched, changed, torn, aborted;
+        const char* play = strstr(line, "play + end");
+        if (play != NULL && sscanf(strstr(play, "bus"), "bus %lf", &r.busy) == 1) {
+            found++;
+        }
+        if (sscanf(line, "  switch to led latency over %d hits: min %lf ms, median %lf ms, p95 %lf ms, max %lf ms, mean %lf",
+                   &r.hits, &min, &r.median, &r.p95, &r.max, &r.mean) == 6) {
+            found++;
+        }
+        if (sscanf(line, "  frame latency over %d frames: median %lf ms, p95 %lf ms, max %lf ms", &frames,
+                   &r.frameMedian, &r.frameP95, &r.frameMax) == 4) {
+            found++;
+        }
+        if (sscanf(line, "  frames: %u latched, %u changed, %u torn, %u shows aborted, %u received, %u dropped",
+                   &latched, &changed, &torn, &aborted, &r.received, &r.dropped) == 6) {
+            found++;
+        }
+    }
+    pclose(out);
+    r.ran = (found == 4);
+    return r;
+}
+
+void testLatency() {
+    printf("latency, " SIM_GAMES " games each with " SIM_LOAD " frames more before every hit\n");
+    const char* programs[] = {"sim", "sim_gap10", "sim_gap50"};
+    const char* names[] = {"credits", "fixed 10ms", "fixed 50ms"};
+    SimResult results[3];
+    for (int i = 0; i < 3; i++) {
+        results[i] = runSim(programs[i]);
+        const SimResult& r = results[i];
+        printf("  %-10s frames: median %5.1f p95 %5.1f max %5.1f ms; switch to led over %d hits: "
+               "mean %5.1f p95 %5.1f max %5.1f ms; bus %4.2f%% busy, %u frames, %u dropped\n",
+               names[i], r.frameMedian, r.frameP95, r.frameMax, r.hits, r.mean, r.p95, r.max, r.busy, r.received,
+               r.dropped);
+    }
+    check(results[0].ran && results[1].ran && results[2].ran, "every sim ran and reported");
+    const SimResult& credits = results[0];
+    char line[120];
+    for (int i = 1; i < 3; i++) {
+        const SimResult& fixed = results[i];
+        snprintf(line, sizeof(line), "frames sooner than %s: p95 %.1f against %.1f ms, max %.1f against %.1f ms",
+                 names[i], credits.frameP95, fixed.frameP95, credits.frameMax, fixed.frameMax);
+        check(credits.frameP95 < fixed.frameP95 && credits.frameMax < fixed.frameMax, line);
+        snprintf(line, sizeof(line), "hits sooner than %s: mean %.1f against %.1f ms", names[i], credits.mean,
+                 fixed.mean);
+        check(credits.mean < fixed.mean && credits.hits == fixed.hits, line);
+    }
+    check(credits.dropped == 0, "no frame dropped with credits");
+}
+
+int main() {
+    testBusyFlag();
+    testWriteInShow();
+    testMillis();
+    testLatency();
+    return checkSummary();
+}
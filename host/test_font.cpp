@@ -0,0 +1,129 @@
+// The bitmask font and computed position layout against the renderer they
+// replaced (reference_renderer.h): every character, on both rows, at every
+// position, in every text color, must light exactly the same leds in the
+// same color. Then random row writes, and the memory the tables take.
+
+#include "arduino_firmware.h"
+#include "reference_renderer.h"
+#include "check.h"
+
+// the sketch's leds[] in the colors they are shown in
+bool sameAsReference() {
+    for (int led = 0; led < NUM_LEDS; led++) {
+        CRGB color = paletteColors[getPixel(leds, led)];
+        CRGB expected = refLeds[led];
+        if (color.r != expected.r || color.g != expected.g || color.b != expected.b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void sendText(char command, int color, const char* text) {
+    uint8_t frame[3 + 8];
+    uint8_t length = strlen(text);
+    frame[0] = command;
+    frame[1] = color;
+    frame[2] = length;
+    memcpy(frame + 3, text, length);
+    arduino_Send(frame, 3 + length);
+}
+
+void clearBoth() {
+    uint8_t clear = 0x05;
+    arduino_Send(&clear, 1);
+    ref_Clear();
+}
+
+// every character the old font had, blanks, and some it never drew
+const char characters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789? !:@az";
+
+void testEveryCharacter() {
+    printf("every character, row, position and color\n");
+    int cases = 0;
+    for (const char* c = characters; *c; c++) {
+        for (char command = 0x01; command <= 0x02; command++) {
+            for (int position = 0; position < 8; position++) {
+                for (int color = 1; color <= 7; color++) {
+                    // One character in a row of '_', which leaves the other positions alone
+                    char text[9] = "________";
+                    text[position] = *c;
+                    clearBoth();
+                    sendText(command, color, text);
+                    ref_Text(command, color, text);
+                    arduino_Run(ARDUINO_PASS_NS);
+                    cases++;
+                    if (!sameAsReference()) {
+                        printf("  FAIL '%c' row %d position %d color %d\n", *c, command, position, color);
+                        failures++;
+                    }
+                }
+            }
+        }
+    }
+    printf("  %d cases\n", cases);
+}
+
+// random texts written over each other on one row at a time: the new text
+// replaces the old position by position, a space erases and '_' keeps
+void testRowWrites() {
+    printf("random writes on one row\n");
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789?_ ";
+    int writes = 0;
+    for (char command = 0x01; command <= 0x02; command++) {
+        clearBoth();
+        for (int n = 0; n < 2000; n++) {
+            char text[9];
+            int length = 1 + rand() % 8;
+            for (int i = 0; i < length; i++) {
+                text[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+            }
+            text[length] = '\0';
+            int color = 1 + rand() % 7;
+            sendText(command, color, text);
+            ref_Text(command, color, text);
+            arduino_Run(ARDUINO_PASS_NS);
+            writes++;
+            if (!sameAsReference()) {
+                printf("  FAIL row %d write %d \"%s\" color %d\n", command, n, text, color);
+                failures++;
+                break;
+            }
+        }
+    }
+    printf("  %d writes\n", writes);
+}
+
+// Memory the font and layout take, with the AVR's 2 byte int.
+// The old position maps and ball leds were plain int arrays, so they were
+// in RAM. The first bitmask font kept two 15 byte offset tables in flash
+// for the positions; now a position is worked out from its row and
+// column, so there is no table at all.
+void report() {
+    int oldGlyphBytes = 0;
+    for (const RefGlyph& glyph : refFont) {
+        int pixels = 0;
+        while (glyph.pixels[pixels] >= 0) pixels++;
+        oldGlyphBytes += 2 * pixels + 2;    // the int list and its int count
+    }
+    int oldMapBytes = 2 * 8 * REF_MAP_SIZE * 2 + 2 * 8 * 2;   // 16 int maps and two tables of pointers
+    int oldBallBytes = 2 * (int)(sizeof(refBallLeds) / sizeof(refBallLeds[0]));
+    int newFontBytes = sizeof(font);
+    int newBallBytes = sizeof(ballLeds);
+    printf("memory\n");
+    printf("  old: font %d bytes flash, position maps %d and ball leds %d bytes RAM\n", oldGlyphBytes,
+           oldMapBytes, oldBallBytes);
+    printf("  new: font %d and ball leds %d bytes flash, positions computed, 0 bytes RAM\n", newFontBytes,
+           newBallBytes);
+    printf("  saved: %d bytes flash, %d bytes RAM\n", oldGlyphBytes - newFontBytes - newBallBytes,
+           oldMapBytes + oldBallBytes);
+}
+
+int main() {
+    srand(5);
+    arduino_Boot();
+    testEveryCharacter();
+    testRowWrites();
+    report();
+    return checkSummary();
+}
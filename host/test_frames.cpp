@@ -0,0 +1,202 @@
+// The sketch's frame scheduler: commands are drawn into leds[] as they
+// come and the strip is pushed at most MAX_FPS times a second.
+//   a burst of updates inside one frame window is shown once, the rest
+//     counted in framesCoalesced
+//   a steady stream faster than MAX_FPS is shown at MAX_FPS, never two
+//     frames closer than FRAME_INTERVAL_MS
+//   a screen sent as several commands (clear, then the redraw) is never
+//     latched half drawn when the commands come within a frame window
+//   while the bus is busy the show waits, then goes out as soon as it is
+//     quiet, or after SHOW_MAX_DEFER_MS however busy it stays
+
+#include "arduino_firmware.h"
+#include "check.h"
+
+// every latch, with its time
+#define MAX_LATCHES 4096
+uint64_t latchTimes[MAX_LATCHES];
+int latchCount = 0;
+int halfDrawn = 0;          // latches that were none of the screens sent
+bool watchScreens = false;
+
+// the strip as each whole screen shows it, one per score
+#define SCREENS 16
+uint8_t screens[SCREENS][STRIP_BYTES];
+
+void latched() {
+    if (latchCount < MAX_LATCHES) {
+        latchTimes[latchCount++] = stripLatchedAt;
+    }
+    if (watchScreens) {
+        bool whole = false;
+        for (int s = 0; s < SCREENS && !whole; s++) {
+            whole = memcmp(stripFrame, screens[s], STRIP_BYTES) == 0;
+        }
+        halfDrawn += !whole;
+    }
+}
+
+// a screen as the PIC draws it: clear, the label, the score and the balls
+int screenCommands(int score, uint8_t commands[4][8], uint8_t lengths[4]) {
+    const uint8_t clear[] = {0x05};
+    const uint8_t label[] = {0x01, 1, 5, 'S', 'C', 'O', 'R', 'E'};
+    const uint8_t number[] = {0x03, 0, (uint8_t)(score * 10)};
+    const uint8_t balls[] = {0x04, (uint8_t)(10 - score % 10)};
+    memcpy(commands[0], clear, lengths[0] = sizeof(clear));
+    memcpy(commands[1], label, lengths[1] = sizeof(label));
+    memcpy(commands[2], number, lengths[2] = sizeof(number));
+    memcpy(commands[3], balls, lengths[3] = sizeof(balls));
+    return 4;
+}
+
+// sends a whole screen, one command per frame, ms apart
+void sendScreen(int score, uint32_t ms) {
+    uint8_t commands[4][8];
+    uint8_t lengths[4];
+    int count = screenCommands(score, commands, lengths);
+    for (int i = 0; i < count; i++) {
+        arduino_Send(commands[i], lengths[i]);
+        arduino_RunMs(ms);
+    }
+}
+
+// runs until the strip latches its next frame, at most a second
+void untilLatched() {
+    arduino_RunUntilShown(1000);
+}
+
+// waits until nothing is pending and the frame interval has passed
+void settle() {
+    arduino_RunMs(2 * FRAME_INTERVAL_MS + SHOW_MAX_DEFER_MS);
+}
+
+void testBurst() {
+    printf("a burst inside one frame window\n");
+    settle();
+    sendScreen(8, 0);                // not the screen shown now
+    untilLatched();
+    unsigned long shown = framesShown;
+    unsigned long coalesced = framesCoalesced;
+    int latches = latchCount;
+    // 20 updates, one every 1ms, the first one right after a show
+    for (int i = 0; i < 5; i++) {
+        sendScreen(i, 1);
+    }
+    settle();
+    char line[128];
+    snprintf(line, sizeof(line), "20 updates: %lu shown, %lu coalesced, %d latched",
+             framesShown - shown, framesCoalesced - coalesced, latchCount - latches);
+    check(framesShown - shown == 1 && framesCoalesced - coalesced == 19 && latchCount - latches == 1, line);
+    check(memcmp(stripFrame, screens[4], STRIP_BYTES) == 0, "the strip shows the last screen");
+}
+
+void testStream() {
+    printf("a stream of updates faster than MAX_FPS\n");
+    settle();
+    unsigned long shown = framesShown;
+    unsigned long coalesced = framesCoalesced;
+    int first = latchCount;
+    uint64_t start = arduinoNanos;
+    const int updates = 1000;       // one every 2ms
+    for (int i = 0; i < updates / 4; i++) {
+        sendScreen(i % SCREENS, 2);
+    }
+    double seconds = (arduinoNanos - start) / 1e9;
+    settle();
+    uint64_t closest = UINT64_MAX;
+    for (int i = first + 1; i < latchCount; i++) {
+        closest = min(closest, latchTimes[i] - latchTimes[i - 1]);
+    }
+    unsigned long frames = framesShown - shown;
+    char line[128];
+    snprintf(line, sizeof(line), "%d updates in %.1f s: %lu shown (%.1f fps), %lu coalesced", updates, seconds,
+             frames, frames / seconds, framesCoalesced - coalesced);
+    check(frames <= seconds * MAX_FPS + 2 && frames + (framesCoalesced - coalesced) == (unsigned long)updates, line);
+    snprintf(line, sizeof(line), "closest two frames %.1f ms apart, FRAME_INTERVAL_MS is %d",
+             closest / 1e6, FRAME_INTERVAL_MS);
+    check(closest >= FRAME_INTERVAL_MS * 1000000ULL, line);
+}
+
+// each screen's commands land 1ms apart, the first just after a show.
+// After a quiet spell the first update goes out at once, so a screen that
+// must never be seen half drawn after one is sent as a batch (0x06)
+void testWholeScreens() {
+    printf("screens sent as separate commands\n");
+    settle();
+    sendScreen(8, 0);                // not the screen shown now
+    untilLatched();
+    halfDrawn = 0;
+    watchScreens = true;
+    int first = latchCount;
+    for (int i = 0; i < 200; i++) {
+        sendScreen(i % SCREENS, 1);
+        untilLatched();
+    }
+    settle();
+    watchScreens = false;
+    char line[128];
+    snprintf(line, sizeof(line), "%d latches, %d of them half drawn", latchCount - first, halfDrawn);
+    check(halfDrawn == 0, line);
+}
+
+// how long after the update the next show started, with the bus held busy for busyMs
+#define SHOW_NS (STRIP_BYTES * STRIP_BYTE_NS + STRIP_LATCH_NS)
+double showDelay(uint32_t busyMs) {
+    settle();
+    int before = latchCount;
+    uint64_t start = arduinoNanos;
+    PINC = _BV(PC5);                // SDA low, a transaction on the bus
+    sendScreen(0, 0);
+    while (arduinoNanos - start < busyMs * 1000000ULL && latchCount == before) {
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    PINC = _BV(PC4) | _BV(PC5);
+    while (latchCount == before) {
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    sendScreen(1, 0);               // back to a different screen for the next run
+    return (latchTimes[before] - SHOW_NS - start) / 1e6;
+}
+
+void testBusyBus() {
+    printf("the show waits for the bus\n");
+    double quiet = showDelay(0);
+    double busy = showDelay(20);
+    double stuck = showDelay(1000);
+    char line[128];
+    snprintf(line, sizeof(line), "bus quiet: shown after %.2f ms", quiet);
+    check(quiet < 1, line);
+    snprintf(line, sizeof(line), "bus busy 20ms: shown %.2f ms after the update", busy);
+    check(busy >= 20 && busy < 21, line);
+    snprintf(line, sizeof(line), "bus never quiet: shown after %.2f ms, SHOW_MAX_DEFER_MS is %d",
+             stuck, SHOW_MAX_DEFER_MS);
+    check(stuck >= SHOW_MAX_DEFER_MS - 1 && stuck < SHOW_MAX_DEFER_MS + 10, line);
+}
+
+int main() {
+    arduino_Boot();
+    stripLatched = latched;
+
+    // each screen sent as one batch, so it can only ever be shown whole
+    for (int s = 0; s < SCREENS; s++) {
+        uint8_t commands[4][8];
+        uint8_t lengths[4];
+        uint8_t batch[1 + 4 * 8];
+        uint8_t length = 0;
+        batch[length++] = 0x06;
+        for (int i = 0; i < screenCommands(s, commands, lengths); i++) {
+            memcpy(batch + length, commands[i], lengths[i]);
+            length += lengths[i];
+        }
+        arduino_Send(batch, length);
+        settle();
+        memcpy(screens[s], stripFrame, STRIP_BYTES);
+    }
+
+    testBurst();
+    testStream();
+    testWholeScreens();
+    testBusyBus();
+    printf("show() took %u us at most, %u runs cut short\n", showDurationMax, showAborted);
+    return checkSummary();
+}
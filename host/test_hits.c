@@ -0,0 +1,125 @@
+// The hit queue between the Timer0 tick and the main loop, under load:
+//   every target pressed as fast as the debouncer lets it, nothing is lost
+//   a burst while the main loop is held up fills the queue, the rest are
+//     counted as overflows and the queued ones keep their order and times
+//   lockout is judged on when a hit happened, not when it was scored,
+//     so it holds to the ms however late the main loop gets to it
+
+#include <stdio.h>
+#include <stdint.h>
+#include "pic_firmware.h"
+#include "check.h"
+
+const uint8_t targets[CORE_TARGETS] = {EVENT_RB7, EVENT_RA0, EVENT_RA1, EVENT_RA4};
+unsigned long totalHits(void) {
+    unsigned long total = 0;
+    for (uint8_t i = 0; i < CORE_TARGETS; i++) {
+        total += hitCount[i];
+    }
+    return total;
+}
+
+// Each target closed 5ms and open 5ms over and over, the fastest a switch
+// can go and still get through the 4ms debouncer, each out of step
+void testFastest(void) {
+    printf("every target at the fastest rate the debouncer allows\n");
+    memset(hitCount, 0, sizeof(hitCount));
+    hitOverflowCount = 0;
+    hitLatencyMax = 0;
+    const uint32_t periods = 2000;
+    for (uint32_t ms = 0; ms < periods * 10; ms++) {
+        for (uint8_t i = 0; i < CORE_TARGETS; i++) {
+            pic_Switches(targets[i], ((ms + 10 - i) % 10) < 5);
+        }
+        pic_RunMs(1);
+    }
+    pic_Switches(EVENT_TARGETS, 0);
+    pic_RunMs(20);
+
+    char line[96];
+    for (uint8_t i = 0; i < CORE_TARGETS; i++) {
+        snprintf(line, sizeof(line), "target %d: %u hits of %lu pressed", i, hitCount[i], (unsigned long)periods);
+        check(hitCount[i] == periods, line);
+    }
+    snprintf(line, sizeof(line), "%u overflows, longest hit to score %u ms", hitOverflowCount, hitLatencyMax);
+    check(hitOverflowCount == 0 && hitLatencyMax <= 1, line);
+    printf("  %.0f hits/s\n", CORE_TARGETS * periods / (periods * 10 / 1000.0));
+}
+
+// More hits than the queue holds while the main loop is stuck
+void testBurst(void) {
+    printf("burst while the main loop is held up\n");
+    memset(hitCount, 0, sizeof(hitCount));
+    hitOverflowCount = 0;
+    hitLatencyMax = 0;
+    const int burst = 20;
+    uint8_t expected[HIT_QUEUE_SIZE];
+    unsigned long times[HIT_QUEUE_SIZE];
+    int queued = 0;
+
+    picMainPass = NULL;
+    for (int n = 0; n < burst; n++) {
+        uint8_t target = (n * 3) % CORE_TARGETS;
+        uint8_t before = hitHead;
+        pic_Press(targets[target], 5);
+        pic_RunMs(5);
+        if (hitHead != before && queued < HIT_QUEUE_SIZE) {
+            expected[queued] = target;
+            times[queued] = hitQueue[before].time;
+            queued++;
+        }
+    }
+    // the queue as the main loop will find it
+    int inOrder = 1;
+    uint8_t slot = hitTail;
+    for (int i = 0; i < queued; i++, slot = (slot + 1) & (HIT_QUEUE_SIZE - 1)) {
+        inOrder &= hitQueue[slot].target == expected[i] && (i == 0 || times[i] - times[i - 1] == 10);
+    }
+    picMainPass = pic_MainPass;
+    pic_RunMs(5);
+
+    char line[96];
+    snprintf(line, sizeof(line), "%lu taken off the queue, %u overflows, of %d", totalHits(), hitOverflowCount, burst);
+    check(totalHits() == HIT_QUEUE_SIZE - 1 && hitOverflowCount == burst - (HIT_QUEUE_SIZE - 1), line);
+    check(inOrder, "queued hits kept their order and were timed 10ms apart");
+    snprintf(line, sizeof(line), "longest hit to score %u ms", hitLatencyMax);
+    check(hitLatencyMax >= (burst - 1) * 10, line);
+}
+
+// Two hits on each of two targets while the main loop is held up, the
+// second 1ms past the lockout on one and right on it on the other, all
+// scored together once the main loop runs again
+void testLockout(void) {
+    printf("lockout judged on the hit times\n");
+    pic_Press(EVENT_START, 10);
+    pic_RunMs(100);
+    check(game.state == STATE_ACTIVE_GAME, "game started");
+    int16_t score = game.score;
+
+    picMainPass = NULL;
+    pic_Press(targets[0] | targets[1], 5);
+    pic_RunMs(gameRules.lockoutMs - 5);
+    pic_Switches(targets[1], 1);           // exactly the lockout after its first hit
+    pic_RunMs(1);
+    pic_Switches(targets[0], 1);           // 1ms past it
+    pic_RunMs(5);
+    pic_Switches(targets[0] | targets[1], 0);
+    pic_RunMs(5);
+    uint8_t waiting = (hitHead - hitTail) & (HIT_QUEUE_SIZE - 1);
+    picMainPass = pic_MainPass;
+    pic_RunMs(5);
+
+    char line[96];
+    int16_t expected = 2 * gameRules.points[0] + gameRules.points[1];
+    snprintf(line, sizeof(line), "%d hits waited, scored %d, expected %d", waiting, game.score - score, expected);
+    check(waiting == 4 && game.score - score == expected, line);
+}
+
+int main(void) {
+    pic_Boot();
+    pic_RunMs(100);
+    testFastest();
+    testBurst();
+    testLockout();
+    return checkSummary();
+}
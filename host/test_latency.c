@@ -0,0 +1,195 @@
+// Worst-case input latency of the PIC firmware: the time from a switch
+// closing to the game reacting to it, over many games played with the
+// display traffic on the bus, the high scores being saved between games
+// and the presses landing at every phase of the 1ms tick.
+//   target hit    switch closed to the score changing
+//   start button  switch closed to the next state being entered
+// No task blocks, so the bound is the debouncer's 4 samples plus one
+// tick for the input task to run: 5ms, whatever the display is doing.
+// The scheduler's own lateness counter for each task is reported alongside,
+// the most it reached between the telemetry pages that reset it,
+// and the I2C interrupt's profile slot is taken over by the main loop as
+// the telemetry task does, with the MSSP interrupt back on after it.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "pic_firmware.h"
+#include "mssp_host.h"
+#include "check.h"
+
+#define STEP_NS 50000ULL        // the switches are watched at this resolution
+#define LIMIT_NS (5 * PIC_MS)
+#define SHOW_MS 8               // a lane frame keeps the Arduino busy this long
+
+const uint8_t targets[CORE_TARGETS] = {EVENT_RB7, EVENT_RA0, EVENT_RA1, EVENT_RA4};
+
+// Both displays: a ring of 4 frames, each shown in SHOW_MS
+typedef struct {
+    uint8_t pending;
+    uint8_t processed;
+    uint64_t done;
+} Screen;
+
+Screen screens[2];
+
+Screen* screenAt(uint8_t address) {
+    return (address == ARDUINO_ADDRESS) ? &screens[0] : (address == LEADERBOARD_ADDRESS) ? &screens[1] : NULL;
+}
+
+void screen_Process(Screen* screen) {
+    while (screen->pending > 0 && picNanos >= screen->done) {
+        screen->pending--;
+        screen->processed++;
+        screen->done = picNanos + SHOW_MS * PIC_MS;
+    }
+}
+
+uint8_t screenAck(uint8_t address) {
+    return screenAt(address) != NULL;
+}
+
+void screenWrite(uint8_t address, const uint8_t* data, uint8_t length) {
+    Screen* screen = screenAt(address);
+    screen_Process(screen);
+    if (screen->pending++ == 0) {
+        screen->done = picNanos + SHOW_MS * PIC_MS;
+    }
+}
+
+void screenRead(uint8_t address, uint8_t* data, uint8_t length) {
+    Screen* screen = screenAt(address);
+    screen_Process(screen);
+    memset(data, 0, I2C_STATUS_SIZE);
+    data[I2C_STATUS_PROCESSED] = screen->processed;
+    data[I2C_STATUS_FREE] = 4 - screen->pending;
+}
+
+typedef struct {
+    const char* name;
+    unsigned long count;
+    uint64_t total;
+    uint64_t worst;
+} Latency;
+
+Latency hits = {"target hit"};
+Latency starts = {"start button"};
+
+void record(Latency* latency, uint64_t ns) {
+    latency->count++;
+    latency->total += ns;
+    if (ns > latency->worst) {
+        latency->worst = ns;
+    }
+}
+
+// closes the switches at a random point of the tick and returns how long
+// until changed() reports the game reacted, 0 if it never did
+uint64_t pressUntil(uint8_t events, int (*changed)(void)) {
+    pic_Run(rand() % PIC_MS);
+    uint64_t closed = picNanos;
+    pic_Switches(events, 1);
+    uint64_t latency = 0;
+    while (picNanos - closed < 50 * PIC_MS) {
+        pic_Run(STEP_NS);
+        if (latency == 0 && changed()) {
+            latency = picNanos - closed;
+        }
+    }
+    pic_Switches(events, 0);
+    pic_RunMs(10);
+    return latency;
+}
+
+// the scheduler's lateness counters, kept before the telemetry resets them
+uint16_t latenessMax[TASK_COUNT];
+
+void latencyPass(void) {
+    pic_MainPass();
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        latenessMax[i] = (tasks[i].maxLateness > latenessMax[i]) ? tasks[i].maxLateness : latenessMax[i];
+    }
+}
+
+int16_t scoreBefore;
+int stateBefore;
+
+int scoreChanged(void) {
+    return game.score != scoreBefore;
+}
+
+int stateChanged(void) {
+    return game.state != stateBefore;
+}
+
+int main(void) {
+    const int games = 40;
+    srand(9);
+    msspAck = screenAck;
+    msspWrite = screenWrite;
+    msspRead = screenRead;
+    mssp_Attach();
+    pic_Boot();
+    picMainPass = latencyPass;
+    pic_RunMs(500);
+
+    for (int g = 0; g < games; g++) {
+        stateBefore = game.state;
+        uint64_t latency = pressUntil(EVENT_START, stateChanged);
+        if (latency) {
+            record(&starts, latency);
+        }
+        while (game.state == STATE_ACTIVE_GAME) {
+            pic_RunMs(gameRules.lockoutMs + rand() % 1500);
+            scoreBefore = game.score;
+            latency = pressUntil(targets[rand() % CORE_TARGETS], scoreChanged);
+            if (latency) {
+                record(&hits, latency);
+            }
+        }
+        pic_RunMs(2000 + rand() % 3000);   // end screen, the high scores are being saved
+        stateBefore = game.state;
+        latency = pressUntil(EVENT_START, stateChanged);
+        if (latency) {
+            record(&starts, latency);
+        }
+        pic_RunMs(rand() % 2000);
+    }
+
+    double seconds = picNanos / 1e9;
+    printf("%d games in %.0f s, bus busy %.1f%%, %lu EEPROM bytes written\n",
+           games, seconds, 100.0 * msspBusyNs / picNanos, picEepromWrites);
+    printf("input latency       presses  mean (ms)  worst (ms)\n");
+    Latency* all[] = {&hits, &starts};
+    for (int i = 0; i < 2; i++) {
+        Latency* l = all[i];
+        printf("  %-16s  %7lu  %9.2f  %10.2f\n", l->name, l->count,
+               l->count ? l->total / 1e6 / l->count : 0.0, l->worst / 1e6);
+    }
+    for (int i = 0; i < 2; i++) {
+        char line[80];
+        snprintf(line, sizeof(line), "%s within %llu ms", all[i]->name, (unsigned long long)(LIMIT_NS / PIC_MS));
+        check(all[i]->worst <= LIMIT_NS, line);
+    }
+    printf("scheduler           latest start (ms)\n");
+    const char* names[TASK_COUNT] = {"input", "game", "display", "storage", "telemetry"};
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        printf("  %-16s  %17u\n", names[i], latenessMax[i]);
+    }
+    printf("hit queue: longest hit to score %u ms, %u lost\n", hitLatencyMax, hitOverflowCount);
+    check(hits.count >= (unsigned long)games * 5 && starts.count >= (unsigned long)games * 2,
+          "the game reacted to every press");
+    check(latenessMax[0] <= 1 && hitOverflowCount == 0, "the input task kept up");
+    telemetryPage = TELEMETRY_PAGE_COUNTERS;
+    telemetryTask();
+    uint16_t late = 0;
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        late |= tasks[i].maxLateness;
+    }
+    check(late == 0, "a counters page starts the lateness counters again");
+    uint16_t isrSteps = profileIsr.count;
+    profile_TakeIsr();
+    printf("i2c interrupt: %u steps since the last profile page\n", isrSteps);
+    check(isrSteps > 0 && profileTable[PROFILE_I2C_ISR].count == isrSteps && profileIsr.count == 0 &&
+          PIE1bits.SSP1IE, "the interrupt's profile is taken whole");
+    return checkSummary();
+}
@@ -0,0 +1,310 @@
+// Scrolling text (0x08) rendered frame by frame on the virtual clock:
+//   every step of millis() moves the text one column to the left: the strip
+//     latches each step, each frame is the one before shifted by a column,
+//     and it is the reference renderer's characters (reference_renderer.h)
+//     shifted to that column
+//   a looping marquee starts over after WIDTH + length * 4 steps, the text
+//     then all the way off the left edge
+//   one that runs once stops on its last frame and stays on it, over fixed
+//     text on the other row
+//   joined with the PIC (sim_pic.c), the end screen's message scrolls with
+//     no display command on the bus: the lane gets only the telemetry
+//     pages and the status reads that go with them; start held down
+//     starts a tournament, whose banner comes as a general call
+
+#include "arduino_firmware.h"
+#include "reference_renderer.h"
+#include "sim.h"
+#include "check.h"
+
+#define STEP_MS 60            // the PIC's MARQUEE_STEP_MS
+#define COLOR 3
+
+// the led at column x, row y, as the reference's maps lay them out
+int refLed(int x, int y) {
+    return x * 8 + ((x & 1) ? 7 - y : y);
+}
+
+// the strip against refLeds[] at brightness 255
+bool stripIsReference() {
+    for (int led = 0; led < NUM_LEDS; led++) {
+        const uint8_t* grb = stripFrame + 3 * led;
+        if (grb[0] != refLeds[led].g || grb[1] != refLeds[led].r || grb[2] != refLeds[led].b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The message as the reference renderer draws it: each character drawn on
+// the first top position and read back a column at a time, then the gap
+CRGB textColumns[MARQUEE_MAX * 4][5];
+int textWidth = 0;
+
+void refMessage(const char* text) {
+    textWidth = 0;
+    for (const char* c = text; *c; c++) {
+        ref_Clear();
+        ref_Character(*c, refTop[0], ref_ColorSelect(COLOR));
+        for (int x = 0; x < 4; x++, textWidth++) {
+            for (int y = 0; y < 5; y++) {
+                textColumns[textWidth][y] = (x < 3) ? refLeds[refLed(x, y)] : CRGB(CRGB::Black);
+            }
+        }
+    }
+}
+
+// refLeds[] as the screen under the top row marquee with the text moved in
+// offset columns from the right edge
+void refFrame(const CRGB* under, int offset) {
+    memcpy(refLeds, under, sizeof(refLeds));
+    for (int x = 0; x < WIDTH; x++) {
+        int column = offset - WIDTH + x;
+        if (column < 0 || column >= textWidth) {
+            continue;
+        }
+        for (int y = 0; y < 5; y++) {
+            const CRGB& color = textColumns[column][y];
+            if (color.r || color.g || color.b) {
+                refLeds[refLed(x, y)] = color;
+            }
+        }
+    }
+}
+
+void sendMarquee(const char* text, uint8_t flags) {
+    uint8_t frame[BUFFER_SIZE] = {0x08, 0x01, COLOR, STEP_MS, flags, (uint8_t)strlen(text)};
+    memcpy(frame + MARQUEE_HEADER, text, frame[5]);
+    arduino_Send(frame, MARQUEE_HEADER + frame[5]);
+}
+
+void sendClear() {
+    const uint8_t clear[] = {0x05};
+    arduino_Send(clear, sizeof(clear));
+    ref_Clear();
+}
+
+// runs until the top marquee takes its next step, then until the strip
+// shows it if it changed anything; returns the millis() the sketch took
+// the step at, 0 if none came
+unsigned long nextStep() {
+    Marquee* m = &marquees[ROW_TOP];
+    int offset = m->offset;
+    byte length = m->length;
+    unsigned long shown = stripFrames;
+    uint64_t limit = arduinoNanos + 4 * STEP_MS * 1000000ULL;
+    while (m->offset == offset && m->length == length && arduinoNanos < limit) {
+        shown = stripFrames;
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    if (arduinoNanos >= limit) {
+        return 0;
+    }
+    unsigned long at = m->lastStep;
+    if (stripFrames == shown && framePending) {
+        arduino_RunUntilShown(2 * FRAME_INTERVAL_MS);
+    }
+    return at;
+}
+
+// What went wrong over the steps of a marquee, in frames
+struct Scroll {
+    int wrong;          // not the reference shifted to the step's column
+    int unshown;        // changed and not latched by the strip
+    int late;           // not STEP_MS of millis() after the step before
+    int unshifted;      // not the frame before shifted a column to the left
+};
+
+// Steps a marquee through steps frames from its start, checking each
+// against the reference over the screen under it and against the frame
+// before
+Scroll scroll(const char* text, const CRGB* under, int steps) {
+    Scroll s = {0, 0, 0, 0};
+    char before[HEIGHT][WIDTH + 1];
+    arduino_Matrix(before);
+    unsigned long last = marquees[ROW_TOP].lastStep;
+    for (int step = 1; step <= steps; step++) {
+        unsigned long shown = stripFrames;
+        unsigned long at = nextStep();
+        s.late += at == 0 || at - last < STEP_MS || at - last > STEP_MS + 1;
+        last = at;
+        int offset = step % (WIDTH + (int)strlen(text) * 4 + 1);
+        refFrame(under, offset);
+        if (!stripIsReference()) {
+            if (s.wrong == 0) {
+                printf("  step %d, offset %d, differs from the reference\n", step, offset);
+            }
+            s.wrong++;
+        }
+        char now[HEIGHT][WIDTH + 1];
+        arduino_Matrix(now);
+        s.unshown += memcmp(now, before, sizeof(now)) != 0 && stripFrames == shown;
+        for (int y = 0; y < 5 && offset > 0; y++) {
+            s.unshifted += memcmp(now[y], before[y] + 1, WIDTH - 1) != 0;
+        }
+        memcpy(before, now, sizeof(before));
+    }
+    return s;
+}
+
+void testLoop() {
+    printf("looping marquee\n");
+    const char* text = "GAME OVER 1234 HI 5678";
+    const int period = WIDTH + strlen(text) * 4;
+    sendClear();
+    CRGB under[REF_LEDS];
+    memcpy(under, refLeds, sizeof(under));
+    refMessage(text);
+    sendMarquee(text, MARQUEE_LOOP);
+    arduino_RunUntilShown(2 * FRAME_INTERVAL_MS);
+    // twice round, the frame at the wrap and the one after it included
+    Scroll s = scroll(text, under, 2 * (period + 1));
+    char line[120];
+    snprintf(line, sizeof(line), "%d frames, %d differ from the reference shifted to their column", 2 * (period + 1),
+             s.wrong);
+    check(s.wrong == 0, line);
+    check(s.unshown == 0, "the strip latches every step that changes the screen");
+    check(s.unshifted == 0, "each frame is the one before shifted a column to the left");
+    snprintf(line, sizeof(line), "a step every %d ms of millis()", STEP_MS);
+    check(s.late == 0, line);
+    snprintf(line, sizeof(line), "back to the start after WIDTH + length * 4 = %d steps", period);
+    check(marquees[ROW_TOP].length > 0 && marquees[ROW_TOP].offset == 0, line);
+}
+
+void testOnce() {
+    printf("marquee run once\n");
+    const char* text = "GREAT JOB";
+    const int period = WIDTH + strlen(text) * 4;
+    sendClear();
+    const uint8_t bottom[] = {0x02, 2, 6, 'B', 'A', 'L', 'L', ' ', '3'};
+    arduino_Send(bottom, sizeof(bottom));
+    ref_Text(0x02, 2, "BALL 3");
+    CRGB under[REF_LEDS];
+    memcpy(under, refLeds, sizeof(under));
+    refMessage(text);
+    sendMarquee(text, 0);
+    arduino_RunUntilShown(2 * FRAME_INTERVAL_MS);
+    Scroll s = scroll(text, under, period);
+    char line[120];
+    snprintf(line, sizeof(line), "%d frames over the bottom text, %d differ from the reference", period, s.wrong);
+    check(s.wrong == 0 && s.unshown == 0 && s.late == 0, line);
+    unsigned long stopped = nextStep();
+    unsigned long shown = stripFrames;
+    uint8_t last[STRIP_BYTES];
+    memcpy(last, stripFrame, sizeof(last));
+    arduino_RunMs(20 * STEP_MS);
+    check(stopped != 0 && marquees[ROW_TOP].length == 0, "it stops after its last step");
+    refFrame(under, period);
+    check(stripIsReference() && memcmp(last, stripFrame, sizeof(last)) == 0,
+          "the strip stays on the last frame, the text gone and the bottom row kept");
+    check(stripFrames == shown, "nothing more is shown");
+}
+
+// The joined simulation: the PIC plays a game to its end screen, whose
+// message the Arduino scrolls by itself
+// The sim has the lane's Arduino only, the leaderboard never answers
+unsigned long laneTransactions = 0;
+unsigned long missingTransactions = 0;   // addressed to the leaderboard and nacked
+unsigned long displayWrites = 0;         // writes to the lane with a display command
+unsigned long telemetryWrites = 0;
+unsigned long statusReads = 0;
+
+uint8_t sim_SlaveAck(uint8_t address) {
+    bool lane = address == Wire.address || (address == 0 && (TWAR & _BV(TWGCE)));
+    laneTransactions += lane;
+    missingTransactions += !lane;
+    return lane;
+}
+
+void sim_SlaveWrite(uint8_t address, const uint8_t* data, uint8_t length) {
+    bool telemetry = data[0] == 0x0D || (data[0] == 0x06 && length > 1 && data[1] == 0x0D);
+    telemetryWrites += telemetry;
+    displayWrites += !telemetry;
+    wire_Receive(address, data, length);
+}
+
+void sim_SlaveRead(uint8_t address, uint8_t* data, uint8_t length) {
+    statusReads++;
+    wire_Request(address, data, length);
+}
+
+void sim_FrameQueued(uint8_t address) {
+}
+
+// the master catches up whenever the sketch lets interrupts in
+void catchUp() {
+    sim_PicRunTo(arduinoNanos);
+    PINC = sim_PicBusActive() ? _BV(PC5) : (_BV(PC4) | _BV(PC5));
+}
+
+void runMs(uint32_t ms) {
+    uint64_t end = arduinoNanos + ms * 1000000ULL;
+    while (arduinoNanos < end) {
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    catchUp();
+}
+
+void press(uint8_t events) {
+    sim_PicRunTo(arduinoNanos);
+    sim_PicSwitches(events, 1);
+    runMs(40);
+    sim_PicSwitches(events, 0);
+}
+
+void testJoined() {
+    printf("end screen with the PIC\n");
+    arduinoBus = catchUp;
+    sim_PicBoot();
+    arduino_Boot();
+    runMs(1000);
+    press(SIM_START);
+    runMs(200);
+    for (int shots = 0; sim_PicState() == 1 && shots < 40; shots++) {
+        runMs(1100 + rand() % 900);
+        press(SIM_TARGET(rand() % 4));
+    }
+    // the end screen's writes are behind it, and the win animation
+    runMs(3000);
+    check(marquees[ROW_TOP].length > 0 && (marquees[ROW_TOP].flags & MARQUEE_LOOP), "the end message scrolls");
+
+    const uint32_t watchMs = 5000;
+    unsigned long writes = displayWrites, pages = telemetryWrites, reads = statusReads;
+    unsigned long lane = laneTransactions, missing = missingTransactions, shown = stripFrames;
+    int steps = 0;
+    for (uint32_t ms = 0; ms < watchMs; ms++) {
+        int offset = marquees[ROW_TOP].offset;
+        runMs(1);
+        steps += marquees[ROW_TOP].offset != offset;
+    }
+    printf("  %u ms: %lu frames shown, %lu transactions to the lane: %lu display writes, %lu telemetry pages, "
+           "%lu status reads; %lu to the missing leaderboard\n",
+           watchMs, stripFrames - shown, laneTransactions - lane, displayWrites - writes, telemetryWrites - pages,
+           statusReads - reads, missingTransactions - missing);
+    char line[120];
+    snprintf(line, sizeof(line), "%d columns scrolled with no display write on the bus", steps);
+    check(displayWrites == writes && steps >= (int)(watchMs / STEP_MS) - 1, line);
+    check(laneTransactions - lane == (telemetryWrites - pages) + (statusReads - reads),
+          "every transaction to the lane meanwhile is a telemetry page or a status read");
+
+    sim_PicRunTo(arduinoNanos);
+    sim_PicSwitches(SIM_START, 1);
+    runMs(2100);
+    sim_PicSwitches(SIM_START, 0);
+    runMs(500);
+    Marquee* m = &marquees[ROW_TOP];
+    check(m->length == 16 && memcmp(m->text, "TOURNAMENT START", 16) == 0 && (m->flags & MARQUEE_LOOP),
+          "start held 2 s scrolls the tournament banner sent as a general call");
+    check(sim_PicState() == 0, "and the lane waits for a new game");
+}
+
+int main() {
+    srand(12);
+    arduino_Boot();
+    const uint8_t brightness[] = {0x0A, 255};
+    arduino_Send(brightness, sizeof(brightness));
+    testLoop();
+    testOnce();
+    testJoined();
+    return checkSummary();
+}
@@ -0,0 +1,582 @@
+// The I2C channel queues of i2c_arduino.h driven by the MSSP model:
+// every frame reaches its slave once, in order and intact, the credits
+// never overrun a slave's ring, and a busy, missing or colliding slave
+// holds up neither the main loop nor the other channels.
+// Built with three more lane scoreboards than a PIC drives, so the round
+// robin is also shown fair over five slaves: saturated lanes get the same
+// share, a lane that keeps its queue full does not delay a quiet one by
+// more than a turn of the others, and a missing lane costs a status read
+// every I2C_MISSING_MS.
+// A general call reaches all five at once: it waits until every slave has
+// taken what was queued before it and has room, so no ring overflows, and
+// a busy slave holds it up while a missing one does not.
+// Built for the 400KHz opt-in, so the queues are checked at the faster rate.
+// Benchmark: full scoreboard refreshes back to back at the 100KHz default
+// and at 400KHz, in refreshes, bytes and transactions a second, and the
+// longest the main loop waited between two passes meanwhile, which must
+// stay within the 1ms tick.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define _XTAL_FREQ 32000000
+#define I2C_ADDRESSES \
+    {ARDUINO_ADDRESS, LEADERBOARD_ADDRESS, LANE_ADDRESS(1), LANE_ADDRESS(2), LANE_ADDRESS(3), I2C_GENERAL_CALL}
+#define I2C_CHANNELS 6
+#define I2C_BUS_HZ 400000UL
+#include <xc.h>
+#include "i2c_arduino.h"
+#include "pic_host.h"
+#include "mssp_host.h"
+#include "display_shadow.h"
+#include "check.h"
+
+#define RING 4               // receive ring of the mock slaves, like the Arduino's
+
+typedef struct {
+    uint8_t address;
+    uint8_t present;
+    uint8_t busy;            // reports I2C_STATUS_BUSY
+    uint32_t processMs;      // ms to process a frame, 0 for at once, UINT32_MAX for never
+    uint8_t pending;         // frames in its ring
+    uint64_t nextProcess;
+    uint8_t processed;
+    uint8_t dropped;         // frames that came with the ring full
+    unsigned long frames;
+    unsigned long expected;  // sequence number of the next frame
+    unsigned long errors;    // frames out of order or damaged
+    unsigned long reads;
+    unsigned long broadcasts; // general call frames taken
+    unsigned long framesBeforeBroadcast;   // its own frames it had taken when the last one came
+    uint64_t latencyMaxNs;   // longest commit to delivery
+} Slave;
+
+Slave slaves[I2C_CHANNELS];              // in channel order, the last one stands for the general call
+unsigned long passes;
+unsigned long sequence[I2C_CHANNELS];    // next frame each producer makes
+unsigned long limit[I2C_CHANNELS];       // frames each producer makes in all
+uint32_t interval[I2C_CHANNELS];         // ms between a producer's frames, 0 for as fast as they are taken
+uint64_t committed[I2C_CHANNELS][I2C_CHANNEL_QUEUE];   // when each frame in the queue was committed
+
+Slave* findSlave(uint8_t address) {
+    for (uint8_t i = 0; i < I2C_CHANNELS; i++) {
+        if (slaves[i].address == address) {
+            return &slaves[i];
+        }
+    }
+    return NULL;
+}
+
+// every slave that is there acks the general call
+uint8_t slaveAck(uint8_t address) {
+    if (address == I2C_GENERAL_CALL) {
+        uint8_t acked = 0;
+        for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+            acked |= slaves[i].present;
+        }
+        return acked;
+    }
+    Slave* slave = findSlave(address);
+    return slave != NULL && slave->present;
+}
+
+// a general call frame takes a slot in the ring of every slave that is there
+uint8_t slaveBroadcast(uint8_t address) {
+    if (address != I2C_GENERAL_CALL) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        Slave* slave = &slaves[i];
+        if (!slave->present) {
+            continue;
+        }
+        if (slave->pending == RING) {
+            slave->dropped++;
+            continue;
+        }
+        if (slave->pending++ == 0) {
+            slave->nextProcess = picNanos + slave->processMs * PIC_MS;
+        }
+        slave->broadcasts++;
+        slave->framesBeforeBroadcast = slave->frames;
+    }
+    return 1;
+}
+
+// a frame is its sequence number then bytes derived from it
+void slaveWrite(uint8_t address, const uint8_t* data, uint8_t length) {
+    if (slaveBroadcast(address)) {
+        return;
+    }
+    Slave* slave = findSlave(address);
+    if (slave->pending == RING) {
+        slave->dropped++;
+        return;
+    }
+    if (slave->pending++ == 0) {
+        slave->nextProcess = picNanos + slave->processMs * PIC_MS;
+    }
+    uint8_t ok = (length == 1 + slave->expected % (I2C_FRAME_MAX - 1)) && data[0] == (uint8_t)slave->expected;
+    for (uint8_t i = 1; ok && i < length; i++) {
+        ok = data[i] == (uint8_t)(slave->expected * 7 + i);
+    }
+    slave->errors += !ok;
+    uint64_t latency = picNanos - committed[slave - slaves][data[0] & (I2C_CHANNEL_QUEUE - 1)];
+    if (latency > slave->latencyMaxNs) {
+        slave->latencyMaxNs = latency;
+    }
+    slave->expected++;
+    slave->frames++;
+}
+
+void slaveRead(uint8_t address, uint8_t* data, uint8_t length) {
+    Slave* slave = findSlave(address);
+    slave->reads++;
+    data[I2C_STATUS_PROCESSED] = slave->processed;
+    data[I2C_STATUS_FLAGS] = slave->busy ? I2C_STATUS_BUSY : 0;
+    data[I2C_STATUS_FREE] = RING - slave->pending;
+    data[I2C_STATUS_DROPPED] = slave->dropped;
+    data[I2C_STATUS_MALFORMED] = 0;
+    data[I2C_STATUS_REJECTED] = 0;
+}
+
+void slaveProcess(Slave* slave) {
+    while (slave->pending > 0 && slave->processMs != UINT32_MAX && picNanos >= slave->nextProcess) {
+        slave->pending--;
+        slave->processed++;
+        slave->nextProcess += slave->processMs * PIC_MS;
+    }
+}
+
+// the main loop: fills every channel as far as it takes frames
+void mainPass(void) {
+    passes++;
+    for (uint8_t channel = 0; channel < I2C_CHANNELS; channel++) {
+        slaveProcess(&slaves[channel]);
+        while (sequence[channel] < limit[channel] && picNanos >= sequence[channel] * interval[channel] * PIC_MS) {
+            I2cFrame* frame = i2c_BeginFrame(channel);
+            if (frame == NULL) {
+                break;
+            }
+            unsigned long n = sequence[channel]++;
+            frame->length = 1 + n % (I2C_FRAME_MAX - 1);
+            frame->data[0] = n;
+            for (uint8_t i = 1; i < frame->length; i++) {
+                frame->data[i] = n * 7 + i;
+            }
+            committed[channel][n & (I2C_CHANNEL_QUEUE - 1)] = picNanos;
+            i2c_CommitFrame(channel);
+        }
+    }
+}
+
+void isr(void) {
+    if (PIR1bits.SSP1IF) {
+        PIR1bits.SSP1IF = 0;
+        i2c_Isr();
+    }
+    if (PIR2bits.BCL1IF) {
+        PIR2bits.BCL1IF = 0;
+        i2c_Collision();
+    }
+    if (INTCONbits.TMR0IF) {
+        INTCONbits.TMR0IF = 0;
+        i2c_Tick();
+    }
+}
+
+void reset(unsigned long laneFrames, unsigned long boardFrames) {
+    pic_PowerUp();
+    memset(i2cChannels, 0, sizeof(i2cChannels));
+    i2cChannel = 0;
+    i2cState = I2C_IDLE;
+    i2cNackCount = i2cCollisionCount = i2cFullCount = 0;
+    memset(slaves, 0, sizeof(slaves));
+    for (uint8_t i = 0; i < I2C_CHANNELS; i++) {
+        slaves[i] = (Slave){.address = i2cAddresses[i], .present = 1};
+    }
+    memset(sequence, 0, sizeof(sequence));
+    memset(limit, 0, sizeof(limit));
+    memset(interval, 0, sizeof(interval));
+    limit[I2C_CHANNEL_LANE] = laneFrames;
+    limit[I2C_CHANNEL_LEADERBOARD] = boardFrames;
+    passes = 0;
+    msspBusyNs = msspStarts = msspWrites = msspReads = msspBytes = 0;
+    msspCollisions = 0;
+    msspAck = slaveAck;
+    msspWrite = slaveWrite;
+    msspRead = slaveRead;
+    mssp_Attach();
+    i2c_Init();
+    INTCONbits.TMR0IE = 1;
+    INTCONbits.GIE = 1;
+    picMainPass = mainPass;
+}
+
+// both slaves take frames as fast as they come
+void testThroughput(void) {
+    printf("throughput at %lu Hz\n", (unsigned long)I2C_BUS_HZ);
+    const unsigned long frames = 2000;
+    reset(frames, 0);
+    uint64_t start = picNanos;
+    while (slaves[0].frames < frames && picNanos < 10000 * PIC_MS) {
+        pic_RunMs(1);
+    }
+    double seconds = (picNanos - start) / 1e9;
+    unsigned long payload = 0;
+    for (unsigned long n = 0; n < frames; n++) {
+        payload += 1 + n % (I2C_FRAME_MAX - 1);
+    }
+    printf("  %lu frames, %lu payload bytes in %.3f s: %.0f frames/s, %.0f bytes/s, bus busy %.0f%%, %lu status reads\n",
+           frames, payload, seconds, frames / seconds, payload / seconds,
+           100.0 * msspBusyNs / (picNanos - start), msspReads);
+    check(slaves[0].frames == frames && slaves[0].errors == 0, "every frame delivered once, in order and intact");
+    check(slaves[0].dropped == 0, "no frame sent to a full ring");
+    check(i2cNackCount == 0 && i2cCollisionCount == 0, "no nack and no collision");
+    // a byte is 9 bit times, 22.5us at 400KHz; the queue should keep the bus
+    // busy, so the payload rate must come within 2x of the raw byte rate
+    check(payload / seconds > I2C_BUS_HZ / 9.0 / 2, "payload rate within 2x of the raw bus rate");
+}
+
+// a slave that processes slowly only ever gets as many frames as it has room for
+void testCredits(void) {
+    printf("credits\n");
+    reset(40, 0);
+    slaves[0].processMs = UINT32_MAX;
+    pic_RunMs(50);
+    check(slaves[0].frames == RING && slaves[0].dropped == 0, "a slave that never processes gets exactly its ring");
+    check(passes >= 50, "the main loop keeps running while the slave is full");
+    slaves[0].processMs = 5;
+    slaves[0].nextProcess = picNanos;
+    pic_RunMs(400);
+    check(slaves[0].frames == 40 && slaves[0].errors == 0, "the rest follows once it processes");
+    check(slaves[0].dropped == 0, "never more frames than free slots");
+}
+
+// a busy slave is polled every I2C_POLL_MS and gets nothing until it is done
+void testBusy(void) {
+    printf("busy slave\n");
+    reset(10, 0);
+    slaves[0].busy = 1;
+    pic_RunMs(100);
+    check(slaves[0].frames == 0, "nothing sent while busy");
+    printf("  %lu status reads in 100 ms\n", slaves[0].reads);
+    check(slaves[0].reads <= 100 / I2C_POLL_MS + 1, "polled no faster than I2C_POLL_MS");
+    check(passes >= 100, "the main loop keeps running");
+    slaves[0].busy = 0;
+    pic_RunMs(20);
+    check(slaves[0].frames == 10 && slaves[0].errors == 0, "everything sent once it is free");
+}
+
+// a missing leaderboard holds up only its own channel
+void testMissing(void) {
+    printf("missing slave\n");
+    reset(200, 200);
+    slaves[1].present = 0;
+    pic_RunMs(500);
+    check(slaves[0].frames == 200 && slaves[0].errors == 0, "the lane gets every frame");
+    check(slaves[1].frames == 0 && i2cNackCount > 0, "the missing slave nacks and gets nothing");
+    check(sequence[I2C_CHANNEL_LEADERBOARD] == I2C_CHANNEL_QUEUE - 1, "its queue fills and stays full");
+    check(i2cFullCount > 0, "further frames for it are refused, not waited for");
+    check(passes >= 500, "the main loop keeps running");
+    slaves[1].present = 1;
+    pic_RunMs(500);
+    check(slaves[1].frames == 200 && slaves[1].errors == 0, "it catches up when it answers again");
+}
+
+// lost arbitration: the frame is sent again, once
+void testCollision(void) {
+    printf("collisions\n");
+    reset(20, 20);
+    msspCollisions = 3;
+    pic_RunMs(200);
+    check(i2cCollisionCount == 3, "every collision seen");
+    check(slaves[0].frames == 20 && slaves[0].errors == 0, "lane frames each delivered once");
+    check(slaves[1].frames == 20 && slaves[1].errors == 0, "leaderboard frames each delivered once");
+}
+
+// the two channels share the bus in turn: the lane takes several frames
+// on one status read and the shared leaderboard one, but both get the same
+// number of transactions
+void testRoundRobin(void) {
+    printf("round robin\n");
+    reset(1000, 1000);
+    pic_RunMs(100);
+    long lane = slaves[0].frames + slaves[0].reads;
+    long board = slaves[1].frames + slaves[1].reads;
+    printf("  lane %lu frames %lu reads, leaderboard %lu frames %lu reads in 100 ms\n", slaves[0].frames,
+           slaves[0].reads, slaves[1].frames, slaves[1].reads);
+    check(lane > 0 && lane - board >= -2 && lane - board <= 2, "both channels get the same share of the bus");
+    check(slaves[1].dropped == 0 && slaves[1].frames <= slaves[1].reads, "one leaderboard frame per status read");
+}
+
+// Jain's index over the frames of some slaves, 1 when they all got the same
+double jain(const uint8_t* channels, uint8_t count) {
+    double sum = 0, squares = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        double frames = slaves[channels[i]].frames;
+        sum += frames;
+        squares += frames * frames;
+    }
+    return squares > 0 ? sum * sum / (count * squares) : 0;
+}
+
+// four lanes and the leaderboard on one master
+void testFairness(void) {
+    printf("fairness over %d slaves\n", I2C_CHANNEL_BROADCAST);
+    char line[120];
+    const uint8_t lanes[] = {0, 2, 3, 4};   // channels of the lane scoreboards
+    reset(0, 0);
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        limit[i] = 100000;
+    }
+    uint64_t start = picNanos;
+    pic_RunMs(500);
+    unsigned long least = ~0UL, most = 0;
+    for (uint8_t i = 0; i < sizeof(lanes); i++) {
+        unsigned long frames = slaves[lanes[i]].frames;
+        least = (frames < least) ? frames : least;
+        most = (frames > most) ? frames : most;
+    }
+    double index = jain(lanes, sizeof(lanes));
+    printf("  saturated: lanes %lu to %lu frames in 500 ms, leaderboard %lu, Jain index %.4f, bus busy %.0f%%\n",
+           least, most, slaves[1].frames, index, 100.0 * msspBusyNs / (picNanos - start));
+    check(most - least <= RING && index > 0.999, "every saturated lane gets the same share");
+    check(slaves[1].frames > 0 && slaves[1].dropped == 0, "the leaderboard is not starved");
+
+    // one lane keeps its queue full, the others send a frame every 20 ms
+    reset(100000, 0);
+    for (uint8_t i = 1; i < sizeof(lanes); i++) {
+        limit[lanes[i]] = 100000;
+        interval[lanes[i]] = 20;
+    }
+    pic_RunMs(1000);
+    uint64_t quiet = 0;
+    for (uint8_t i = 1; i < sizeof(lanes); i++) {
+        Slave* slave = &slaves[lanes[i]];
+        quiet = (slave->latencyMaxNs > quiet) ? slave->latencyMaxNs : quiet;
+        check(slave->frames >= 49 && slave->errors == 0, "a quiet lane gets every frame it sends");
+    }
+    snprintf(line, sizeof(line), "a quiet lane waits at most %.2f ms for the bus while lane 0 sends %lu frames",
+             quiet / 1e6, slaves[0].frames);
+    // a turn of each other channel is one frame of at most 32 bytes, about 0.8 ms at 400KHz
+    check(quiet < I2C_CHANNELS * 9 * (I2C_FRAME_MAX + 2) * 1e9 / I2C_BUS_HZ && slaves[0].frames > 1000, line);
+
+    // a missing lane among saturated ones
+    reset(100000, 0);
+    limit[2] = limit[3] = 100000;
+    slaves[4].present = 0;
+    limit[4] = 100000;
+    pic_RunMs(1000);
+    snprintf(line, sizeof(line), "a missing lane is asked %lu times a second, the others get %lu and %lu frames",
+             (unsigned long)i2cNackCount, slaves[2].frames, slaves[3].frames);
+    check(i2cNackCount <= 1000 / I2C_MISSING_MS + 1 && slaves[2].frames > 500 &&
+          slaves[2].frames - slaves[3].frames + RING <= 2 * RING, line);
+}
+
+// queues a general call frame, returns when it was queued
+uint64_t queueBroadcast(void) {
+    I2cFrame* frame = i2c_BeginBatch(I2C_CHANNEL_BROADCAST);
+    i2c_PutClear(frame);
+    i2c_CommitFrame(I2C_CHANNEL_BROADCAST);
+    return picNanos;
+}
+
+// slaves that took the general call frame
+uint8_t broadcastTaken(void) {
+    uint8_t taken = 0;
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        taken += slaves[i].broadcasts == 1;
+    }
+    return taken;
+}
+
+// frames dropped by a full ring and frames damaged, over all slaves
+unsigned long broadcastErrors(void) {
+    unsigned long errors = 0;
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        errors += slaves[i].dropped + slaves[i].errors;
+    }
+    return errors;
+}
+
+// Every slave gets a frame every 10 ms and takes 8 ms to process one, so
+// the rings are seldom empty when the general call is queued
+void broadcastReset(void) {
+    reset(0, 0);
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        limit[i] = 100000;
+        interval[i] = 10;
+        slaves[i].processMs = 8;
+    }
+}
+
+void testBroadcast(void) {
+    printf("general call over %d slaves\n", I2C_CHANNEL_BROADCAST);
+    char line[120];
+    broadcastReset();
+    pic_RunMs(100);
+    unsigned long before[I2C_CHANNEL_BROADCAST];
+    memcpy(before, sequence, sizeof(before));
+    queueBroadcast();
+    pic_RunMs(100);
+    uint8_t after = 1;
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        after = after && slaves[i].framesBeforeBroadcast == before[i];
+    }
+    snprintf(line, sizeof(line), "%d of %d slaves take it once", broadcastTaken(), I2C_CHANNEL_BROADCAST);
+    check(broadcastTaken() == I2C_CHANNEL_BROADCAST && msspWrites > 0, line);
+    check(after, "each right after the frames queued for it before");
+    check(broadcastErrors() == 0, "no ring overflows and no frame is damaged");
+
+    broadcastReset();
+    slaves[2].busy = 1;
+    pic_RunMs(100);
+    memcpy(before, sequence, sizeof(before));
+    queueBroadcast();
+    pic_RunMs(100);
+    uint8_t held = 1;
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        held = held && slaves[i].frames <= before[i];
+    }
+    check(broadcastTaken() == 0, "a busy slave holds it up");
+    check(held, "and the others hold back their frames queued after it");
+    slaves[2].busy = 0;
+    uint32_t ms = 0;
+    while (broadcastTaken() < I2C_CHANNEL_BROADCAST && ms < 1000) {
+        pic_RunMs(1);
+        ms++;
+    }
+    after = 1;
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        after = after && slaves[i].framesBeforeBroadcast == before[i];
+    }
+    snprintf(line, sizeof(line), "it goes %u ms after the slave is free, right after the frames queued before it", ms);
+    check(broadcastTaken() == I2C_CHANNEL_BROADCAST && after && ms <= 2 * I2C_POLL_MS + 1, line);
+    pic_RunMs(100);
+    check(broadcastErrors() == 0 && sequence[3] > before[3] + 5, "no ring overflows and the frames after it follow");
+
+    broadcastReset();
+    slaves[4].present = 0;
+    limit[4] = 0;
+    pic_RunMs(100);
+    queueBroadcast();
+    pic_RunMs(200);
+    check(broadcastTaken() == I2C_CHANNEL_BROADCAST - 1 && slaves[4].broadcasts == 0 && broadcastErrors() == 0,
+          "a missing slave does not hold it up");
+}
+
+// Full refreshes: the lane's display cleared and every field sent again,
+// and the lane's best on the leaderboard, queued through display_Flush()
+// as the game does. A new one starts once the last has left the queues.
+unsigned long refreshes;
+unsigned long refreshPayload;
+uint64_t lastPass;          // when the main loop last ran
+uint64_t passGapMaxNs;      // the longest it waited for its next pass
+
+void refreshWrite(uint8_t address, const uint8_t* data, uint8_t length) {
+    if (slaveBroadcast(address)) {
+        return;
+    }
+    Slave* slave = findSlave(address);
+    if (slave->pending == RING) {
+        slave->dropped++;
+        return;
+    }
+    if (slave->pending++ == 0) {
+        slave->nextProcess = picNanos;
+    }
+    slave->frames++;
+    refreshPayload += length;
+}
+
+void refreshPass(void) {
+    passes++;
+    if (picNanos - lastPass > passGapMaxNs) {
+        passGapMaxNs = picNanos - lastPass;
+    }
+    lastPass = picNanos;
+    for (uint8_t channel = 0; channel < I2C_CHANNELS; channel++) {
+        slaveProcess(&slaves[channel]);
+    }
+    uint8_t idle = i2cState == I2C_IDLE;
+    for (uint8_t i = 0; i < DISPLAY_COUNT; i++) {
+        I2cChannel* queue = &i2cChannels[displays[i].channel];
+        idle = idle && displays[i].dirty == 0 && queue->head == queue->tail;
+    }
+    if (idle) {
+        refreshes++;
+        DisplayShadow* lane = &displays[DISPLAY_LANE];
+        display_Clear(lane);
+        display_Top(lane, 2, "PLAYER 1");
+        display_Bottom(lane, 3, "BALL 3");
+        display_Score(lane, 12000 + refreshes % 1000, 3);
+        display_Balls(lane, 3);
+        display_Clear(&displays[DISPLAY_LEADERBOARD]);
+        display_LaneBest(&displays[DISPLAY_LEADERBOARD], 20000 + refreshes % 1000);
+    }
+    display_FlushAll();
+}
+
+typedef struct {
+    double refreshes;        // a second, and so on
+    double bytes;            // clocked on the bus, address bytes included
+    double payload;
+    double transactions;     // writes and status reads
+    double busy;             // % of the time
+    double stallUs;          // longest gap between main loop passes
+} RefreshRate;
+
+RefreshRate refreshRun(unsigned long hz) {
+    reset(0, 0);
+    SSP1ADD = _XTAL_FREQ / (4UL * hz) - 1;
+    msspWrite = refreshWrite;
+    picMainPass = refreshPass;
+    memset(displays, 0, sizeof(displays));
+    display_Init();
+    refreshes = refreshPayload = 0;
+    pic_RunMs(100);             // the first status reads are behind it
+    unsigned long startRefreshes = refreshes, startPayload = refreshPayload, startBytes = msspBytes;
+    unsigned long startTransactions = msspWrites + msspReads;
+    uint64_t startBusy = msspBusyNs;
+    lastPass = picNanos;
+    passGapMaxNs = 0;
+    pic_RunMs(1000);
+    RefreshRate r = {refreshes - startRefreshes, msspBytes - startBytes, refreshPayload - startPayload,
+                     msspWrites + msspReads - startTransactions, (msspBusyNs - startBusy) / 1e7,
+                     passGapMaxNs / 1e3};
+    printf("  %6lu Hz: %6.0f refreshes/s, %6.0f bytes/s (%6.0f payload), %5.0f transactions/s, bus busy %3.0f%%,"
+           " passes %4.0f us apart at most\n",
+           hz, r.refreshes, r.bytes, r.payload, r.transactions, r.busy, r.stallUs);
+    return r;
+}
+
+void testRefresh(void) {
+    printf("full scoreboard refreshes\n");
+    RefreshRate slow = refreshRun(100000);
+    RefreshRate fast = refreshRun(I2C_BUS_HZ);
+    char line[120];
+    snprintf(line, sizeof(line), "%.1fx the refreshes at %lu Hz, %.2f against %.2f ms each",
+             fast.refreshes / slow.refreshes, (unsigned long)I2C_BUS_HZ, 1000 / fast.refreshes, 1000 / slow.refreshes);
+    check(slow.refreshes > 0 && fast.refreshes > 2 * slow.refreshes, line);
+    check(slaves[0].dropped == 0 && slaves[1].dropped == 0 && i2cNackCount == 0, "no frame dropped or nacked");
+    // sent from the main loop and waited on, one refresh would hold it up
+    // for all its bus time
+    snprintf(line, sizeof(line), "main loop passes %.0f and %.0f us apart at most, a refresh takes %.0f us on the bus",
+             slow.stallUs, fast.stallUs, 1e6 / slow.refreshes);
+    check(slow.stallUs <= PIC_MS / 1e3 && fast.stallUs <= PIC_MS / 1e3, line);
+}
+
+int main(void) {
+    testThroughput();
+    testCredits();
+    testBusy();
+    testMissing();
+    testCollision();
+    testRoundRobin();
+    testFairness();
+    testBroadcast();
+    testRefresh();
+    return checkSummary();
+}
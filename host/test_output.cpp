@@ -0,0 +1,317 @@
+// The bytes the sketch clocks out to the strip, expanded from the 4 bit
+// framebuffer through the palette, against the CRGB leds[] the old
+// firmware kept for the same commands (reference_renderer.h):
+//   at brightness 255 every strip byte is the old leds[] in GRB order
+//   at the default brightness every byte is the old leds[] scaled the way
+//     FastLED.setBrightness() scaled it, scale8 without dithering
+// over random runs of the commands the old firmware had: text on either
+// row, the score, the balls and clear.
+// The score, the balls and the two rows of text are layers now (see
+// "Layers" in the sketch), where the old firmware let whichever was drawn
+// last win on the leds they share: the rows share two lines, the balls
+// share the bottom row's first five positions. So the runs are screens as
+// the PIC draws them, where the order never matters. After a clear either
+// a text screen (text on one row: over the shared lines the old firmware
+// showed the row drawn last whole, off pixels too) or a score screen
+// (a label of up to 4 characters, clear of the score's positions, then
+// the score and the balls, no balls with a 4 digit score: its first digit
+// shares leds with the last two balls, which the old firmware blacked out
+// even when they were off).
+// And two bugs are not copied: a score over 9999 lost its last digit, and
+// a score never cleared a digit left on position 3 or 4 by a longer one,
+// so scores stay under 10000 and keep their length until the next clear.
+// Then the layers drawn over each other with no clear between them, leds[]
+// after every step against a frame built here by hand: each layer drawn
+// alone on black by the reference renderer and the layers stacked bottom
+// to top, the lit pixels of a layer covering what is under them. Top text
+// and bottom text share rows 3-4, the score goes over the bottom text, the
+// balls over both and an animation frame over everything; a ' ' written to
+// one row afterwards uncovers the other row's pixels under it.
+
+#include "arduino_firmware.h"
+#include "reference_renderer.h"
+#include "check.h"
+
+// FastLED's scale8(), as setBrightness() applied it to every channel
+uint8_t scale8(uint8_t level, uint8_t scale) {
+    return ((uint16_t)level * (1 + scale)) >> 8;
+}
+
+// the strip against refLeds[] at a brightness, counts the leds that differ
+int compareStrip(uint8_t level) {
+    int wrong = 0;
+    for (int led = 0; led < NUM_LEDS; led++) {
+        const uint8_t* grb = stripFrame + 3 * led;
+        CRGB expected = refLeds[led];
+        wrong += grb[0] != scale8(expected.g, level) || grb[1] != scale8(expected.r, level) ||
+                 grb[2] != scale8(expected.b, level);
+    }
+    return wrong;
+}
+
+void send(const uint8_t* data, uint8_t length) {
+    arduino_Send(data, length);
+    arduino_Run(ARDUINO_PASS_NS);
+}
+
+void sendText(uint8_t command, uint8_t color, const char* text) {
+    uint8_t frame[3 + 8] = {command, color, (uint8_t)strlen(text)};
+    memcpy(frame + 3, text, frame[2]);
+    send(frame, 3 + frame[2]);
+    ref_Text(command, color, text);
+}
+
+int digits(int number) {
+    int count = 1;
+    while (number >= 10) {
+        number /= 10;
+        count++;
+    }
+    return count;
+}
+
+int lastDigits = 0;     // length of the score on screen, 0 after a clear
+uint8_t textRow = 0x01;     // the row a text screen writes
+bool ballsSent = false;
+
+void sendClear() {
+    const uint8_t clear[] = {0x05};
+    send(clear, sizeof(clear));
+    ref_Clear();
+    lastDigits = 0;
+    ballsSent = false;
+}
+
+void sendScore(int number) {
+    uint8_t frame[] = {0x03, (uint8_t)(number >> 8), (uint8_t)number};
+    send(frame, sizeof(frame));
+    ref_Number(number);
+    lastDigits = digits(number);
+}
+
+void sendBalls(int count) {
+    uint8_t frame[] = {0x04, (uint8_t)count};
+    send(frame, sizeof(frame));
+    ref_Balls(count);
+    ballsSent = true;
+}
+
+bool scoreScreen = false;
+
+// one random command of the old set, for the screen being drawn
+void randomCommand() {
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789? _";
+    switch (rand() % 8) {
+        case 0:
+            sendClear();
+            break;
+        case 1:
+        case 2: {
+            char text[9];
+            int length = 1 + rand() % (scoreScreen ? 4 : 8);       // a label clear of the score's positions
+            for (int i = 0; i < length; i++) {
+                text[i] = alphabet[rand() % (sizeof(alphabet) - 1)];
+            }
+            text[length] = '\0';
+            if (lastDigits > 0) {
+                break;          // the label goes before the score, the rows overlap
+            }
+            sendText(scoreScreen ? 0x01 : textRow, rand() % 9, text);   // 0 and 8 are no color
+            break;
+        }
+        case 3:
+        case 4:
+        case 5: {
+            if (!scoreScreen) {
+                break;
+            }
+            int length = lastDigits ? lastDigits : 1 + rand() % (ballsSent ? 3 : 4);
+            int low = 1;
+            for (int i = 1; i < length; i++) {
+                low *= 10;
+            }
+            int number = (length == 1) ? rand() % 10 : low + rand() % (9 * low);
+            sendScore(number);
+            break;
+        }
+        default:
+            if (scoreScreen && lastDigits < 4) {
+                sendBalls(rand() % 12);     // 11 lights all ten
+            }
+            break;
+    }
+}
+
+int run(uint8_t level, int sequences, int length) {
+    const uint8_t brightnessCommand[] = {0x0A, level};
+    send(brightnessCommand, sizeof(brightnessCommand));
+    int wrong = 0;
+    for (int s = 0; s < sequences; s++) {
+        sendClear();
+        scoreScreen = rand() % 2;
+        textRow = 0x01 + rand() % 2;
+        for (int i = 0; i < length; i++) {
+            randomCommand();
+        }
+        arduino_RunMs(2 * FRAME_INTERVAL_MS);
+        int leds = compareStrip(level);
+        if (leds > 0 && wrong == 0) {
+            printf("  first difference in sequence %d, %d leds\n", s, leds);
+        }
+        wrong += leds > 0;
+    }
+    return wrong;
+}
+
+// The layers of the hand built frame, each on black
+CRGB layerTop[REF_LEDS], layerBottom[REF_LEDS], layerScore[REF_LEDS], layerBalls[REF_LEDS], layerOverlay[REF_LEDS];
+CRGB* const layerStack[] = {layerTop, layerBottom, layerScore, layerBalls, layerOverlay};   // bottom to top
+
+bool isLit(const CRGB& color) {
+    return color.r || color.g || color.b;
+}
+
+// refLeds[] as the layers stacked
+void stackLayers() {
+    ref_Clear();
+    for (CRGB* layer : layerStack) {
+        for (int led = 0; led < REF_LEDS; led++) {
+            if (isLit(layer[led])) {
+                refLeds[led] = layer[led];
+            }
+        }
+    }
+}
+
+// leds[] through the palette against the stacked layers, counts the leds that differ
+int compareLeds() {
+    stackLayers();
+    int wrong = 0;
+    for (int led = 0; led < NUM_LEDS; led++) {
+        const CRGB& color = paletteColors[getPixel(leds, led)];
+        wrong += color.r != refLeds[led].r || color.g != refLeds[led].g || color.b != refLeds[led].b;
+    }
+    return wrong;
+}
+
+// a text command, its row's layer updated as the reference draws it
+void layerText(uint8_t command, uint8_t color, const char* text) {
+    CRGB* layer = (command == 0x01) ? layerTop : layerBottom;
+    uint8_t frame[3 + 8] = {command, color, (uint8_t)strlen(text)};
+    memcpy(frame + 3, text, frame[2]);
+    send(frame, 3 + frame[2]);
+    memcpy(refLeds, layer, sizeof(refLeds));
+    ref_Text(command, color, text);
+    memcpy(layer, refLeds, sizeof(refLeds));
+}
+
+// a colored score, right adjusted on the bottom row's last positions
+void layerNumber(uint16_t number, uint8_t color) {
+    uint8_t frame[] = {0x0C, (uint8_t)(number >> 8), (uint8_t)number, color};
+    send(frame, sizeof(frame));
+    char text[6];
+    int length = snprintf(text, sizeof(text), "%u", number);
+    ref_Clear();
+    for (int i = 0; i < length; i++) {
+        ref_Character(text[i], refBottom[8 - length + i], ref_ColorSelect(color));
+    }
+    memcpy(layerScore, refLeds, sizeof(refLeds));
+}
+
+void layerBallCount(uint8_t count) {
+    uint8_t frame[] = {0x04, count};
+    send(frame, sizeof(frame));
+    ref_Clear();
+    ref_Balls(count);
+    memcpy(layerBalls, refLeds, sizeof(refLeds));
+}
+
+// the step's leds[] against the hand built frame
+void checkStep(const char* what) {
+    arduino_RunMs(10);
+    int wrong = compareLeds();
+    char line[96];
+    snprintf(line, sizeof(line), "%s: %d leds differ", what, wrong);
+    check(wrong == 0, line);
+}
+
+// leds in rows 3-4 of columns first to first + count - 1 lit in a color
+int sharedLit(int first, int count, CRGB color) {
+    int n = 0;
+    for (int x = first; x < first + count; x++) {
+        for (int y = 3; y <= 4; y++) {
+            const CRGB& led = paletteColors[getPixel(leds, pixelLed(x, y))];
+            n += led.r == color.r && led.g == color.g && led.b == color.b;
+        }
+    }
+    return n;
+}
+
+void testOverlap() {
+    printf("layers over each other\n");
+    const uint8_t brightnessCommand[] = {0x0A, 255};
+    send(brightnessCommand, sizeof(brightnessCommand));
+    sendClear();
+    for (CRGB* layer : layerStack) {
+        memcpy(layer, refLeds, sizeof(refLeds));    // black after the clear
+    }
+    layerText(0x01, 1, "MWMWMWMW");
+    checkStep("top text, rows 0-4");
+    layerText(0x02, 2, "WMWMWMWM");
+    checkStep("bottom text over it, rows 3-7");
+    layerNumber(8888, 3);
+    checkStep("the score over the bottom text");
+    layerBallCount(7);
+    checkStep("the balls over both");
+
+    // the drain animation: its first frame lights all ten ball leds red,
+    // the next one puts them out, with no keyframe so only lit pixels show
+    const uint8_t drain[] = {0x0B, 1, 1, 0};
+    send(drain, sizeof(drain));
+    for (int i = 0; i < 10; i++) {
+        layerOverlay[refBallLeds[i]] = CRGB::Red;
+    }
+    checkStep("an animation frame over everything");
+    arduino_RunMs(400);
+    for (int i = 0; i < 10; i++) {
+        layerOverlay[refBallLeds[i]] = CRGB::Black;
+    }
+    checkStep("the layers under it once its frames are dark");
+
+    // top positions 0-1 cover columns 0-6, bottom ones 1-7: columns 1-6
+    // have pixels of both on rows 3-4
+    int covered = sharedLit(1, 6, CRGB::Green);
+    layerText(0x02, 2, "  ");
+    checkStep("' ' on the bottom row");
+    char line[96];
+    snprintf(line, sizeof(line), "it uncovers the top text under it, %d to %d green leds on rows 3-4", covered,
+             sharedLit(1, 6, CRGB::Green));
+    check(sharedLit(1, 6, CRGB::Green) > covered, line);
+    layerText(0x02, 2, "WM");
+    covered = sharedLit(1, 6, CRGB::Blue);
+    layerText(0x01, 1, "  ");
+    checkStep("' ' on the top row");
+    check(sharedLit(1, 6, CRGB::Blue) == covered && covered > 0, "the bottom text above it stays");
+}
+
+int main() {
+    srand(13);
+    arduino_Boot();
+    const int sequences = 1500;
+    char line[96];
+
+    printf("strip output against the old leds[]\n");
+    int wrong = run(255, sequences, 12);
+    snprintf(line, sizeof(line), "brightness 255: %d of %d sequences differ", wrong, sequences);
+    check(wrong == 0, line);
+    wrong = run(BRIGHTNESS, sequences, 12);
+    snprintf(line, sizeof(line), "brightness %d: %d of %d sequences differ", BRIGHTNESS, wrong, sequences);
+    check(wrong == 0, line);
+    testOverlap();
+
+    printf("memory\n");
+    printf("  old: CRGB leds[%d], %d bytes RAM\n", NUM_LEDS, NUM_LEDS * 3);
+    printf("  new: leds[] %d bytes, palette %d bytes, output colors %d bytes\n",
+           (int)sizeof(leds), (int)sizeof(paletteColors), (int)sizeof(outputColors));
+    return checkSummary();
+}
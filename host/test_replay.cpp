@@ -0,0 +1,120 @@
+// Trace replay (trace.h, replay.h) over games recorded from the sim
+// (build/games.trace, see the Makefile):
+//   blessed by this build, the trace replays with every check passing
+//   a write changed in the trace shows as mismatches from that write on
+//   a trace cut short replays up to the cut
+//   replay speed: passes of loop() a game, which is what the time goes on,
+//     and games a second
+// The trace is read and written through files in build/.
+
+#include "arduino_firmware.h"
+#include "replay.h"
+#include "check.h"
+#include <time.h>
+
+#define GAMES_TRACE "build/games.trace"
+#define BLESSED_TRACE "build/games.blessed.trace"
+#define CHANGED_TRACE "build/games.changed.trace"
+#define REPLAY_MAX_PASSES_PER_GAME 200    // a pass every ms while something moves would be thousands
+
+double seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+bool replayFile(const char* path, Trace* bless, ReplayStats* stats) {
+    Trace in;
+    if (!trace_Open(&in, path)) {
+        return false;
+    }
+    replay_Trace(&in, bless, stats, NULL);
+    fclose(in.file);
+    return true;
+}
+
+// copies the blessed trace, changing the first score write after skip
+// writes to show score+1, or cutting the trace there when cut is set
+unsigned long copyChanged(unsigned long skip, bool cut) {
+    Trace in, out;
+    trace_Open(&in, BLESSED_TRACE);
+    trace_Create(&out, CHANGED_TRACE);
+    TraceRecord record;
+    unsigned long writes = 0;
+    unsigned long changedAt = 0;
+    while (trace_Get(&in, &record) != TRACE_END) {
+        if (record.type == TRACE_WRITE && writes++ >= skip && changedAt == 0) {
+            uint8_t* data = record.payload + 2;
+            if (cut) {
+                changedAt = writes;
+                break;
+            }
+            // a score (0x03 or 0x0C) on its own or anywhere in a batch (0x06)
+            int length = record.payload[1];
+            int at = (length > 0 && data[0] == 0x06) ? 1 : 0;
+            while (at < length) {
+                int size = commandLength(data + at, length - at);
+                if (size == 0) {
+                    break;
+                }
+                if (data[at] == 0x03 || data[at] == 0x0C) {
+                    data[at + 2]++;
+                    changedAt = writes;
+                    break;
+                }
+                at += (data[0] == 0x06) ? size : length;
+            }
+        }
+        trace_Put(&out, record.type, record.us, record.payload, record.length);
+    }
+    fclose(in.file);
+    if (cut) {
+        fclose(out.file);          // no TRACE_END, as if the recording stopped there
+    } else {
+        trace_Close(&out);
+    }
+    return changedAt;
+}
+
+int main() {
+    char line[160];
+    ReplayStats recorded, blessed, replayed;
+
+    printf("bless and replay %s\n", GAMES_TRACE);
+    Trace bless;
+    trace_Create(&bless, BLESSED_TRACE);
+    bool found = replayFile(GAMES_TRACE, &bless, &recorded);
+    trace_Close(&bless);
+    check(found && recorded.games >= 10 && recorded.writes > 500, "the sim recorded games to replay");
+    snprintf(line, sizeof(line), "%lu games, %lu writes, %lu switch changes, %.0f s of play", recorded.games,
+             recorded.writes, recorded.switches, recorded.us / 1e6);
+    check(recorded.switches >= recorded.games * 2, line);
+
+    double start = seconds();
+    const int rounds = 10;
+    for (int i = 0; i < rounds; i++) {
+        replayFile(BLESSED_TRACE, NULL, &blessed);
+    }
+    double took = (seconds() - start) / rounds;
+    snprintf(line, sizeof(line), "%lu checks, %lu mismatches", blessed.checks, blessed.mismatches);
+    check(blessed.checks == recorded.writes && blessed.mismatches == 0, line);
+    snprintf(line, sizeof(line), "%lu passes of loop() a game, %.0f games/s, %.0fx real time",
+             blessed.passes / blessed.games, blessed.games / took, blessed.us / 1e6 / took);
+    check(blessed.passes <= blessed.games * REPLAY_MAX_PASSES_PER_GAME, line);
+
+    printf("a changed write\n");
+    unsigned long changedAt = copyChanged(recorded.writes / 2, false);
+    replayFile(CHANGED_TRACE, NULL, &replayed);
+    snprintf(line, sizeof(line), "score changed in write %lu: %lu mismatches", changedAt, replayed.mismatches);
+    check(changedAt > 0 && replayed.mismatches > 0, line);
+
+    printf("a trace cut short\n");
+    changedAt = copyChanged(recorded.writes / 3, true);
+    replayFile(CHANGED_TRACE, NULL, &replayed);
+    snprintf(line, sizeof(line), "cut at write %lu: %lu writes replayed, %lu mismatches", changedAt,
+             replayed.writes, replayed.mismatches);
+    check(replayed.writes == changedAt - 1 && replayed.mismatches == 0, line);
+
+    remove(CHANGED_TRACE);
+    return checkSummary();
+}
@@ -0,0 +1,170 @@
+// The receive ring between receiveEvent() and loop(), with a producer
+// thread standing in for the Wire interrupt while the main thread runs
+// loop(). Every frame is a 0x0D master telemetry command carrying its
+// sequence number, which loop() passes on to Serial as it processes it,
+// so the consumer side can be checked for loss, order and torn frames.
+
+#include <pthread.h>
+#include <sched.h>
+#include "arduino_firmware.h"
+#include "check.h"
+
+// frame n: 0x0D, length, then n and bytes made from it
+uint8_t makeFrame(unsigned n, uint8_t* data) {
+    uint8_t length = 2 + n % (BUFFER_SIZE - 4);
+    data[0] = 0x0D;
+    data[1] = length;
+    data[2] = n;
+    data[3] = n >> 8;
+    for (uint8_t i = 2; i < length; i++) {
+        data[2 + i] = n * 13 + i;
+    }
+    return 2 + length;
+}
+
+// the Wire interrupt: the bytes land in the Wire buffer, then receiveEvent()
+void interrupt(const uint8_t* data, uint8_t length) {
+    memcpy(Wire.rx, data, length);
+    Wire.rxLength = length;
+    Wire.rxIndex = 0;
+    receiveEvent(length);
+}
+
+struct Producer {
+    unsigned frames;
+    bool flowControl;            // only send while the status block says there is room
+    volatile unsigned sent;
+    volatile bool done;
+};
+
+void* produce(void* argument) {
+    Producer* p = (Producer*)argument;
+    uint8_t data[BUFFER_SIZE];
+    for (unsigned n = 0; n < p->frames; n++) {
+        if (p->flowControl) {
+            for (;;) {
+                Wire.txLength = 0;
+                requestEvent();
+                if (Wire.tx[2] > 0) break;
+                sched_yield();
+            }
+        }
+        interrupt(data, makeFrame(n, data));
+        p->sent = n + 1;
+        if (rand() % 8 == 0) {
+            sched_yield();       // Bursts of frames, then a gap
+        }
+    }
+    p->done = true;
+    return NULL;
+}
+
+// The master telemetry packets loop() wrote, checked against the frames
+// sent: returns how many there were, and counts any out of order or damaged
+unsigned consumed(unsigned* bad, unsigned* gaps) {
+    unsigned count = 0;
+    long last = -1;
+    *bad = *gaps = 0;
+    size_t i = 0;
+    while (i + 3 < Serial.outputLength) {
+        const uint8_t* packet = Serial.output + i;
+        uint8_t length = packet[2];
+        if (packet[0] != TELEMETRY_SYNC) {
+            (*bad)++;
+            break;
+        }
+        if (packet[1] == TELEMETRY_MASTER) {
+            const uint8_t* payload = packet + 3;
+            unsigned n = payload[0] | (payload[1] << 8);
+            uint8_t expected[BUFFER_SIZE];
+            makeFrame(n, expected);
+            if (length != expected[1] || memcmp(payload, expected + 2, length) != 0) {
+                (*bad)++;
+            }
+            if ((long)n != last + 1) {
+                (*gaps)++;
+            }
+            last = n;
+            count++;
+        }
+        i += 3 + length + 1;
+    }
+    return count;
+}
+
+void reset() {
+    rxHead = rxTail = 0;
+    rxFrames = rxDropped = 0;
+    rxHighWater = 0;
+    rxMalformed = 0;
+    Serial.outputLength = 0;
+}
+
+// loop() keeps up, the producer waits for room: nothing may be lost
+void testFlowControl() {
+    printf("producer thread with flow control\n");
+    reset();
+    Producer p = {3000, true, 0, false};
+    pthread_t thread;
+    pthread_create(&thread, NULL, produce, &p);
+    while (!p.done || rxTail != rxHead) {
+        arduino_Run(ARDUINO_PASS_NS);
+        if (rand() % 16 == 0) {
+            sched_yield();
+        }
+    }
+    pthread_join(thread, NULL);
+    unsigned bad, gaps;
+    unsigned count = consumed(&bad, &gaps);
+    printf("  %u frames sent, %u processed, high water %u of %u\n", p.frames, count, rxHighWater, RX_QUEUE_SIZE - 1);
+    check(rxFrames == p.frames && rxDropped == 0, "every frame taken into the ring");
+    check(count == p.frames && gaps == 0, "every frame processed once, in order");
+    check(bad == 0 && rxMalformed == 0, "no frame torn");
+}
+
+// loop() is held up (a long show() with interrupts on, say) while the
+// producer sends without looking: the ring takes what it holds, the rest
+// is dropped and counted, and nothing already queued is overwritten
+void testBurst() {
+    printf("burst while loop() is stalled\n");
+    reset();
+    const unsigned burst = 20;
+    Producer p = {burst, false, 0, false};
+    pthread_t thread;
+    pthread_create(&thread, NULL, produce, &p);
+    pthread_join(thread, NULL);
+    check(rxHighWater == RX_QUEUE_SIZE - 1, "the ring fills to its capacity");
+    check(rxDropped == burst - (RX_QUEUE_SIZE - 1), "the frames past it are dropped and counted");
+    unsigned long shown = framesShown;
+    arduino_Run(ARDUINO_PASS_NS);
+    unsigned bad, gaps;
+    unsigned count = consumed(&bad, &gaps);
+    check(count == RX_QUEUE_SIZE - 1 && gaps == 0 && bad == 0, "the queued frames come out whole and in order");
+    check(rxTail == rxHead, "one pass of loop() drains the ring");
+    check(framesShown - shown <= 1, "at most one show() per drain");
+}
+
+// a screen change in every frame of a full ring still gives one show()
+void testOneShowPerDrain() {
+    printf("one show per drain\n");
+    reset();
+    arduino_RunMs(100);
+    unsigned long shown = framesShown;
+    for (uint8_t i = 0; i < RX_QUEUE_SIZE - 1; i++) {
+        uint8_t score[4] = {0x0C, 0, (uint8_t)(i + 1), 3};
+        interrupt(score, sizeof(score));
+    }
+    arduino_Run(ARDUINO_PASS_NS);
+    check(rxTail == rxHead, "every queued frame processed in one pass");
+    check(framesShown - shown == 1, "one show() for all of them");
+}
+
+int main() {
+    srand(4);
+    arduino_Boot();
+    Serial.byteNs = 0;           // An endless Serial line, every packet goes out
+    testFlowControl();
+    testBurst();
+    testOneShowPerDrain();
+    return checkSummary();
+}
@@ -0,0 +1,149 @@
+// The score renderer (displayNumber) against a clear-then-draw reference
+// built from the old drawing code (reference_renderer.h): blank bottom
+// positions 3-7, then draw the digits right adjusted.
+//   every score 0 to 65535 counting up, then counting down, so each digit
+//     position sees every change it can get
+//   random jumps in random colors with 0x0C, under all ten balls
+// Then the cost of an update: columns of leds[] built again, and host
+// cycles for displayNumber() plus compositing against the old
+// snprintf-then-redraw. Host cycles of a sanitized build, so only the
+// ratio means much; the columns are the same on the AVR.
+
+#include "arduino_firmware.h"
+#include "reference_renderer.h"
+#include "check.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES() __rdtsc()
+#else
+#include <chrono>
+#define CYCLES() (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count()
+#endif
+
+// the sketch's leds[] in the colors they are shown in
+bool sameAsReference() {
+    for (int led = 0; led < NUM_LEDS; led++) {
+        CRGB color = paletteColors[getPixel(leds, led)];
+        CRGB expected = refLeds[led];
+        if (color.r != expected.r || color.g != expected.g || color.b != expected.b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the score as a clear-then-draw would show it
+void ref_Score(uint16_t number, CRGB color) {
+    char digits[6];
+    snprintf(digits, sizeof(digits), "%u", number);
+    int length = strlen(digits);
+    for (int position = 3; position < 8; position++) {
+        ref_ClearMapping(refBottom[position]);
+    }
+    for (int i = 0; i < length; i++) {
+        ref_Character(digits[i], refBottom[8 - length + i], color);
+    }
+}
+
+void clearBoth() {
+    uint8_t clear = 0x05;
+    arduino_Send(&clear, 1);
+    arduino_Run(ARDUINO_PASS_NS);
+    ref_Clear();
+}
+
+// 0x03 draws in red, 0x0C in a color of the text palette
+void sendScore(uint16_t number, int color) {
+    uint8_t frame[] = {(uint8_t)(color == 3 ? 0x03 : 0x0C), (uint8_t)(number >> 8), (uint8_t)number,
+                       (uint8_t)color};
+    arduino_Send(frame, color == 3 ? 3 : 4);
+    arduino_Run(ARDUINO_PASS_NS);
+}
+
+int firstWrong = -1;
+
+void expect(uint16_t number, int* wrong) {
+    if (!sameAsReference()) {
+        if (*wrong == 0) {
+            firstWrong = number;
+        }
+        (*wrong)++;
+    }
+}
+
+void testCounting() {
+    printf("every score, counting up and down\n");
+    char line[96];
+    int wrong = 0;
+    clearBoth();
+    for (long number = 0; number <= 65535; number++) {
+        sendScore(number, 3);
+        ref_Score(number, CRGB::Red);
+        expect(number, &wrong);
+    }
+    snprintf(line, sizeof(line), "0 to 65535: %d wrong, first %d", wrong, firstWrong);
+    check(wrong == 0, line);
+    wrong = 0;
+    for (long number = 65535; number >= 0; number--) {
+        sendScore(number, 3);
+        ref_Score(number, CRGB::Red);
+        expect(number, &wrong);
+    }
+    snprintf(line, sizeof(line), "65535 to 0: %d wrong, first %d", wrong, firstWrong);
+    check(wrong == 0, line);
+}
+
+void testJumps() {
+    printf("random jumps and colors, under the balls\n");
+    clearBoth();
+    const uint8_t balls[] = {0x04, 10};
+    arduino_Send(balls, sizeof(balls));
+    int wrong = 0;
+    for (int i = 0; i < 20000; i++) {
+        uint16_t number = (rand() % 4 == 0) ? rand() % 100 : rand() % 65536;
+        int color = 1 + rand() % 7;
+        sendScore(number, color);
+        ref_Score(number, ref_ColorSelect(color));
+        ref_Balls(10);
+        expect(number, &wrong);
+    }
+    char line[96];
+    snprintf(line, sizeof(line), "20000 scores: %d wrong, first %d", wrong, firstWrong);
+    check(wrong == 0, line);
+}
+
+void benchmark() {
+    printf("cost of an update, counting 0 to 65535\n");
+    clearBoth();
+    unsigned long columns = 0;
+    uint64_t newCycles = 0;
+    uint64_t oldCycles = 0;
+    for (long number = 0; number <= 65535; number++) {
+        uint64_t start = CYCLES();
+        displayNumber(number, COLOR_RED);
+        unsigned long dirty = dirtyColumns;
+        compositeLayers();
+        newCycles += CYCLES() - start;
+        columns += __builtin_popcountl(dirty);
+
+        start = CYCLES();
+        ref_Number(number % 10000);     // the old one only ever had room for 4 digits
+        oldCycles += CYCLES() - start;
+    }
+    printf("  columns built again per update: %.2f of %d\n", columns / 65536.0, WIDTH);
+    printf("  host cycles per update: displayNumber + composite %.0f, old snprintf + redraw %.0f\n",
+           newCycles / 65536.0, oldCycles / 65536.0);
+    char line[96];
+    snprintf(line, sizeof(line), "%.2f columns an update on average, a digit is 3",
+             columns / 65536.0);
+    check(columns / 65536.0 < 3.5, line);
+}
+
+int main() {
+    srand(15);
+    arduino_Boot();
+    testCounting();
+    testJumps();
+    benchmark();
+    return checkSummary();
+}
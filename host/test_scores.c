@@ -0,0 +1,216 @@
+// The high score table (high_scores.h) on the emulated data EEPROM:
+//   power lost at any moment of a save, the byte being written left holding
+//     anything: the table loaded at the next power up is the one before
+//     the save or the one after it, never a mix, and the next save after
+//     that is kept, also across the sequence number wrapping
+//   write amplification: EEPROM bytes written per save and per score byte
+//     that changed, against rewriting the whole record, and the wear of
+//     the cells over the ring
+//   startup scan: what scores_Load() reads and checks, the same however
+//     full the ring is, and how long that takes
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <xc.h>
+#include "high_scores.h"
+#include "pic_host.h"
+#include "check.h"
+
+// Instruction cycles on the chip (Fosc/4 at 32MHz) for the startup scan
+// estimate: one eeprom_Read() call, and one bit of scores_Crc()
+#define CHIP_NS_PER_CYCLE 125
+#define CHIP_CYCLES_READ 12
+#define CHIP_CYCLES_CRC_BIT 12
+
+void isr(void) {
+}
+
+// the main loop while nobody is playing
+void servicePass(void) {
+    scores_Service();
+}
+
+uint8_t saving(void) {
+    return highScores.writeIndex < RECORD_SIZE || EECON1bits.WR;
+}
+
+// runs until the queued save is in the EEPROM
+void finishSave(void) {
+    while (saving()) {
+        pic_RunMs(1);
+    }
+}
+
+// power lost and back, then the table as the firmware finds it
+void powerCycle(void) {
+    pic_PowerCycle();
+    memset(&highScores, 0x5A, sizeof(highScores));
+    scores_Load();
+}
+
+uint8_t sameTable(const int16_t* table) {
+    return memcmp(highScores.scores, table, sizeof(highScores.scores)) == 0;
+}
+
+// a score that makes the table, different every time
+int16_t nextScore(void) {
+    return highScores.scores[SCORE_TABLE_SIZE - 1] + 1 + rand() % 500;
+}
+
+// Saves from a fresh EEPROM until the ring has gone round more than once,
+// the first at sequence start, and cuts the power at every 500us of the
+// save after them, the byte being written then holding anything
+unsigned long cutSaves(uint16_t start, unsigned long* mixed, unsigned long* lost, unsigned long* cuts) {
+    unsigned long checked = 0;
+    for (uint8_t history = 0; history < RECORD_SLOTS + 3; history++) {
+        for (uint64_t cutNs = 0; ; cutNs += PIC_MS / 2) {
+            pic_PowerUp();
+            scores_Load();
+            highScores.sequence = start;
+            for (uint8_t i = 0; i < history; i++) {
+                scores_Insert(nextScore());
+                finishSave();
+            }
+            int16_t before[SCORE_TABLE_SIZE], after[SCORE_TABLE_SIZE];
+            memcpy(before, highScores.scores, sizeof(before));
+            scores_Insert(nextScore());
+            memcpy(after, highScores.scores, sizeof(after));
+            pic_Run(cutNs);
+            uint8_t done = !saving();
+            powerCycle();
+            checked++;
+            *cuts += !done;
+            if (done) {
+                *lost += !sameTable(after);
+            } else {
+                *mixed += !sameTable(before) && !sameTable(after);
+            }
+            // the save after the cut is the one that counts
+            scores_Insert(nextScore());
+            memcpy(after, highScores.scores, sizeof(after));
+            finishSave();
+            powerCycle();
+            *lost += !sameTable(after);
+            if (done) {
+                break;
+            }
+        }
+    }
+    return checked;
+}
+
+void testPowerLoss(void) {
+    printf("power lost during a save\n");
+    srand(3);
+    uint16_t starts[] = {1, 0xFFF8};
+    for (uint8_t i = 0; i < sizeof(starts) / sizeof(starts[0]); i++) {
+        unsigned long mixed = 0, lost = 0, cuts = 0;
+        unsigned long checked = cutSaves(starts[i], &mixed, &lost, &cuts);
+        char line[120];
+        snprintf(line, sizeof(line),
+                 "sequence from 0x%04X: %lu power cuts, %lu in the middle of a save, %lu mixed tables", starts[i],
+                 checked, cuts, mixed);
+        check(cuts > 0 && mixed == 0, line);
+        snprintf(line, sizeof(line), "sequence from 0x%04X: %lu finished saves lost", starts[i], lost);
+        check(lost == 0, line);
+    }
+}
+
+void testAmplification(void) {
+    printf("write amplification\n");
+    srand(11);
+    pic_PowerUp();
+    scores_Load();
+    const unsigned long saves = 2000;
+    unsigned long changed = 0;
+    for (unsigned long n = 0; n < saves; n++) {
+        int16_t before[SCORE_TABLE_SIZE];
+        memcpy(before, highScores.scores, sizeof(before));
+        // mostly a new score low in the table, now and then a new best
+        int16_t low = highScores.scores[SCORE_TABLE_SIZE - 1];
+        int16_t score = (rand() % 8 == 0) ? highScores.scores[0] + 1 + rand() % 50 : low + 1 + rand() % 20;
+        scores_Insert(score);
+        for (uint8_t i = 0; i < SCORE_TABLE_SIZE; i++) {
+            changed += ((uint16_t)before[i] >> 8 != (uint16_t)highScores.scores[i] >> 8);
+            changed += ((uint8_t)before[i] != (uint8_t)highScores.scores[i]);
+        }
+        finishSave();
+    }
+    unsigned long written = picEepromWrites;
+    unsigned long most = 0, least = ~0UL;
+    for (uint8_t slot = 0; slot < RECORD_SLOTS; slot++) {
+        unsigned long wear = 0;
+        for (uint8_t i = 0; i < RECORD_SIZE; i++) {
+            wear += picEepromWear[slot * RECORD_SIZE + i];
+        }
+        most = (wear > most) ? wear : most;
+        least = (wear < least) ? wear : least;
+    }
+    unsigned long cellMost = 0;
+    for (int i = 0; i < PIC_EEPROM_SIZE; i++) {
+        cellMost = (picEepromWear[i] > cellMost) ? picEepromWear[i] : cellMost;
+    }
+    printf("  %lu saves: %lu bytes written, %.2f a save against %d for the whole record\n", saves, written,
+           (double)written / saves, RECORD_SIZE);
+    printf("  %lu score bytes changed, %.2f bytes written for each\n", changed, (double)written / changed);
+    printf("  wear: %lu to %lu writes a slot, %lu at most on one cell, %.0f saves for its 100k\n", least, most,
+           cellMost, 100000.0 * saves / cellMost);
+    check(written < saves * RECORD_SIZE, "fewer bytes written than whole records");
+    check(most - least <= 2 * RECORD_SIZE, "every slot of the ring wears the same");
+    check(cellMost <= saves / RECORD_SLOTS + 1, "no cell written more than once a turn of the ring");
+}
+
+double seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// reads and host time of one scores_Load()
+unsigned long scanReads(double* hostNs) {
+    const int rounds = 2000;
+    unsigned long reads = picEepromReads;
+    scores_Load();
+    reads = picEepromReads - reads;
+    double start = seconds();
+    for (int i = 0; i < rounds; i++) {
+        scores_Load();
+    }
+    *hostNs = (seconds() - start) / rounds * 1e9;
+    return reads;
+}
+
+void testScan(void) {
+    printf("startup scan\n");
+    const char* names[] = {"erased", "one record", "ring full"};
+    const uint8_t saves[] = {0, 1, RECORD_SLOTS + 2};
+    unsigned long reads[3];
+    double hostNs[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        pic_PowerUp();
+        scores_Load();
+        for (uint8_t n = 0; n < saves[i]; n++) {
+            scores_Insert(nextScore());
+            finishSave();
+        }
+        reads[i] = scanReads(&hostNs[i]);
+        printf("  %-10s %lu EEPROM reads, %.0f ns on the host\n", names[i], reads[i], hostNs[i]);
+    }
+    // every slot is read and has its CRC worked out, whatever it holds
+    unsigned long crcBits = RECORD_SLOTS * RECORD_CRC * 8UL;
+    double chipMs = (reads[2] * CHIP_CYCLES_READ + crcBits * CHIP_CYCLES_CRC_BIT) * CHIP_NS_PER_CYCLE / 1e6;
+    char line[120];
+    snprintf(line, sizeof(line), "%d reads and %lu CRC bytes however full, about %.1f ms on the chip",
+             PIC_EEPROM_SIZE, crcBits / 8, chipMs);
+    check(reads[0] == PIC_EEPROM_SIZE && reads[1] == reads[0] && reads[2] == reads[0], line);
+}
+
+int main(void) {
+    picMainPass = servicePass;
+    testPowerLoss();
+    testAmplification();
+    testScan();
+    return checkSummary();
+}
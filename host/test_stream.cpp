@@ -0,0 +1,308 @@
+// Streamed frames (0x07) end to end: host/stream_encoder.h encodes, the
+// sketch decodes, and what it shows must be the frame that was encoded.
+//   round trip over a corpus of typical frames and random ones, keyframes
+//     and delta frames
+//   a lost chunk drops the frame, and delta frames after it are refused
+//     until a keyframe
+//   a clear (0x05) also breaks the delta chain, the next frame must be a key
+//   bytes per frame and the frame rate that leaves at 100kHz and 400kHz,
+//     against sending every frame whole
+// The corpus is captured from the sketch's own screens (score screens, a
+// scrolling message, the animations) plus a moving sprite, a full color
+// pattern and noise as the worst case.
+
+#include "arduino_firmware.h"
+#include "stream_encoder.h"
+#include "check.h"
+#include <vector>
+
+typedef std::vector<uint8_t> Frame;
+
+// leds[] as palette indexes
+Frame shown() {
+    Frame frame(NUM_LEDS);
+    for (int led = 0; led < NUM_LEDS; led++) {
+        frame[led] = getPixel(leds, led);
+    }
+    return frame;
+}
+
+// Capturing: every frame the strip latches while the sketch runs
+std::vector<Frame>* capturing = NULL;
+
+void latched() {
+    if (capturing != NULL && (capturing->empty() || capturing->back() != shown())) {
+        capturing->push_back(shown());
+    }
+}
+
+void clearScreen() {
+    uint8_t clear = 0x05;
+    arduino_Send(&clear, 1);
+    arduino_RunMs(100);
+}
+
+std::vector<Frame> captureScores() {
+    std::vector<Frame> frames;
+    clearScreen();
+    capturing = &frames;
+    const uint8_t label[] = {0x01, 1, 5, 'S', 'C', 'O', 'R', 'E'};
+    arduino_Send(label, sizeof(label));
+    for (int i = 0; i < 40; i++) {
+        int score = i * 55;
+        uint8_t number[] = {0x03, (uint8_t)(score >> 8), (uint8_t)score};
+        uint8_t balls[] = {0x04, (uint8_t)(10 - i / 4)};
+        arduino_Send(number, sizeof(number));
+        arduino_Send(balls, sizeof(balls));
+        arduino_RunMs(200);
+    }
+    capturing = NULL;
+    return frames;
+}
+
+std::vector<Frame> captureMarquee() {
+    std::vector<Frame> frames;
+    clearScreen();
+    capturing = &frames;
+    const char text[] = "GAME OVER 1250 HI 4400";
+    uint8_t command[6 + sizeof(text)] = {0x08, 0x01, 3, 60, 0, (uint8_t)(sizeof(text) - 1)};
+    memcpy(command + 6, text, sizeof(text) - 1);
+    arduino_Send(command, 6 + sizeof(text) - 1);
+    arduino_RunMs(8000);
+    capturing = NULL;
+    return frames;
+}
+
+std::vector<Frame> captureAnimation(uint8_t number) {
+    std::vector<Frame> frames;
+    clearScreen();
+    capturing = &frames;
+    const uint8_t command[] = {0x0B, number, 3, 0};
+    arduino_Send(command, sizeof(command));
+    arduino_RunMs(2000);
+    capturing = NULL;
+    return frames;
+}
+
+// a 4x4 block bouncing around the matrix over a dim grid
+std::vector<Frame> sprite() {
+    std::vector<Frame> frames;
+    int x = 0, y = 0, dx = 1, dy = 1;
+    for (int i = 0; i < 120; i++) {
+        Frame frame(NUM_LEDS, 0);
+        for (int c = 0; c < WIDTH; c += 4) {
+            for (int r = 0; r < HEIGHT; r++) {
+                frame[pixelLed(c, r)] = 11;
+            }
+        }
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) {
+                frame[pixelLed(x + c, y + r)] = 4;
+            }
+        }
+        frames.push_back(frame);
+        if (x + dx < 0 || x + dx > WIDTH - 4) dx = -dx;
+        if (y + dy < 0 || y + dy > HEIGHT - 4) dy = -dy;
+        x += dx;
+        y += dy;
+    }
+    return frames;
+}
+
+// diagonal color bands moving one column a frame, every led changes
+std::vector<Frame> bands() {
+    std::vector<Frame> frames;
+    for (int i = 0; i < 60; i++) {
+        Frame frame(NUM_LEDS);
+        for (int c = 0; c < WIDTH; c++) {
+            for (int r = 0; r < HEIGHT; r++) {
+                frame[pixelLed(c, r)] = 1 + ((c + r + i) / 3) % 15;
+            }
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+std::vector<Frame> noise() {
+    std::vector<Frame> frames;
+    for (int i = 0; i < 60; i++) {
+        Frame frame(NUM_LEDS);
+        for (int led = 0; led < NUM_LEDS; led++) {
+            frame[led] = rand() % PALETTE_SIZE;
+        }
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+// sends the chunks, a pass of loop() after each as the credits would allow
+void sendChunks(const StreamChunk* chunks, int count) {
+    for (int i = 0; i < count; i++) {
+        arduino_Send(chunks[i].data, chunks[i].length);
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    arduino_Run(ARDUINO_PASS_NS);
+}
+
+struct Cost {
+    unsigned long frames = 0;
+    unsigned long chunks = 0;
+    unsigned long bytes = 0;        // on the bus, the address byte included
+    unsigned long bits = 0;
+};
+
+void count(Cost* cost, const StreamChunk* chunks, int n) {
+    cost->frames++;
+    cost->chunks += n;
+    for (int i = 0; i < n; i++) {
+        cost->bytes += 1 + chunks[i].length;
+        cost->bits += stream_BusBits(&chunks[i]);
+    }
+}
+
+// Streams a sequence, a keyframe first and every keyInterval frames, and
+// checks each one shows as encoded. Adds up what it took on the bus.
+int roundTrip(const std::vector<Frame>& frames, int keyInterval, Cost* cost) {
+    StreamChunk chunks[STREAM_CHUNKS_MAX];
+    int wrong = 0;
+    static uint8_t seq = 0;
+    for (size_t i = 0; i < frames.size(); i++) {
+        bool key = (i % keyInterval == 0);
+        int n = stream_Encode(frames[i].data(), key ? NULL : frames[i - 1].data(), seq++, chunks);
+        count(cost, chunks, n);
+        sendChunks(chunks, n);
+        wrong += (shown() != frames[i]);
+    }
+    return wrong;
+}
+
+// every frame packed whole, the way a plain framebuffer dump would go
+void countWhole(Cost* cost) {
+    const int payload = 2 * STREAM_PAYLOAD_MAX;          // leds per packed chunk
+    int chunks = (NUM_LEDS + payload - 1) / payload;
+    cost->frames++;
+    cost->chunks += chunks;
+    for (int led = 0; led < NUM_LEDS; led += payload) {
+        int length = STREAM_HEADER + min(payload, NUM_LEDS - led) / 2;
+        cost->bytes += 1 + length;
+        cost->bits += 1 + 9 * (1 + length) + 1;
+    }
+}
+
+void report(const char* name, const Cost& cost, const Cost& whole) {
+    double bits = (double)cost.bits / cost.frames;
+    printf("  %-10s %6lu %7.1f %8.1f %7.1f %7.1f %9.1f\n", name, cost.frames, (double)cost.chunks / cost.frames,
+           (double)cost.bytes / cost.frames, (double)whole.bytes / whole.frames,
+           100000 / bits, 400000 / bits);
+}
+
+void testCorpus() {
+    struct Sequence {
+        const char* name;
+        std::vector<Frame> frames;
+    };
+    std::vector<Sequence> corpus;
+    corpus.push_back({"scores", captureScores()});
+    corpus.push_back({"marquee", captureMarquee()});
+    corpus.push_back({"win", captureAnimation(0)});
+    corpus.push_back({"attract", captureAnimation(2)});
+    corpus.push_back({"sprite", sprite()});
+    corpus.push_back({"bands", bands()});
+    corpus.push_back({"noise", noise()});
+
+    printf("round trip and bytes per frame, every 30th frame a keyframe\n");
+    printf("  sequence   frames  chunks    bytes   whole fps@100k  fps@400k\n");
+    Cost all, allWhole;
+    int wrong = 0;
+    int frames = 0;
+    for (const Sequence& sequence : corpus) {
+        Cost cost, whole;
+        wrong += roundTrip(sequence.frames, 30, &cost);
+        for (size_t i = 0; i < sequence.frames.size(); i++) {
+            countWhole(&whole);
+        }
+        frames += sequence.frames.size();
+        report(sequence.name, cost, whole);
+        if (strcmp(sequence.name, "noise") != 0) {
+            all.frames += cost.frames;
+            all.chunks += cost.chunks;
+            all.bytes += cost.bytes;
+            all.bits += cost.bits;
+            allWhole.frames += whole.frames;
+            allWhole.bytes += whole.bytes;
+        }
+    }
+    report("typical", all, allWhole);
+    char line[96];
+    snprintf(line, sizeof(line), "%d frames shown exactly as encoded, %d wrong", frames - wrong, wrong);
+    check(wrong == 0, line);
+    snprintf(line, sizeof(line), "typical frames take %.0f%% of the bytes of whole frames",
+             100.0 * all.bytes / all.frames / (allWhole.bytes / allWhole.frames));
+    check(all.bytes * 2 < allWhole.bytes / allWhole.frames * all.frames, line);
+}
+
+// random frames and random edits of them, every one a delta
+void testRandom() {
+    printf("random frames and edits\n");
+    std::vector<Frame> frames;
+    Frame frame(NUM_LEDS, 0);
+    for (int i = 0; i < 2000; i++) {
+        int edits = rand() % 5 == 0 ? NUM_LEDS : rand() % 40;
+        for (int e = 0; e < edits; e++) {
+            int led = rand() % NUM_LEDS;
+            int run = 1 + rand() % 20;
+            uint8_t color = rand() % PALETTE_SIZE;
+            for (int j = led; j < led + run && j < NUM_LEDS; j++) {
+                frame[j] = color;
+            }
+        }
+        frames.push_back(frame);
+    }
+    Cost cost;
+    int wrong = roundTrip(frames, frames.size(), &cost);
+    char line[96];
+    snprintf(line, sizeof(line), "%zu frames, %d wrong", frames.size(), wrong);
+    check(wrong == 0, line);
+}
+
+void testBrokenChains() {
+    printf("broken delta chains\n");
+    StreamChunk chunks[STREAM_CHUNKS_MAX];
+    std::vector<Frame> frames = bands();
+    Cost cost;
+    roundTrip(std::vector<Frame>(frames.begin(), frames.begin() + 2), 30, &cost);
+
+    // a chunk of frame 2 goes missing: frame 2 and the delta after it are refused
+    unsigned int rejected = streamRejected;
+    int n = stream_Encode(frames[2].data(), frames[1].data(), 200, chunks);
+    sendChunks(chunks, 1);
+    sendChunks(chunks + 2, n - 2);
+    n = stream_Encode(frames[3].data(), frames[2].data(), 201, chunks);
+    sendChunks(chunks, n);
+    check(streamRejected - rejected == 2 && shown() == frames[1], "a lost chunk drops the frame and the delta after it");
+    n = stream_Encode(frames[4].data(), NULL, 202, chunks);
+    sendChunks(chunks, n);
+    check(shown() == frames[4], "a keyframe starts the chain again");
+
+    // a clear in between: the next delta is refused, even though its base
+    // is still the frame the canvas holds
+    clearScreen();
+    rejected = streamRejected;
+    n = stream_Encode(frames[5].data(), frames[4].data(), 203, chunks);
+    sendChunks(chunks, n);
+    check(streamRejected - rejected == 1 && shown() == Frame(NUM_LEDS, 0), "a delta after a clear is refused");
+    n = stream_Encode(frames[5].data(), NULL, 204, chunks);
+    sendChunks(chunks, n);
+    check(shown() == frames[5], "a keyframe after the clear is shown");
+}
+
+int main() {
+    srand(11);
+    arduino_Boot();
+    stripLatched = latched;
+    testCorpus();
+    testRandom();
+    testBrokenChains();
+    return checkSummary();
+}
@@ -0,0 +1,248 @@
+// The telemetry decoder (telemetry.h) on what the sketch really sends:
+//   counters and command counts match the traffic the sketch was given,
+//     a master page comes through as sent, and the stream starts on a
+//     packet, with no text ahead of it
+//   master pages that come faster than the serial line takes them: the
+//     ones with no room are counted, so the decoder knows they were lost
+//   damaged streams: text in front, a flipped byte, lost bytes, each costs
+//     only the packets it touched and nothing bad is taken for a packet
+//   the sim's capture, with the PIC's pages in it, decodes whole and the
+//     telemetry tool reads it
+// The sim and the tool are the build/ programs, run from here.
+
+#include "arduino_firmware.h"
+#include "telemetry.h"
+#include "check.h"
+#include <string>
+#include <vector>
+
+static_assert(TM_SYNC == TELEMETRY_SYNC && TM_COUNTERS == TELEMETRY_COUNTERS && TM_MASTER == TELEMETRY_MASTER &&
+              TM_COMMANDS == TELEMETRY_COMMANDS, "the decoder's packet types are the sketch's");
+static_assert(TM_COMMAND_MAX >= COMMAND_LAST, "the decoder holds every command");
+
+typedef std::vector<std::string> Packets;
+
+// every packet decoded from a stream, header and checksum included
+Packets decode(const std::vector<uint8_t>& data, TmStats* stats) {
+    Packets packets;
+    TmPacket packet;
+    size_t at = 0;
+    memset(stats, 0, sizeof(*stats));
+    while (tm_Next(data.data(), data.size(), &at, &packet, stats)) {
+        packets.push_back(std::string((const char*)packet.payload - 3, packet.length + 4));
+    }
+    return packets;
+}
+
+std::vector<uint8_t> stream;     // what the sketch wrote on Serial
+
+void testSketch() {
+    printf("counters from the sketch\n");
+    Serial.outputLength = 0;
+    arduino_Boot();
+    const int scores = 100, bad = 5;
+    for (int i = 0; i < scores; i++) {
+        uint8_t frame[] = {0x0C, 0, (uint8_t)i, 3};
+        arduino_Send(frame, sizeof(frame));
+        arduino_RunMs(30);
+        if (i % 20 == 0) {
+            uint8_t unknown[] = {0x0F, 1, 2};
+            arduino_Send(unknown, sizeof(unknown));
+        }
+    }
+    // a PIC counters page: 1234 loops, hits 1 to 4, then the other bytes 1 to 12
+    uint8_t master[2 + TM_PAGE_COUNTERS_SIZE] = {0x0D, TM_PAGE_COUNTERS_SIZE, TM_PAGE_COUNTERS, 0xD2, 0x04};
+    for (int i = 0; i < TM_TARGETS; i++) {
+        master[5 + 2 * i] = i + 1;
+    }
+    for (int i = 5 + 2 * TM_TARGETS, n = 1; i < (int)sizeof(master); i++, n++) {
+        master[i] = n;
+    }
+    arduino_Send(master, sizeof(master));
+    arduino_RunMs(3000);
+    stream.assign(Serial.output, Serial.output + Serial.outputLength);
+
+    TmStats stats;
+    Packets packets = decode(stream, &stats);
+    char line[120];
+    snprintf(line, sizeof(line), "%lu packets in %zu bytes, %lu skipped, %lu bad", stats.packets, stream.size(),
+             stats.skipped, stats.badChecksum + stats.badLength);
+    check(stats.packets >= 8 && stats.skipped == 0 && stats.badChecksum + stats.badLength == 0 &&
+          !stream.empty() && stream[0] == TM_SYNC, line);
+
+    TmCounters counters = {};
+    TmCommands commands = {};
+    TmPicCounters pic = {};
+    int pages = 0;
+    for (const std::string& p : packets) {
+        TmPacket packet = {(uint8_t)p[1], (uint8_t)p[2], (const uint8_t*)p.data() + 3};
+        if (packet.type == TM_COUNTERS) {
+            tm_Counters(&packet, &counters);
+        } else if (packet.type == TM_COMMANDS) {
+            tm_Commands(&packet, &commands);
+        } else if (tm_Page(&packet) == TM_PAGE_COUNTERS) {
+            tm_PicCounters(&packet, &pic);
+            pages++;
+        }
+    }
+    snprintf(line, sizeof(line), "last counters: %u received, %u malformed at %lu ms", counters.received,
+             counters.malformed, (unsigned long)counters.ms);
+    check(counters.received == scores + bad + 1 && counters.malformed == bad && counters.ms > 3000, line);
+    check(counters.shown > 0 && counters.showMaxUs >= counters.showUs && counters.showUs > 0,
+          "shows counted and timed");
+    check(commands.last == COMMAND_LAST && commands.count[0x0C] == scores && commands.count[0x0D] == 1,
+          "every command counted");
+    check(pages == 1 && pic.loops == 1234 && pic.hits[0] == 1 && pic.hits[3] == 4 && pic.hitsLost == 1 &&
+          pic.latenessMs[TM_TASKS - 1] == 12, "the master page comes through as it was sent");
+}
+
+void testMasterLost() {
+    printf("master pages with no room\n");
+    Serial.outputLength = 0;
+    arduino_Boot();
+    arduino_RunMs(1500);
+    uint8_t master[2 + TM_PAGE_COUNTERS_SIZE] = {0x0D, TM_PAGE_COUNTERS_SIZE, TM_PAGE_COUNTERS};
+    const int sent = 8;
+    for (int i = 0; i < sent; i++) {
+        arduino_Send(master, sizeof(master));
+        arduino_Run(ARDUINO_PASS_NS);
+    }
+    arduino_RunMs(3000);
+    std::vector<uint8_t> data(Serial.output, Serial.output + Serial.outputLength);
+    TmStats stats;
+    TmCounters counters = {};
+    int pages = 0, lostBefore = -1;
+    for (const std::string& p : decode(data, &stats)) {
+        TmPacket packet = {(uint8_t)p[1], (uint8_t)p[2], (const uint8_t*)p.data() + 3};
+        if (packet.type == TM_COUNTERS) {
+            tm_Counters(&packet, &counters);
+            lostBefore = (lostBefore < 0) ? counters.masterLost : lostBefore;
+        } else if (tm_Page(&packet) == TM_PAGE_COUNTERS) {
+            pages++;
+        }
+    }
+    char line[120];
+    snprintf(line, sizeof(line), "%d pages sent at once, %d through, %d counted as dropped", sent, pages,
+             counters.masterLost - lostBefore);
+    check(pages > 0 && pages < sent && lostBefore >= 0 && counters.masterLost - lostBefore == sent - pages, line);
+}
+
+// the packets of the clean stream but the ones listed
+Packets without(const Packets& all, std::vector<size_t> lost) {
+    Packets kept;
+    for (size_t i = 0; i < all.size(); i++) {
+        bool gone = false;
+        for (size_t n : lost) {
+            gone |= (n == i);
+        }
+        if (!gone) {
+            kept.push_back(all[i]);
+        }
+    }
+    return kept;
+}
+
+// where packet n starts in the clean stream
+size_t offsetOf(const Packets& all, size_t n) {
+    size_t at = 0;
+    for (size_t i = 0; i < n; i++) {
+        at += all[i].size();
+    }
+    return at;
+}
+
+void testDamage() {
+    printf("damaged streams\n");
+    TmStats stats;
+    Packets clean = decode(stream, &stats);
+
+    std::vector<uint8_t> damaged(stream);
+    const char* text = "Waiting for data...\r\n";
+    damaged.insert(damaged.begin(), text, text + strlen(text));
+    check(decode(damaged, &stats) == clean && stats.skipped == strlen(text), "text in front is skipped");
+
+    damaged = stream;
+    damaged[offsetOf(clean, 2) + 5] ^= 0x10;
+    check(decode(damaged, &stats) == without(clean, {2}) && stats.badChecksum > 0,
+          "a flipped byte loses its packet only");
+
+    damaged = stream;
+    damaged.erase(damaged.begin() + offsetOf(clean, 4) + 1, damaged.begin() + offsetOf(clean, 4) + 3);
+    check(decode(damaged, &stats) == without(clean, {4}), "lost bytes lose their packet only");
+
+    damaged = stream;
+    damaged.resize(offsetOf(clean, clean.size() - 1) + 3);
+    check(decode(damaged, &stats) == without(clean, {clean.size() - 1}), "a packet cut off at the end waits");
+
+    // random bytes between packets, some of them the sync byte
+    srand(5);
+    damaged.clear();
+    for (const std::string& p : clean) {
+        for (int n = rand() % 4; n > 0; n--) {
+            damaged.push_back((rand() % 3 == 0) ? TM_SYNC : rand());
+        }
+        damaged.insert(damaged.end(), p.begin(), p.end());
+    }
+    Packets decoded = decode(damaged, &stats);
+    check(decoded == clean, "noise between packets is never taken for one");
+}
+
+void testSim() {
+    printf("the sim's capture\n");
+    if (system("build/sim --games 2 --telemetry build/sim.telemetry > /dev/null") != 0) {
+        check(false, "sim ran");
+        return;
+    }
+    FILE* in = fopen("build/sim.telemetry", "rb");
+    std::vector<uint8_t> data;
+    int c;
+    while (in != NULL && (c = fgetc(in)) != EOF) {
+        data.push_back(c);
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    TmStats stats;
+    Packets packets = decode(data, &stats);
+    int counters = 0, profiles = 0, unknown = 0;
+    unsigned hits = 0;
+    TmPicCounters first = {}, pic = {};
+    for (const std::string& p : packets) {
+        TmPacket packet = {(uint8_t)p[1], (uint8_t)p[2], (const uint8_t*)p.data() + 3};
+        if (packet.type != TM_MASTER) {
+            continue;
+        }
+        int page = tm_Page(&packet);
+        if (page == TM_PAGE_COUNTERS) {
+            tm_PicCounters(&packet, &pic);
+            first = (counters++ == 0) ? pic : first;
+        } else if (page == TM_PAGE_PROFILE) {
+            profiles++;
+        } else {
+            unknown++;
+        }
+    }
+    for (int i = 0; i < TM_TARGETS; i++) {
+        hits += (uint16_t)(pic.hits[i] - first.hits[i]);
+    }
+    char line[120];
+    snprintf(line, sizeof(line), "%lu packets, %d PIC counters and %d profile pages, %u hits", stats.packets,
+             counters, profiles, hits);
+    check(stats.skipped == 0 && unknown == 0 && counters > 10 && profiles > 10 && hits > 0, line);
+
+    FILE* tool = popen("build/telemetry --quiet build/sim.telemetry", "r");
+    char text[200];
+    bool summary = false;
+    while (tool != NULL && fgets(text, sizeof(text), tool) != NULL) {
+        summary |= strstr(text, " 0 bad checksums, 0 bad lengths, 0 bytes skipped, 0 unknown master pages") != NULL;
+    }
+    check(tool != NULL && pclose(tool) == 0 && summary, "the telemetry tool reads it all");
+}
+
+int main() {
+    testSketch();
+    testDamage();
+    testMasterLost();
+    testSim();
+    return checkSummary();
+}
@@ -0,0 +1,103 @@
+// Bus traffic per game with the shadow display (delta protocol), against
+// the fixed-rate protocol the firmware used to send.
+// The i2c_* queue is mocked: every frame committed is counted and taken
+// off its channel right away, as if the slave read it at once.
+
+#include <stdio.h>
+#include <stdint.h>
+
+void countFrame(uint8_t address, const uint8_t* data, uint8_t length);
+#define I2C_TRACE_FRAME(address, frame) countFrame(address, (frame)->data, (frame)->length)
+#include "pic_firmware.h"
+#include "check.h"
+
+typedef struct {
+    unsigned long transactions;
+    unsigned long bytes;        // on the bus, the address byte included
+} Traffic;
+
+Traffic display;     // frames for the scoreboards
+Traffic telemetry;   // 0x0D frames, counted apart, the old firmware had none
+
+void countFrame(uint8_t address, const uint8_t* data, uint8_t length) {
+    (void)address;
+    Traffic* traffic = (data[0] == 0x0D || (data[0] == 0x06 && data[1] == 0x0D)) ? &telemetry : &display;
+    traffic->transactions++;
+    traffic->bytes += 1 + length;
+}
+
+// the mocked bus: every queued frame is gone by the next pass
+void drainPass(void) {
+    pic_MainPass();
+    for (uint8_t i = 0; i < I2C_CHANNELS; i++) {
+        i2cChannels[i].tail = i2cChannels[i].head;
+    }
+}
+
+// Traffic the fixed-rate firmware sent for the same game:
+// new game screen once, a clear, then text, score and balls every 200ms
+// of play, then a clear and two writes every second of the end screen
+Traffic fixedRate(uint32_t activeMs, uint32_t endMs, uint8_t won) {
+    Traffic t = {0, 0};
+    t.transactions += 3;
+    t.bytes += 2 + (4 + 3) + (4 + 8);             // clear, "NEW", "___GAME?"
+    t.transactions += 1;
+    t.bytes += 2;                                 // clear
+    uint32_t refreshes = (activeMs + 199) / 200;
+    t.transactions += refreshes * 3;
+    t.bytes += refreshes * ((4 + 5) + 4 + 3);     // "SCORE", score, balls
+    for (uint32_t s = 0; s < endMs / 1000; s++) {
+        t.transactions += 3;
+        if (won) {
+            t.bytes += 2 + ((s & 1) ? (4 + 5) + (4 + 8) : (4 + 3) + 4);   // "GREAT"/"_____JOB" or "MAX"/score
+        } else {
+            t.bytes += 2 + ((s & 1) ? (4 + 4) + (4 + 8) : (4 + 5) + 4);   // "GAME"/"____OVER" or "SCORE"/score
+        }
+    }
+    return t;
+}
+
+int main(void) {
+    const int games = 20;
+    const uint8_t targets[CORE_TARGETS] = {EVENT_RB7, EVENT_RA0, EVENT_RA1, EVENT_RA4};
+    srand(1);
+    pic_Boot();
+    picMainPass = drainPass;
+    pic_RunMs(1000);
+
+    Traffic delta = {0, 0};
+    Traffic fixed = {0, 0};
+    printf("game  play s  delta tx  bytes  fixed tx  bytes\n");
+    for (int g = 0; g < games; g++) {
+        Traffic before = display;
+        pic_Press(EVENT_START, 40);
+        uint64_t start = picNanos;
+        while (game.state == STATE_ACTIVE_GAME) {
+            pic_RunMs(1500 + rand() % 2500);
+            pic_Press(targets[rand() % CORE_TARGETS], 40);
+            pic_RunMs(20);
+        }
+        uint32_t activeMs = (picNanos - start) / PIC_MS;
+        uint8_t won = (game.state == STATE_WIN_GAME);
+        const uint32_t endMs = 5000;
+        pic_RunMs(endMs);
+        pic_Press(EVENT_START, 40);
+        pic_RunMs(1000);
+
+        Traffic game = {display.transactions - before.transactions, display.bytes - before.bytes};
+        Traffic old = fixedRate(activeMs, endMs, won);
+        printf("%4d  %6.1f  %8lu  %5lu  %8lu  %5lu\n", g, activeMs / 1000.0,
+               game.transactions, game.bytes, old.transactions, old.bytes);
+        delta.transactions += game.transactions;
+        delta.bytes += game.bytes;
+        fixed.transactions += old.transactions;
+        fixed.bytes += old.bytes;
+    }
+    printf("total: delta %lu transactions %lu bytes, fixed rate %lu transactions %lu bytes (%.1f%% of the bytes)\n",
+           delta.transactions, delta.bytes, fixed.transactions, fixed.bytes, 100.0 * delta.bytes / fixed.bytes);
+    printf("telemetry on top: %lu transactions %lu bytes\n", telemetry.transactions, telemetry.bytes);
+
+    check(delta.bytes * 4 <= fixed.bytes && delta.transactions * 4 <= fixed.transactions,
+          "the delta protocol sends under a quarter of the fixed-rate traffic");
+    return checkSummary();
+}
@@ -0,0 +1,176 @@
+// A compact binary trace of what happened on the bus and the switches,
+// recorded by the sim (--trace FILE) and played back by replay. A file is
+// TRACE_MAGIC, then records of
+//   [0] type
+//   [1..] time since the record before, in us, 7 bits a byte, low first,
+//         the top bit set on every byte but the last
+//   then the payload:
+//   TRACE_WRITE   address, length, the bytes the sketch received
+//   TRACE_SWITCH  EVENT_ bits, 1 closed or 0 opened
+//   TRACE_GAME    nothing, a game was started
+//   TRACE_CHECK   4 bytes, trace_Hash() of leds[] after the writes before
+//                 it, low byte first; written by replay --bless
+//   TRACE_END     nothing, the last record
+// A write of 32 bytes takes 36 bytes of trace, a quiet spell no bytes.
+
+#ifndef HOST_TRACE_H
+#define HOST_TRACE_H
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TRACE_MAGIC "SBT1"
+#define TRACE_END 0x00
+#define TRACE_WRITE 0x01
+#define TRACE_SWITCH 0x02
+#define TRACE_GAME 0x03
+#define TRACE_CHECK 0x04
+#define TRACE_PAYLOAD_MAX 255
+
+typedef struct {
+    uint8_t type;
+    uint64_t us;                     // since the trace started
+    uint8_t length;                  // of payload
+    uint8_t payload[TRACE_PAYLOAD_MAX];
+} TraceRecord;
+
+typedef struct {
+    FILE* file;
+    uint64_t us;                     // time of the last record
+} Trace;
+
+// opens a trace to write, false if the file cannot be created
+static int trace_Create(Trace* trace, const char* path) {
+    trace->file = fopen(path, "wb");
+    trace->us = 0;
+    if (trace->file == NULL) {
+        return 0;
+    }
+    fwrite(TRACE_MAGIC, 1, 4, trace->file);
+    return 1;
+}
+
+// opens a trace to read, false if it is missing or not a trace
+static int trace_Open(Trace* trace, const char* path) {
+    char magic[4];
+    trace->file = fopen(path, "rb");
+    trace->us = 0;
+    if (trace->file == NULL) {
+        return 0;
+    }
+    if (fread(magic, 1, 4, trace->file) != 4 || memcmp(magic, TRACE_MAGIC, 4) != 0) {
+        fclose(trace->file);
+        trace->file = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+// appends a record at us, a time before the last record's is taken as the same
+static void trace_Put(Trace* trace, uint8_t type, uint64_t us, const uint8_t* payload, uint8_t length) {
+    uint64_t delta = (us > trace->us) ? us - trace->us : 0;
+    trace->us += delta;
+    fputc(type, trace->file);
+    do {
+        uint8_t byte = delta & 0x7F;
+        delta >>= 7;
+        fputc(byte | (delta ? 0x80 : 0), trace->file);
+    } while (delta);
+    if (length > 0) {
+        fwrite(payload, 1, length, trace->file);
+    }
+}
+
+static void trace_PutWrite(Trace* trace, uint64_t us, uint8_t address, const uint8_t* data, uint8_t length) {
+    uint8_t payload[TRACE_PAYLOAD_MAX];
+    if (length > TRACE_PAYLOAD_MAX - 2) {
+        length = TRACE_PAYLOAD_MAX - 2;
+    }
+    payload[0] = address;
+    payload[1] = length;
+    memcpy(payload + 2, data, length);
+    trace_Put(trace, TRACE_WRITE, us, payload, 2 + length);
+}
+
+static void trace_PutCheck(Trace* trace, uint64_t us, uint32_t hash) {
+    uint8_t payload[4] = {(uint8_t)hash, (uint8_t)(hash >> 8), (uint8_t)(hash >> 16), (uint8_t)(hash >> 24)};
+    trace_Put(trace, TRACE_CHECK, us, payload, 4);
+}
+
+// writes TRACE_END and closes the file
+static void trace_Close(Trace* trace) {
+    if (trace->file == NULL) {
+        return;
+    }
+    trace_Put(trace, TRACE_END, trace->us, NULL, 0);
+    fclose(trace->file);
+    trace->file = NULL;
+}
+
+// reads the next record, returns its type, TRACE_END at the end of the
+// file and on a cut short or unknown record
+static uint8_t trace_Get(Trace* trace, TraceRecord* record) {
+    int type = fgetc(trace->file);
+    uint64_t delta = 0;
+    int shift = 0;
+    int byte;
+    record->type = TRACE_END;
+    record->length = 0;
+    if (type == EOF) {
+        return TRACE_END;
+    }
+    do {
+        byte = fgetc(trace->file);
+        if (byte == EOF || shift > 56) {
+            return TRACE_END;
+        }
+        delta |= (uint64_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    trace->us += delta;
+    record->us = trace->us;
+    switch (type) {
+        case TRACE_WRITE: {
+            uint8_t header[2];
+            if (fread(header, 1, 2, trace->file) != 2 || header[1] > TRACE_PAYLOAD_MAX - 2 ||
+                fread(record->payload + 2, 1, header[1], trace->file) != header[1]) {
+                return TRACE_END;
+            }
+            memcpy(record->payload, header, 2);
+            record->length = 2 + header[1];
+            break;
+        }
+        case TRACE_SWITCH:
+            record->length = 2;
+            break;
+        case TRACE_CHECK:
+            record->length = 4;
+            break;
+        case TRACE_GAME:
+        case TRACE_END:
+            break;
+        default:
+            return TRACE_END;
+    }
+    if (type != TRACE_WRITE && fread(record->payload, 1, record->length, trace->file) != record->length) {
+        return TRACE_END;
+    }
+    record->type = type;
+    return type;
+}
+
+static uint32_t trace_CheckHash(const TraceRecord* record) {
+    return record->payload[0] | (record->payload[1] << 8) | ((uint32_t)record->payload[2] << 16) |
+           ((uint32_t)record->payload[3] << 24);
+}
+
+// FNV-1a over a framebuffer
+static uint32_t trace_Hash(const uint8_t* data, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+#endif
@@ -4,92 +4,467 @@
 #define I2C_WRITE 0
 #define I2C_READ 1
 
+// Every lane has its own PIC and scoreboard, and all of them share one bus
+// with the overhead leaderboard. Build each lane's PIC with its LANE_NUMBER
+// and its scoreboard's sketch with the matching SLAVE_ADDRESS.
+#ifndef LANE_NUMBER
+#define LANE_NUMBER 0            // 0 to LANES_MAX - 1
+#endif
+#define LANES_MAX 7              // one frame from each fits in the leaderboard's receive ring
+#define LANE_ADDRESS(lane) (0x04 + (lane))   // lane scoreboards at 0x04 to 0x0A
+#ifndef ARDUINO_ADDRESS
+#define ARDUINO_ADDRESS LANE_ADDRESS(LANE_NUMBER)   // address of this lane's Arduino
+#endif
+#ifndef LEADERBOARD_ADDRESS
+#define LEADERBOARD_ADDRESS 0x0B // address of the overhead leaderboard Arduino
+#endif
+#if LANE_NUMBER >= LANES_MAX
+#error "LANE_NUMBER must be below LANES_MAX"
+#endif
+#define I2C_GENERAL_CALL 0x00    // the lane scoreboards also listen on the general call address
+#define I2C_FRAME_MAX 32         // largest frame, matches the Arduino's BUFFER_SIZE
+#define I2C_CHANNEL_QUEUE 4      // frame slots per channel, must be a power of two
+
+// Every display has its own channel, a small frame ring with its own credits,
+// and the bus takes the channels in turn. A display that is busy or missing
+// only holds up its own frames. The last channel is the general call,
+// one frame that reaches every lane's scoreboard at once. A host test can
+// list other addresses to put more displays on one master, the general
+// call still last.
+#define I2C_CHANNEL_LANE 0
+#define I2C_CHANNEL_LEADERBOARD 1
+#ifndef I2C_ADDRESSES
+#define I2C_ADDRESSES {ARDUINO_ADDRESS, LEADERBOARD_ADDRESS, I2C_GENERAL_CALL}
+#define I2C_CHANNELS 3
+#endif
+#define I2C_CHANNEL_BROADCAST (I2C_CHANNELS - 1)
+// Bus clock, 100000 unless the build asks for 400000, which every slave on
+// the bus and its wiring must then be good for. The ATmega328P's TWI is
+// only specified up to 400KHz as a slave, so faster is refused. The MSSP
+// divides Fosc/4 by SSP1ADD + 1, so the divisor comes from _XTAL_FREQ at
+// compile time.
+#ifndef I2C_BUS_HZ
+#define I2C_BUS_HZ 100000UL
+#endif
+#if I2C_BUS_HZ != 100000UL && I2C_BUS_HZ != 400000UL
+#error "I2C_BUS_HZ must be 100000 or 400000, the Arduino's TWI cannot go faster"
+#endif
+#define I2C_BAUD_DIVISOR (_XTAL_FREQ / (4UL * I2C_BUS_HZ) - 1)
+#if I2C_BAUD_DIVISOR < 3 || I2C_BAUD_DIVISOR > 255
+#error "I2C_BUS_HZ cannot be reached from _XTAL_FREQ, SSP1ADD must be 3 to 255"
+#endif
+#if I2C_BUS_HZ == 400000UL
+#define I2C_SLEW 0x00            // SMP clear, slew rate control is meant for 400KHz
+#else
+#define I2C_SLEW 0x80            // SMP set, slew rate control off at 100KHz
+#endif
+
+#define I2C_POLL_MS 2            // wait before asking again when the Arduino has no room
+#define I2C_MISSING_MS 50        // wait before trying again when nobody answered the address
+
+// Built with I2C_FIXED_GAP_MS set, frames go out the old way instead: no
+// status read, a fixed wait after every frame. Only there so the host sim
+// can measure what the credits save (host/test_flow.cpp).
+#ifndef I2C_FIXED_GAP_MS
+#define I2C_FIXED_GAP_MS 0
+#endif
+
+// Status block the Arduino returns on a read. Frames are only sent while
+// the last status said there is room for them (credits), so the PIC never
+// overruns the Arduino's receive ring and never waits longer than it must.
+#define I2C_STATUS_SIZE 6
+#define I2C_STATUS_PROCESSED 0   // frames the Arduino has processed, wraps at 256
+#define I2C_STATUS_FLAGS 1       // I2C_STATUS_BUSY, I2C_STATUS_WAITING
+#define I2C_STATUS_FREE 2        // frames the receive ring can still take
+#define I2C_STATUS_DROPPED 3     // frames lost because the ring was full, stops at 255
+#define I2C_STATUS_MALFORMED 4   // frames rejected for a bad command or length, stops at 255
+#define I2C_STATUS_REJECTED 5    // streamed frames dropped, stops at 255
+#define I2C_STATUS_BUSY 0x01     // the Arduino is in show()
+#define I2C_STATUS_WAITING 0x02  // a frame is waiting for the bus to go quiet so it can be shown
+#define I2C_STATUS_HOLD (I2C_STATUS_BUSY | I2C_STATUS_WAITING)   // either gives no credits
+
+// animations the Arduino keeps in flash
+#define ANIM_WIN 0               // gold columns and a white flash
+#define ANIM_DRAIN 1             // the ball leds flash red
+#define ANIM_ATTRACT 2           // columns sweeping across the screen
+#define ANIM_STOP 0xFF           // stops the animation that is playing
+#define ANIM_RETURN 0x01         // flag: show the scoreboard again when it ends
+
+// Trace hook, called with every frame and its address as it is handed to
+// the interrupt. Empty here; a capture or test build can define it before
+// including this file to record the traffic for replay.
+#ifndef I2C_TRACE_FRAME
+#define I2C_TRACE_FRAME(address, frame)
+#endif
+
+// states of the MSSP interrupt state machine
+#define I2C_IDLE 0               // nothing on the bus
+#define I2C_START 1              // start condition issued
+#define I2C_SEND 2               // address or payload byte issued
+#define I2C_STOP 3               // stop condition issued
+#define I2C_READ_ADDRESS 4       // address issued in read mode
+#define I2C_RECEIVE 5            // receiving a status byte
+#define I2C_ACK 6                // acking a status byte
+
+// one queued I2C write transaction
+typedef struct {
+    uint8_t length;
+    uint8_t data[I2C_FRAME_MAX];
+} I2cFrame;
+
+// frames waiting for one slave
+typedef struct {
+    I2cFrame frames[I2C_CHANNEL_QUEUE];
+    volatile uint8_t head;       // next free slot, only written by the main loop
+    volatile uint8_t tail;       // next frame to send, only written by the interrupt
+    uint8_t address;
+    volatile uint8_t credits;    // frames the slave can take before its status is read again
+    volatile uint8_t gap;        // ms before this channel may use the bus again
+    volatile uint8_t missing;    // the slave did not answer its address last time
+    uint8_t fence;               // head when the last general call was queued, only written by the main loop
+} I2cChannel;
+
+const uint8_t i2cAddresses[I2C_CHANNELS] = I2C_ADDRESSES;
+I2cChannel i2cChannels[I2C_CHANNELS];
+volatile uint8_t i2cChannel = 0;     // channel on the bus, or the last one that was
+volatile uint8_t i2cState = I2C_IDLE;
+volatile uint8_t i2cIndex = 0;       // next payload byte of the frame on the bus
+volatile uint8_t i2cReading = 0;     // the transaction on the bus is a status read
+uint8_t i2cStatus[I2C_STATUS_SIZE];  // last status block read from a display
+volatile uint8_t i2cNackCount = 0;   // frames dropped because the slave did not ack
+volatile uint8_t i2cCollisionCount = 0; // bus collisions, the frame is retried
+volatile uint8_t i2cFullCount = 0;   // enqueue attempts refused because a channel was full
+
 void i2c_Init(void) {
-    // Initialize I2C MSSP 1 module in Master mode at 100KHz
+    // Initialize I2C MSSP 1 module in Master mode at I2C_BUS_HZ
     TRISB4 = 1;              // Set SCL pin as input
     TRISB6 = 1;              // Set SDA pin as input
     SSP1CON1 = 0b00101000;   // Enable I2C, set Master mode
     SSP1CON2 = 0x00;         // Clear SSP1CON2 register
-    SSP1ADD = 79;            // Set clock at 100KHz with 4MHz Fosc
-    SSP1STAT = 0b11000000;   // Disable slew rate
-}
-
-void i2c_Wait(void) {
-    // Wait for I2C transfer to finish
-    while ((SSP1CON2 & 0x1F) || (SSP1STAT & 0x04));
-}
-
-void i2c_Start(void) {
-    // Start I2C communication
-    i2c_Wait();
-    SSP1CON2bits.SEN = 1;
-}
-
-void i2c_Stop(void) {
-    // Stop I2C communication
-    i2c_Wait();
-    SSP1CON2bits.PEN = 1;
-}
-
-void i2c_Write(unsigned char data) {
-    // Send one byte of data
-    i2c_Wait();
-    SSP1BUF = data;
-}
-
-void i2c_Address(unsigned char address, unsigned char mode) {
-    // Send slave address and read/write mode (I2C_WRITE or I2C_READ)
-    unsigned char l_address;
-    l_address = address << 1;
-    l_address += mode;
-    i2c_Wait();
-    SSP1BUF = l_address;
-}
-
-// prints a message on the led matrix
-// first pass 0x01 or 0x02 for top or bottom row
-// second pass a color 0-9
-// third pass the message
-void i2c_WriteToArduino(char command,int color, const char* message) {
-    i2c_Start();                    // Start I2C communication
-    i2c_Address(0x04, I2C_WRITE);   // Address the Arduino configured to listen at 0x04
-    i2c_Write(command);             // Send the command byte first
-    i2c_Write(color);
-    i2c_Write(strlen(message));     // Send the length of the message
-    
-    // Send each character of the message
-    for (int i = 0; message[i] != '\0'; i++) {
-        i2c_Write(message[i]); 
-    }
-    i2c_Stop();
-}
-
-// Function to send a number to the Arduino for display
-// This one is different from write because it can take an Int
-// the display from this is right adjudicated on the bottom row in red text
-void i2c_WriteScoreToArduino(int16_t number) {
-    i2c_Start();                        // Start I2C communication
-    i2c_Address(0x04, I2C_WRITE);       // Address the Arduino configured to listen at 0x04
-    i2c_Write(0x03);                    // Command byte for sending a number
-    // Send the high byte first, then the low byte 
-    i2c_Write((number >> 8) & 0xFF);     // Send the high byte
-    i2c_Write(number & 0xFF);            // Send the low byte
-    i2c_Stop();                         // Stop I2C communication
-}
-
-// function that takes an int and displays that many pixels to represent balls
-void i2c_SendBallCount(uint8_t ballCount) {
-    i2c_Start();                           // Start I2C communication
-    i2c_Address(0x04, I2C_WRITE);          // Address the Arduino
-    i2c_Write(0x04);                       // Command byte for sending ball count 
-    i2c_Write(ballCount);                  // Send the ball count
-    i2c_Stop();                            // Stop I2C communication
-}
-
-// aimple clear screen function. this wipes the entire led matrix
-void i2c_clearScreen() {
-    i2c_Start();                           // Start I2C communication
-    i2c_Address(0x04, I2C_WRITE);           // Address the Arduino
-    i2c_Write(0x05);                       // Command byte clearing screen
-    i2c_Stop();                            // Stop I2C communication
+    SSP1ADD = I2C_BAUD_DIVISOR;
+    SSP1STAT = I2C_SLEW | 0b01000000;   // SMBus input levels
+
+    for (uint8_t i = 0; i < I2C_CHANNELS; i++) {
+        i2cChannels[i].address = i2cAddresses[i];
+    }
+
+    // The queues are drained from the MSSP interrupt
+    PIR1bits.SSP1IF = 0;
+    PIR2bits.BCL1IF = 0;
+    PIE1bits.SSP1IE = 1;     // Interrupt on start, byte, and stop completion
+    PIE2bits.BCL1IE = 1;     // Interrupt on bus collision
+    INTCONbits.PEIE = 1;
+}
+
+// returns the slot for a new frame on a channel, or NULL when it is full
+// the frame is only sent once i2c_CommitFrame() is called
+I2cFrame* i2c_BeginFrame(uint8_t channel) {
+    I2cChannel* queue = &i2cChannels[channel];
+    uint8_t next = (queue->head + 1) & (I2C_CHANNEL_QUEUE - 1);
+    if (next == queue->tail) {
+        i2cFullCount++;
+        return NULL;
+    }
+    queue->frames[queue->head].length = 0;
+    return &queue->frames[queue->head];
+}
+
+// hands the frame from i2c_BeginFrame() to the interrupt
+// the frames queued for each display so far go before a general call
+void i2c_CommitFrame(uint8_t channel) {
+    I2cChannel* queue = &i2cChannels[channel];
+    if (channel == I2C_CHANNEL_BROADCAST) {
+        for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+            i2cChannels[i].fence = i2cChannels[i].head;
+        }
+    }
+    I2C_TRACE_FRAME(queue->address, &queue->frames[queue->head]);
+    queue->head = (queue->head + 1) & (I2C_CHANNEL_QUEUE - 1);
+}
+
+// Starts the next transaction, taking the channels round robin from the one
+// after the last that had the bus. A channel sends its next frame while it
+// has credits, otherwise it reads the slave's status first.
+// The general call has no status of its own, so it goes only once every
+// display has sent what was queued before it and has a credit left, or did
+// not answer its address. Until then a display that is through to it holds
+// back what was queued after it, and reads its status if it has no credit.
+void i2c_StartNext(void) {
+    I2cChannel* broadcast = &i2cChannels[I2C_CHANNEL_BROADCAST];
+    uint8_t waiting = (broadcast->head != broadcast->tail && !I2C_FIXED_GAP_MS);
+    uint8_t ready = waiting;
+    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+        I2cChannel* display = &i2cChannels[i];
+        ready = ready && ((display->tail == display->fence && display->credits > 0) || display->missing);
+    }
+    for (uint8_t i = 1; i <= I2C_CHANNELS; i++) {
+        uint8_t index = i2cChannel + i;
+        if (index >= I2C_CHANNELS) {
+            index -= I2C_CHANNELS;
+        }
+        I2cChannel* queue = &i2cChannels[index];
+        uint8_t queued = (queue->head != queue->tail);
+        uint8_t start = queued;
+        if (index == I2C_CHANNEL_BROADCAST) {
+            start = I2C_FIXED_GAP_MS ? queued : ready;
+        } else if (waiting && queue->tail == queue->fence) {
+            start = (queue->credits == 0);
+        }
+        if (queue->gap == 0 && start) {
+            i2cChannel = index;
+            i2cReading = (queue->credits == 0 && index != I2C_CHANNEL_BROADCAST && !I2C_FIXED_GAP_MS);
+            i2cState = I2C_START;
+            SSP1CON2bits.SEN = 1;
+            return;
+        }
+    }
+}
+
+// Called from the Timer0 interrupt every ms
+// counts down the channel waits and starts frames committed while the bus was idle
+void i2c_Tick(void) {
+    for (uint8_t i = 0; i < I2C_CHANNELS; i++) {
+        if (i2cChannels[i].gap > 0) {
+            i2cChannels[i].gap--;
+        }
+    }
+    if (i2cState == I2C_IDLE) {
+        i2c_StartNext();
+    }
+}
+
+// Called from the interrupt when SSP1IF is set
+// each call issues the next step of the transaction on the bus, either
+// the oldest frame of the channel or a status read from its slave
+void i2c_Isr(void) {
+    I2cChannel* queue = &i2cChannels[i2cChannel];
+    I2cFrame* frame = &queue->frames[queue->tail];
+
+    switch (i2cState) {
+        case I2C_START:
+            // Start done, send slave address in write or read mode
+            i2cIndex = 0;
+            if (i2cReading) {
+                i2cState = I2C_READ_ADDRESS;
+                SSP1BUF = (uint8_t)(queue->address << 1) | I2C_READ;
+            } else {
+                i2cState = I2C_SEND;
+                SSP1BUF = (uint8_t)(queue->address << 1) | I2C_WRITE;
+            }
+            break;
+        case I2C_SEND:
+            if (SSP1CON2bits.ACKSTAT) {
+                // Slave did not answer, give up on this frame
+                i2cNackCount++;
+                queue->credits = 0; // and read its status before the next one
+                queue->gap = I2C_MISSING_MS;
+                queue->missing = 1;
+                i2cState = I2C_STOP;
+                SSP1CON2bits.PEN = 1;
+            } else if (i2cIndex < frame->length) {
+                SSP1BUF = frame->data[i2cIndex++];
+            } else {
+                i2cState = I2C_STOP;
+                SSP1CON2bits.PEN = 1;
+            }
+            break;
+        case I2C_READ_ADDRESS:
+            if (SSP1CON2bits.ACKSTAT) {
+                // Slave did not answer, ask again later
+                i2cNackCount++;
+                queue->gap = I2C_MISSING_MS;
+                queue->missing = 1;
+                i2cState = I2C_STOP;
+                SSP1CON2bits.PEN = 1;
+            } else {
+                queue->missing = 0;
+                i2cState = I2C_RECEIVE;
+                SSP1CON2bits.RCEN = 1;
+            }
+            break;
+        case I2C_RECEIVE:
+            // Byte in, ack it unless it is the last one
+            i2cStatus[i2cIndex++] = SSP1BUF;
+            i2cState = I2C_ACK;
+            SSP1CON2bits.ACKDT = (i2cIndex == I2C_STATUS_SIZE);
+            SSP1CON2bits.ACKEN = 1;
+            break;
+        case I2C_ACK:
+            if (i2cIndex < I2C_STATUS_SIZE) {
+                i2cState = I2C_RECEIVE;
+                SSP1CON2bits.RCEN = 1;
+            } else {
+                i2cState = I2C_STOP;
+                SSP1CON2bits.PEN = 1;
+            }
+            break;
+        case I2C_STOP:
+            i2cState = I2C_IDLE;
+            if (i2cReading) {
+                // A complete status sets the credits, a NACK leaves them at 0.
+                // The leaderboard's ring is shared with the other lanes'
+                // PICs, so each takes one frame of it per read and all the
+                // lanes together still fit.
+                if (i2cIndex == I2C_STATUS_SIZE && !(i2cStatus[I2C_STATUS_FLAGS] & I2C_STATUS_HOLD)) {
+                    queue->credits = i2cStatus[I2C_STATUS_FREE];
+                    if (queue->address == LEADERBOARD_ADDRESS && queue->credits > 1) {
+                        queue->credits = 1;
+                    }
+                }
+                if (queue->credits == 0 && queue->gap == 0) {
+                    queue->gap = I2C_POLL_MS;   // Let the Arduino catch up or show() first
+                }
+            } else {
+                // Write done, release the slot
+                queue->tail = (queue->tail + 1) & (I2C_CHANNEL_QUEUE - 1);
+                if (queue->credits > 0) {
+                    queue->credits--;
+                }
+                if (i2cChannel == I2C_CHANNEL_BROADCAST) {
+                    // the general call took a slot on every display
+                    for (uint8_t i = 0; i < I2C_CHANNEL_BROADCAST; i++) {
+                        if (i2cChannels[i].credits > 0) {
+                            i2cChannels[i].credits--;
+                        }
+                    }
+                }
+#if I2C_FIXED_GAP_MS
+                queue->gap = I2C_FIXED_GAP_MS;
+#endif
+            }
+            i2c_StartNext();
+            break;
+    }
+}
+
+// Called from the interrupt when BCL1IF is set
+// the module is already idle, so the same transaction is started again after a wait
+void i2c_Collision(void) {
+    i2cCollisionCount++;
+    i2cState = I2C_IDLE;
+    i2cChannels[i2cChannel].gap = I2C_POLL_MS;
+}
+
+// The Put functions append one command to a frame and return 0 if it does not fit.
+// A single command can be sent on its own, or several can be packed behind a
+// 0x06 batch byte so the Arduino applies them together with one show().
+
+// text command: 0x01 top row or 0x02 bottom row, color, length, characters
+// characters that do not fit in the frame are dropped
+uint8_t i2c_PutText(I2cFrame* frame, char command, int color, const char* message) {
+    uint8_t length = strlen(message);
+    if (frame->length + 3 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    if (length > I2C_FRAME_MAX - 3 - frame->length) {
+        length = I2C_FRAME_MAX - 3 - frame->length;
+    }
+    frame->data[frame->length++] = command;   // Send the command byte first
+    frame->data[frame->length++] = color;
+    frame->data[frame->length++] = length;    // Send the length of the message
+    memcpy(&frame->data[frame->length], message, length);
+    frame->length += length;
+    return 1;
+}
+
+// score command: 0x0C, high byte, low byte, color
+// the Arduino draws up to 5 digits, 0 to 65535
+uint8_t i2c_PutScore(I2cFrame* frame, uint16_t number, int color) {
+    if (frame->length + 4 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    frame->data[frame->length++] = 0x0C;
+    frame->data[frame->length++] = (number >> 8) & 0xFF;
+    frame->data[frame->length++] = number & 0xFF;
+    frame->data[frame->length++] = color;
+    return 1;
+}
+
+// ball command: 0x04, ball count
+uint8_t i2c_PutBalls(I2cFrame* frame, uint8_t ballCount) {
+    if (frame->length + 2 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    frame->data[frame->length++] = 0x04;
+    frame->data[frame->length++] = ballCount;
+    return 1;
+}
+
+// clear command: 0x05
+uint8_t i2c_PutClear(I2cFrame* frame) {
+    if (frame->length + 1 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    frame->data[frame->length++] = 0x05;
+    return 1;
+}
+
+// marquee command: 0x08, row, color, ms per column, flags, length, characters
+// the Arduino scrolls the message on its own until told otherwise
+// characters that do not fit in the frame are dropped
+uint8_t i2c_PutMarquee(I2cFrame* frame, char row, int color, uint8_t stepMs, uint8_t flags, const char* message) {
+    uint8_t length = strlen(message);
+    if (frame->length + 6 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    if (length > I2C_FRAME_MAX - 6 - frame->length) {
+        length = I2C_FRAME_MAX - 6 - frame->length;
+    }
+    frame->data[frame->length++] = 0x08;
+    frame->data[frame->length++] = row;
+    frame->data[frame->length++] = color;
+    frame->data[frame->length++] = stepMs;
+    frame->data[frame->length++] = flags;
+    frame->data[frame->length++] = length;
+    memcpy(&frame->data[frame->length], message, length);
+    frame->length += length;
+    return 1;
+}
+
+// lane best command: 0x0E, lane, high byte, low byte
+// the leaderboard keeps the best of every lane and shows the top one
+uint8_t i2c_PutLaneBest(I2cFrame* frame, uint8_t lane, uint16_t number) {
+    if (frame->length + 4 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    frame->data[frame->length++] = 0x0E;
+    frame->data[frame->length++] = lane;
+    frame->data[frame->length++] = (number >> 8) & 0xFF;
+    frame->data[frame->length++] = number & 0xFF;
+    return 1;
+}
+
+// telemetry command: 0x0D, length, then the counters
+// the Arduino passes them on with its own telemetry as they are
+uint8_t i2c_PutTelemetry(I2cFrame* frame, const uint8_t* data, uint8_t length) {
+    if (frame->length + 2 + length > I2C_FRAME_MAX) {
+        return 0;
+    }
+    frame->data[frame->length++] = 0x0D;
+    frame->data[frame->length++] = length;
+    memcpy(&frame->data[frame->length], data, length);
+    frame->length += length;
+    return 1;
+}
+
+// animation command: 0x0B, animation, times to play it (0 until stopped), flags
+uint8_t i2c_PutAnimation(I2cFrame* frame, uint8_t animation, uint8_t repeats, uint8_t flags) {
+    if (frame->length + 4 > I2C_FRAME_MAX) {
+        return 0;
+    }
+    frame->data[frame->length++] = 0x0B;
+    frame->data[frame->length++] = animation;
+    frame->data[frame->length++] = repeats;
+    frame->data[frame->length++] = flags;
+    return 1;
+}
+
+// starts a batch frame, the commands put into it are applied in order
+I2cFrame* i2c_BeginBatch(uint8_t channel) {
+    I2cFrame* frame = i2c_BeginFrame(channel);
+    if (frame != NULL) {
+        frame->data[0] = 0x06;               // Command byte for a batch of commands
+        frame->length = 1;
+    }
+    return frame;
 }
@@ -16,45 +16,95 @@
 #pragma config BORV = LO        // Brown-out Reset Voltage Selection (Brown-out Reset Voltage (Vbor), low trip point selected.)
 #pragma config LVP = ON        // Low-Voltage Programming Enable (Low-voltage programming enabled)
 
+#define _XTAL_FREQ 32000000     // Define clock frequency of 32MHz for delay calculations
+
 #include <xc.h>
 #include <string.h>
 #include <stdint.h>
 #include "i2c_arduino.h"       // Custom header for I2C communication with Arduino
+#include "display_shadow.h"    // Shadow of the matrix so only changed fields are sent
+#include "scheduler.h"         // Fixed period tasks run from the main loop
+#include "game_core.h"         // Scoring rules, no hardware access
+#include "profile.h"           // min/max/avg timing of the hot paths
+#include "high_scores.h"       // Best scores kept in EEPROM
 
-#define _XTAL_FREQ 32000000     // Define clock frequency of 32MHz for delay calculations
-#define STATE_NEW_GAME 0        // Define state for a new game initialization
-#define STATE_ACTIVE_GAME 1     // Define state for active gameplay
-#define STATE_END_GAME 2        // Define state for game over
-#define STATE_WIN_GAME 3        // Define state when the player wins the game
-#define STATE_REVERSE_GAME 4    // Define state for reverse play
-#define TMR0_PRELOAD (256 - 250) // Preload for 1ms overflow in Timer0
-#define SCORE_LOCKOUT_TIME 1000   // Lockout period in ms after scoring to prevent score spam
-#define DEBOUNCE_CHECKS 5       // Number of checks during debouncing of switch
-#define DEBOUNCE_REQUIRED 3    // Number of consistent reads required for a debounced state
-#define EVENT_RB7 0x01  // Event flag for RB7 interrupt
-#define EVENT_RA0 0x02  // Event flag for RA0 interrupt
-#define EVENT_RA1 0x04  // Event flag for RA1 interrupt
-#define EVENT_RA4 0x08  // Event flag for RA4 interrupt
-
-
-volatile uint8_t eventFlag = 0;  // Global variable to store event flags
+#define LANE (&displays[DISPLAY_LANE])               // this lane's scoreboard
+#define LEADERBOARD (&displays[DISPLAY_LEADERBOARD]) // shared leaderboard
 
-volatile int16_t score = 0; // Current game score
-volatile int8_t balls = 10; // Balls remaining in the game
-volatile int currentState = STATE_NEW_GAME; // Current state of the game
+#define TMR0_PRELOAD (256 - 250) // Preload for 1ms overflow in Timer0
+#define EVENT_RB7 0x01  // Switch bit for RB7
+#define EVENT_RA0 0x02  // Switch bit for RA0
+#define EVENT_RA1 0x04  // Switch bit for RA1
+#define EVENT_RA4 0x08  // Switch bit for RA4
+#define EVENT_START 0x10 // Switch bit for the RC7 start button
+#define EVENT_TARGETS (EVENT_RB7 | EVENT_RA0 | EVENT_RA1 | EVENT_RA4)
+#define HIT_QUEUE_SIZE 8 // Target hits waiting for the main loop, must be a power of two
+
+// Trace hook for switch presses, called from the Timer0 tick with the
+// EVENT_ bits that were just pressed. Empty unless a capture build defines it.
+#ifndef TRACE_SWITCH
+#define TRACE_SWITCH(pressed, time)
+#endif
+
+
+// Debounced switches, one bit per switch, written only by the Timer0 tick
+volatile uint8_t switchState = 0;    // Current debounced state, 1 = active
+volatile uint8_t switchPressed = 0;  // Start button presses the main loop has not seen yet
+uint8_t debounceCount0 = 0;          // Low bit of each switch's vertical counter
+uint8_t debounceCount1 = 0;          // High bit of each switch's vertical counter
+
+GameCore game;              // State, score, balls and lockouts of the game being played
 volatile unsigned long millisCounter = 0; // Millisecond counter for timing
-volatile unsigned long lastScoreTime[4] = {0, 0, 0, 0}; // Time of last score per switch
-volatile uint8_t lastSwitchState[4] = {0, 0, 0, 0}; // Last debounced state of each switch
+
+// Every target hit is queued with the ms it was detected, so two hits
+// between polls are both seen and lockout is judged on the real hit time.
+// The Timer0 tick only moves hitHead and the main loop only moves hitTail.
+typedef struct {
+    uint8_t target;         // 0-3, same order as the EVENT_ bits
+    unsigned long time;     // millisCounter when the hit was debounced
+} HitEvent;
+
+HitEvent hitQueue[HIT_QUEUE_SIZE];
+volatile uint8_t hitHead = 0;          // next free slot
+volatile uint8_t hitTail = 0;          // oldest hit not yet scored
+volatile uint8_t hitOverflowCount = 0; // hits lost because the queue was full
+uint16_t hitLatencyMax = 0;            // longest ms from a hit to it being scored
+uint16_t hitCount[CORE_TARGETS];       // hits seen on each target, scored or not
+uint16_t loopCount = 0;                // passes of the main loop since the last telemetry
 
 // Function to safely read the millisecond counter
+// The tick can land between the bytes of the read, so it is read again
+// until two reads agree. Interrupts stay on, the switches are never held up.
 unsigned long millis(void) {
     unsigned long m;
-    INTCONbits.GIE = 0;            // Disable global interrupts
-    m = millisCounter;
-    INTCONbits.GIE = 1;            // Re-enable global interrupts
+    do {
+        m = millisCounter;
+    } while (m != millisCounter);
     return m;
 }
 
+// Returns the free running Timer1 count, 1us per count, wraps every 65ms
+// TMR1L can roll over into TMR1H between the two byte reads, so the high
+// byte is read again and the pair retried if it moved
+uint16_t timer_Micros(void) {
+    uint8_t high;
+    uint8_t low;
+    do {
+        high = TMR1H;
+        low = TMR1L;
+    } while (high != TMR1H);
+    return ((uint16_t)high << 8) | low;
+}
+
+// Setup Timer1 as the free running microsecond count for profiling
+void setupTimer1() {
+    T1CONbits.TMR1CS = 0b00;   // Use the instruction cycle clock (FOSC/4), 8MHz
+    T1CONbits.T1CKPS = 0b11;   // Set the prescaler to 1:8, 1MHz
+    TMR1H = 0;
+    TMR1L = 0;
+    T1CONbits.TMR1ON = 1;      // Runs on its own, no interrupt
+}
+
 // Setup Timer0 for generating millisecond timebase
 void setupTimer0() {
     OPTION_REGbits.T0CS = 0;   // Use the internal instruction cycle clock (FOSC/4)
@@ -74,15 +124,21 @@ void initialSetup(){
     // Setup oscillator and clock at 32MHz with PLL on
     OSCCON = 0b11110000;
 
-    // Setup global interrupts
-    INTCON = 0b11011000;
+    // Setup global and peripheral interrupts
+    INTCON = 0b11000000;
     
     // Setup Timer0 for millis function
     setupTimer0();
+    setupTimer1();
     
     // Initialize I2C communication
     i2c_Init();
-    i2c_clearScreen();  // Clear any previous data on the screen
+    display_Init();
+    scores_Load();      // Newest high score record saved before the reset
+    for (uint8_t i = 0; i < DISPLAY_COUNT; i++) {
+        display_Clear(&displays[i]);    // Clear any previous data on the screens
+    }
+    display_FlushAll();
     
     // Enable internal weak pull-ups
     OPTION_REGbits.nWPUEN = 0;
@@ -98,402 +154,434 @@ void initialSetup(){
    
 }
 
-// Setup  4 micro switches for interrupts
+// Setup  4 micro switches as inputs
+// they are sampled and debounced by the Timer0 tick, so no interrupt-on-change is used
 void setupSwitches(){
-    // Configure RB7, RA0, RA1, and RA4 as inputs with pull-ups and interrupt-on-change
+    // Configure RB7, RA0, RA1, and RA4 as inputs with pull-ups
     // RB7 Switch
     TRISBbits.TRISB7 = 1;
     WPUBbits.WPUB7 = 1;
-    IOCBPbits.IOCBP7 = 1;
-    IOCBNbits.IOCBN7 = 0;
-    IOCBFbits.IOCBF7 = 0;
     
     // RA0 Switch
     TRISAbits.TRISA0 = 1;
     ANSELAbits.ANSA0 = 0;
     INLVLAbits.INLVLA0 = 1;
     WPUAbits.WPUA0 = 1;
-    IOCAPbits.IOCAP0 = 1;
-    IOCANbits.IOCAN0 = 0;
-    IOCAFbits.IOCAF0 = 0;
     
     // RA1 Switch
     TRISAbits.TRISA1 = 1;
     ANSELAbits.ANSA1 = 0;
     WPUAbits.WPUA1 = 1;
-    IOCAPbits.IOCAP1 = 1;
-    IOCANbits.IOCAN1 = 0;
-    IOCAFbits.IOCAF1 = 0;
     
     // RA4 Switch
     TRISAbits.TRISA4 = 1;
     WPUAbits.WPUA4 = 1;
     ANSELAbits.ANSA4 = 0;
-    IOCAPbits.IOCAP4 = 1;
-    IOCANbits.IOCAN4 = 0;
-    IOCAFbits.IOCAF4 = 0;
 }
 
-void clearEvents(){
-   eventFlag &= ~EVENT_RB7;
-   eventFlag &= ~EVENT_RA0;
-   eventFlag &= ~EVENT_RA1;
-   eventFlag &= ~EVENT_RA4;
-}
-// Improved Debounce Logic
-int debounceSwitch(int pin, int switchIndex) {
-    int readValue = (pin == 1) ? 1 : 0;  // Direct pin read replaced by a hypothetical read function if needed
-    int stableCount = 0;
-    int lastState = lastSwitchState[switchIndex];
-
-    for (int i = 0; i < DEBOUNCE_CHECKS; i++) {
-        __delay_ms(1);  // Delay for debounce check
-        int currentState = (pin == 1) ? 1 : 0;
-        
-        if (currentState == lastState) {
-            stableCount++;
-            if (stableCount >= DEBOUNCE_REQUIRED) {
-                lastSwitchState[switchIndex] = currentState;
-                return currentState;
-            }
-        } else {
-            stableCount = 0; // Reset count if state changes
-            lastState = currentState;  // Update last state for next comparison
-        }
-    }
-    lastSwitchState[switchIndex] = lastState;  // Persist the last checked state
-    return lastState; // Return the last stable state
+// Reads every switch into one byte, a set bit means the switch is active
+uint8_t sampleSwitches(void) {
+    uint8_t sample = 0;
+    if (PORTBbits.RB7) sample |= EVENT_RB7;
+    if (PORTAbits.RA0) sample |= EVENT_RA0;
+    if (PORTAbits.RA1) sample |= EVENT_RA1;
+    if (PORTAbits.RA4) sample |= EVENT_RA4;
+    if (!PORTCbits.RC7) sample |= EVENT_START;  // The start button pulls RC7 low
+    return sample;
 }
 
-// function for when a ball scores. takes integer for point value and adds it
-void ballIn(int points){
-    if (balls > 0){
-        score += points;
-        balls -= 1;
+// Records a target hit with the current time, called from the Timer0 tick
+void queueHit(uint8_t target) {
+    uint8_t next = (hitHead + 1) & (HIT_QUEUE_SIZE - 1);
+    if (next == hitTail) {
+        hitOverflowCount++;
+        return;
     }
-    
+    hitQueue[hitHead].target = target;
+    hitQueue[hitHead].time = millisCounter;
+    hitHead = next;
 }
 
-// reverse for when a ball scores. takes integer for point value and removes it
-void ballInReverse(int points){
-    if (balls < 10){
-        score -= points;
-        if (score < 0){
-            score = 0;
+// Debounces all switches at once, called from the Timer0 interrupt every ms.
+// Each switch has a 2 bit counter stored across debounceCount0/1 (a vertical
+// counter). The counter runs while the sample disagrees with the debounced
+// state and resets when it agrees, so a switch only changes state after
+// 4 samples in a row (4ms) that agree with each other.
+void debounceTick(void) {
+    uint8_t delta = sampleSwitches() ^ switchState;
+    debounceCount1 = (debounceCount1 ^ debounceCount0) & delta;
+    debounceCount0 = ~debounceCount0 & delta;
+    uint8_t toggled = delta & ~(debounceCount0 | debounceCount1);
+    switchState ^= toggled;
+
+    uint8_t pressed = toggled & switchState;
+    if (pressed) {
+        TRACE_SWITCH(pressed, millisCounter);
+    }
+    switchPressed |= pressed & EVENT_START;  // Remember start presses for the main loop
+    for (uint8_t i = 0; i < 4; i++) {
+        if (pressed & (1 << i)) {
+            queueHit(i);
         }
-        balls += 1;
     }
 }
 
-// returns current state of the start button
-int startButtonPressed() {
-    
-    return !PORTCbits.RC7; // Check RB7 as the start button
+// Returns the switches in mask that were pressed since the last call and clears them
+uint8_t takeSwitchPresses(uint8_t mask) {
+    uint8_t pressed;
+    INTCONbits.TMR0IE = 0;         // Hold off the Timer0 tick, it is the only other writer
+    pressed = switchPressed & mask;
+    switchPressed &= ~pressed;
+    INTCONbits.TMR0IE = 1;
+    return pressed;
 }
 
-// Check if sufficient time has passed to score again
-// Call this within the interrupt service routine for each switch
-int canScoreAgain(int switchIndex) {
-    unsigned long currentTime = millis(); 
-    if (currentTime - lastScoreTime[switchIndex] > SCORE_LOCKOUT_TIME) {
-        lastScoreTime[switchIndex] = currentTime;
-        return 1;
-    }
-    return 0;
+// throws away hits that have not been scored yet
+void clearEvents(){
+   hitTail = hitHead;
 }
-void handleSwitches(){
-    if (eventFlag & EVENT_RB7) {  // Check if RB7 event occurred
-            if (debounceSwitch(PORTBbits.RB7, 0)) {  // Perform debouncing
-                if (canScoreAgain(0)) {  // Check scoring conditions
-                    if (currentState == STATE_ACTIVE_GAME){
-                        ballIn(5);
-                    } else if (currentState == STATE_REVERSE_GAME) {
-                        ballInReverse(5);
-                    } else if (currentState == STATE_END_GAME || currentState == STATE_WIN_GAME) {
-                        currentState = STATE_REVERSE_GAME;
-                        ballInReverse(5);
-                    }
-                }
-            }
-            eventFlag &= ~EVENT_RB7;
+
+// What the scoreboard shows in each game state, any of them may be NULL.
+// The state itself is changed by the core (game_core.h); these only
+// follow it, from the scheduler tasks, and must never block.
+typedef struct {
+    void (*enter)(void);       // runs once when the core enters the state
+    void (*refresh)(void);     // display task, sets the fields to show
+    void (*scored)(void);      // a hit counted in this state
+} StateDisplay;
+
+extern const StateDisplay stateDisplays[STATE_COUNT];
+#define MARQUEE_STEP_MS 60     // scroll speed of the end screen messages, ms per column
+
+// shows what the core reported back, events are CORE_ bits; state is the
+// one the input arrived in
+void showEvents(uint8_t state, uint8_t events) {
+    if ((events & CORE_SCORED) && stateDisplays[state].scored != NULL) {
+        stateDisplays[state].scored();
     }
-    //RA0
-    if (eventFlag & EVENT_RA0) {  // Check if RA0 event occurred
-            if (debounceSwitch(PORTAbits.RA0, 1)) {  // Perform debouncing
-                if (canScoreAgain(1)) {  // Check scoring conditions
-                    if (currentState == STATE_ACTIVE_GAME){
-                        ballIn(10);
-                    } else if (currentState == STATE_REVERSE_GAME) {
-                        ballInReverse(10);
-                    } else if (currentState == STATE_END_GAME || currentState == STATE_WIN_GAME) {
-                        currentState = STATE_REVERSE_GAME;
-                        ballInReverse(10);
-                    }
-                }
-            }
-            eventFlag &= ~EVENT_RA0;
+    if ((events & CORE_NEW_STATE) && stateDisplays[game.state].enter != NULL) {
+        stateDisplays[game.state].enter();
     }
-    //RA1
-    if (eventFlag & EVENT_RA1) {  // Check if RA1 event occurred
-            if (debounceSwitch(PORTAbits.RA1, 2)) {  // Perform debouncing
-                if (canScoreAgain(2)) {  // Check scoring conditions
-                    if (currentState == STATE_ACTIVE_GAME){
-                        ballIn(50);
-                    } else if (currentState == STATE_REVERSE_GAME) {
-                        ballInReverse(50);
-                    } else if (currentState == STATE_END_GAME || currentState == STATE_WIN_GAME) {
-                        currentState = STATE_REVERSE_GAME;
-                        ballInReverse(50);
-                    }
-                }
-            }
-            eventFlag &= ~EVENT_RA1;
+}
+
+// new game: show "new game?" with the attract loop over it until start
+// is pressed
+void newGameEnter(void) {
+    display_Clear(LANE);
+    display_Top(LANE, 1, "NEW");
+    display_Bottom(LANE, 2, "   GAME?");
+    display_Animation(LANE, ANIM_ATTRACT, 0, ANIM_RETURN);
+}
+
+// active game: add points until no balls remain, hits from before the
+// start do not count; the attract loop stops
+void activeGameEnter(void) {
+    clearEvents();
+    display_Clear(LANE);
+    display_Animation(LANE, ANIM_STOP, 0, 0);
+}
+
+// a ball scored: flash the ball leds, then back to the score
+void activeGameScored(void) {
+    display_Animation(LANE, ANIM_DRAIN, 1, ANIM_RETURN);
+}
+
+void activeGameRefresh(void) {
+    // only the fields that changed since the last refresh are sent
+    display_Top(LANE, 1, "SCORE");
+    display_Score(LANE, game.score, 3);
+    display_Balls(LANE, game.balls);
+}
+
+// keeps this lane's best score ever on the leaderboard, which shows the
+// best of every lane
+void leaderboardRefresh(void) {
+    display_LaneBest(LEADERBOARD, highScores.scores[0]);
+}
+
+// writes prefix followed by number in decimal into message
+void scoreMessage(char* message, const char* prefix, int16_t number) {
+    char digits[6];
+    uint8_t count = 0;
+    uint16_t value = (number < 0) ? 0 : number;
+    strcpy(message, prefix);
+    message += strlen(message);
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        *message++ = digits[--count];
     }
-    //RA4
-    if (eventFlag & EVENT_RA4) {  // Check if RA4 event occurred
-            if (debounceSwitch(PORTAbits.RA4, 3)) {  // Perform debouncing
-                if (canScoreAgain(3)) {  // Check scoring conditions
-                    if (currentState == STATE_ACTIVE_GAME){
-                        ballIn(100);
-                    } else if (currentState == STATE_REVERSE_GAME) {
-                        ballInReverse(100);
-                    } else if (currentState == STATE_END_GAME || currentState == STATE_WIN_GAME) {
-                        currentState = STATE_REVERSE_GAME;
-                        ballInReverse(100);
-                    }
-                }
-            }
-            eventFlag &= ~EVENT_RA4;
+    *message = '\0';
+}
+
+// writes the end screen message: prefix and the score next to the high
+// score, or a new high score called out on its own
+void endMessage(char* message, const char* prefix, uint8_t rank) {
+    if (rank == 0) {
+        scoreMessage(message, "NEW HIGH SCORE ", game.score);
+        return;
     }
+    scoreMessage(message, prefix, game.score);
+    scoreMessage(message + strlen(message), " HI ", highScores.scores[0]);
 }
 
-// Handle winning the game
-void winGame() {
-    unsigned long lastUpdate = 0;
-    unsigned long updateInterval = 1000; // Update every 1000ms
-    int displayState = 0; // State variable to control which message is displayed
+// end and win: one looping message with the score until start is pressed
+// the Arduino scrolls it by itself, so nothing more goes over the bus
+// a hit from here starts reverse play, the hits of the last ball's
+// bounces do not
+// the score goes into the high score table, it is saved between games
+void endGameEnter(void) {
+    char message[SHADOW_MARQUEE_MAX + 1];
+    clearEvents();
+    endMessage(message, "GAME OVER ", scores_Insert(game.score));
+    display_Clear(LANE);
+    display_Marquee(LANE, 0x01, 3, MARQUEE_STEP_MS, MARQUEE_LOOP, message);
+}
 
-    // Handle end game display and wait for user to acknowledge
-    // Transition back to new game after some condition or timeout
-    while (!startButtonPressed()) {
-        unsigned long currentMillis = millis();
-        handleSwitches();
-        if (currentState != STATE_END_GAME) {
-            break; // Exit the loop if the state has changed
-        }
-        // Check if it's time to update the display
-        if (currentMillis - lastUpdate >= updateInterval) {
-            lastUpdate = currentMillis; // Reset the last update time
-            
-            // Toggle display based on the current state
-            if (displayState == 0) {
-                //display MAX and the score
-                i2c_clearScreen();
-                __delay_ms(50);
-                i2c_WriteToArduino(0x01,2, "MAX");
-                __delay_ms(50);
-                i2c_WriteScoreToArduino(score);
-                displayState = 1; // Change state to display "GAME OVER" next
-            } else {
-                // Display "GAME OVER"
-                i2c_clearScreen();
-                __delay_ms(50);
-                i2c_WriteToArduino(0x01,2, "GREAT");
-                __delay_ms(50);
-                i2c_WriteToArduino(0x02,4, "_____JOB");
-                displayState = 0; // Reset to display score next
-            }
-        }
+void winGameEnter(void) {
+    char message[SHADOW_MARQUEE_MAX + 1];
+    clearEvents();
+    endMessage(message, "GREAT JOB ", scores_Insert(game.score));
+    display_Clear(LANE);
+    display_Marquee(LANE, 0x01, 2, MARQUEE_STEP_MS, MARQUEE_LOOP, message);
+    display_Animation(LANE, ANIM_WIN, 2, ANIM_RETURN);
+}
+
+// reverse play: hits take points back until the score or the balls run out
+void reverseGameEnter(void) {
+    display_Clear(LANE);
+}
+
+void reverseGameRefresh(void) {
+    display_Top(LANE, 2, "SCORE");
+    display_Score(LANE, game.score, 2);
+    display_Balls(LANE, game.balls);
+}
 
-        // Check if start button is pressed to exit the loop and reset the game
-        if (startButtonPressed()) {
-            currentState = STATE_NEW_GAME;
-            break; // Break the loop to ensure the game state is changed immediately
+void reverseResultEnter(void) {
+    if (game.score == 0) {
+        display_Top(LANE, 1, "SUCCESS");
+    } else {
+        display_Top(LANE, 3, "FAIL ");
+    }
+    display_Score(LANE, game.score, 3);
+    display_Balls(LANE, game.balls);
+}
+
+const StateDisplay stateDisplays[STATE_COUNT] = {
+    //  enter               refresh             scored
+    { newGameEnter,       NULL,               NULL },             // STATE_NEW_GAME
+    { activeGameEnter,    activeGameRefresh,  activeGameScored }, // STATE_ACTIVE_GAME
+    { endGameEnter,       NULL,               NULL },             // STATE_END_GAME
+    { winGameEnter,       NULL,               NULL },             // STATE_WIN_GAME
+    { reverseGameEnter,   reverseGameRefresh, NULL },             // STATE_REVERSE_GAME
+    { reverseResultEnter, NULL,               NULL },             // STATE_REVERSE_RESULT
+};
+
+// Scores every queued hit in the order they happened
+void handleSwitches(){
+    PROFILE_BEGIN(PROFILE_SWITCHES);
+    while (hitTail != hitHead) {
+        uint8_t target = hitQueue[hitTail].target;
+        unsigned long hitTime = hitQueue[hitTail].time;
+        hitTail = (hitTail + 1) & (HIT_QUEUE_SIZE - 1);
+        hitCount[target]++;
+
+        uint16_t latency = millis() - hitTime;
+        if (latency > hitLatencyMax) {
+            hitLatencyMax = latency;
         }
+        uint8_t state = game.state;
+        showEvents(state, core_Hit(&game, &gameRules, target, hitTime));
     }
+    PROFILE_END(PROFILE_SWITCHES);
 }
 
-// Handle game over
-void endGame() {
-    unsigned long lastUpdate = 0;
-    unsigned long updateInterval = 1000; // Update every 1000ms
-    int displayState = 0; // State variable to control which message is displayed
+// Tournament start: the start button held down for TOURNAMENT_HOLD_MS
+// puts the banner on every lane's scoreboard at once with a general call,
+// and sends this lane back to a new game whatever it was playing. The
+// banner scrolls until each lane starts its first game.
+#define TOURNAMENT_HOLD_MS 2000
+#define TOURNAMENT_COLOR 4
+unsigned long startDownAt = 0;   // millis() the start button went down
+uint8_t startHeld = 0;           // 1 while it is down, 2 once this hold has started a tournament
+
+void tournamentCheck(void) {
+    if (!(switchState & EVENT_START)) {
+        startHeld = 0;
+    } else if (startHeld == 0) {
+        startHeld = 1;
+        startDownAt = millis();
+    } else if (startHeld == 1 && millis() - startDownAt >= TOURNAMENT_HOLD_MS &&
+               display_Broadcast(TOURNAMENT_COLOR, MARQUEE_STEP_MS, MARQUEE_LOOP, "TOURNAMENT START")) {
+        startHeld = 2;
+        core_Init(&game, &gameRules);
+        clearEvents();
+    }
+}
 
-    // Handle end game display and wait for user to acknowledge
-    // Transition back to new game after some condition or timeout
-    while (!startButtonPressed()) {
-        unsigned long currentMillis = millis();
-        handleSwitches();
-        if (currentState != STATE_END_GAME) {
-            break; // Exit the loop if the state has changed
-        }
-        // Check if it's time to update the display
-        if (currentMillis - lastUpdate >= updateInterval) {
-            lastUpdate = currentMillis; // Reset the last update time
-            
-            // Toggle display based on the current state
-            if (displayState == 0) {
-                // Display the score
-                i2c_clearScreen();
-                __delay_ms(50); // Short delay to ensure the screen is cleared
-                i2c_WriteToArduino(0x01, 1, "SCORE");
-                __delay_ms(50);
-                i2c_WriteScoreToArduino(score);
-                displayState = 1; // Change state to display "GAME OVER" next
-            } else {
-                // Display "GAME OVER"
-                i2c_clearScreen();
-                __delay_ms(50); // Short delay to ensure the screen is cleared
-                i2c_WriteToArduino(0x01, 3, "GAME");
-                __delay_ms(50);
-                i2c_WriteToArduino(0x02, 6, "____OVER");
-                displayState = 0; // Reset to display score next
-            }
-        }
+// Tasks, each one runs at its own period and returns right away
 
-        // Check if start button is pressed to exit the loop and reset the game
-        if (startButtonPressed()) {
-            currentState = STATE_NEW_GAME;
-            break; // Break the loop to ensure the game state is changed immediately
-        }
+// input: score hits and react to the start button
+void inputTask(void) {
+    handleSwitches();
+    if (takeSwitchPresses(EVENT_START)) {
+        uint8_t state = game.state;
+        showEvents(state, core_Start(&game, &gameRules));
     }
+    tournamentCheck();
 }
 
+// game logic: state transitions that do not come from a switch
+void gameTask(void) {
+    uint8_t state = game.state;
+    showEvents(state, core_Update(&game, &gameRules));
+}
 
-void newGame() {
-    //print "new game?"
-    i2c_clearScreen();
-    __delay_ms(50);
-    i2c_WriteToArduino(0x01,1, "NEW");
-    __delay_ms(50);
-    i2c_WriteToArduino(0x02,2, "___GAME?");
-    __delay_ms(50);
-    // Wait for start button press to initialize a new game
-    while (!startButtonPressed()) {
-        
+// display refresh: queue whatever changed on the scoreboard
+void displayTask(void) {
+    if (stateDisplays[game.state].refresh != NULL) {
+        stateDisplays[game.state].refresh();
     }
-    // once button is pressed initialize game variables
-    balls = 10;
-    score = 0;
-    clearEvents();
-    //begin game
-    if (startButtonPressed()) {
-        currentState = STATE_ACTIVE_GAME;
-    } 
+    leaderboardRefresh();
+    PROFILE_BEGIN(PROFILE_FLUSH);
+    display_FlushAll();
+    PROFILE_END(PROFILE_FLUSH);
 }
 
-void activeGame() {
-    unsigned long lastUpdate = 0;
-    unsigned long updateInterval = 200; // Update every 200ms
-    
-    //clear screen before starting
-    i2c_clearScreen();
-    __delay_ms(50);
-    
-    //game stays active as long as at least 1 ball remains
-    while (balls > 0) {
-        unsigned long currentMillis = millis();
-        handleSwitches();
-        // Only update the display if at least 200ms have passed
-        if (currentMillis - lastUpdate >= updateInterval) {
-            lastUpdate = currentMillis; // Update the last update time
-            i2c_WriteToArduino(0x01,1, "SCORE");
-            __delay_ms(50);
-            i2c_WriteScoreToArduino(score);
-            __delay_ms(50);
-            i2c_SendBallCount(balls);
-            __delay_ms(50);
-        }
+// storage: saves the high scores a byte at a time between games, an
+// EEPROM write takes ~4ms and must never hold up play
+void storageTask(void) {
+    if (game.state != STATE_ACTIVE_GAME && game.state != STATE_REVERSE_GAME) {
+        scores_Service();
     }
-    
-    // After exiting the loop, determine game state based on score
-    if (score >= 1000) {
-        currentState = STATE_WIN_GAME;
-    } else {
-        currentState = STATE_END_GAME;
+}
+
+#define TASK_COUNT 5
+extern Task tasks[TASK_COUNT];
+
+// clips a counter to one byte
+uint8_t clip8(uint16_t count) {
+    return (count > 255) ? 255 : count;
+}
+
+// telemetry: the counters and the profile table take turns going to the
+// lane's Arduino, which passes them on over its serial port, so each goes
+// out once a second. Skipped when the channel is full.
+// Payload, numbers little endian, the first byte is the page:
+//   TELEMETRY_PAGE_COUNTERS
+//     u16 main loop passes in the last second
+//     u16 hits on each target, wraps
+//     u8  hits lost from the queue, u16 longest hit to score latency in ms
+//     u8  I2C frames refused for a full channel, nacked, collisions
+//     u8  EEPROM bytes written, wraps
+//     u8  longest lateness of each task in ms over the last second
+//   TELEMETRY_PAGE_PROFILE
+//     u16 min, max and average us of each profile slot over the last second
+#define TELEMETRY_PAGE_COUNTERS 0
+#define TELEMETRY_PAGE_PROFILE 1
+#define TELEMETRY_SIZE (1 + 6 * PROFILE_SLOTS)   // the larger page
+uint8_t telemetryPage = TELEMETRY_PAGE_COUNTERS;
+
+// appends a number to a telemetry payload, low byte first
+uint8_t putWord(uint8_t* data, uint8_t n, uint16_t value) {
+    data[n++] = value;
+    data[n++] = value >> 8;
+    return n;
+}
+
+// appends the counters page after the page byte
+uint8_t telemetryCounters(uint8_t* data, uint8_t n) {
+    n = putWord(data, n, loopCount);
+    loopCount = 0;
+    for (uint8_t i = 0; i < CORE_TARGETS; i++) {
+        n = putWord(data, n, hitCount[i]);
     }
-    //clear events before changing states
-    clearEvents();
+    data[n++] = hitOverflowCount;
+    n = putWord(data, n, hitLatencyMax);
+    data[n++] = i2cFullCount;
+    data[n++] = i2cNackCount;
+    data[n++] = i2cCollisionCount;
+    data[n++] = eepromWrites;
+    for (uint8_t i = 0; i < TASK_COUNT; i++) {
+        data[n++] = clip8(tasks[i].maxLateness);
+        tasks[i].maxLateness = 0;
+    }
+    return n;
 }
 
-void reverseGame() {
-    unsigned long lastUpdate = 0;
-    unsigned long updateInterval = 200; // Update every 200ms
-    
-    //clear screen before starting
-    i2c_clearScreen();
-    __delay_ms(50);
-    
-    //game stays active as long as at least 1 ball remains
-    while (balls < 10 && score > 0) {
-        unsigned long currentMillis = millis();
-        handleSwitches();
-        // Only update the display if at least 200ms have passed
-        if (currentMillis - lastUpdate >= updateInterval) {
-            lastUpdate = currentMillis; // Update the last update time
-            i2c_WriteToArduino(0x01,2, "SCORE");
-            __delay_ms(50);
-            i2c_WriteScoreToArduino(score);
-            __delay_ms(50);
-            i2c_SendBallCount(balls);
-            __delay_ms(50);
+// moves the interrupt's profile into the table and starts it again
+// the MSSP interrupt is held off so a run is never half added or lost
+void profile_TakeIsr(void) {
+    PIE1bits.SSP1IE = 0;
+    profileTable[PROFILE_I2C_ISR].min = profileIsr.min;
+    profileTable[PROFILE_I2C_ISR].max = profileIsr.max;
+    profileTable[PROFILE_I2C_ISR].total = profileIsr.total;
+    profileTable[PROFILE_I2C_ISR].count = profileIsr.count;
+    profileIsr.min = 0;
+    profileIsr.max = 0;
+    profileIsr.total = 0;
+    profileIsr.count = 0;
+    PIE1bits.SSP1IE = 1;
+}
+
+void telemetryTask(void) {
+    uint8_t data[TELEMETRY_SIZE];
+    uint8_t n = 0;
+    data[n++] = telemetryPage;
+    if (telemetryPage == TELEMETRY_PAGE_PROFILE) {
+        profile_TakeIsr();
+        for (uint8_t i = 0; i < PROFILE_SLOTS; i++) {
+            n = putWord(data, n, profileTable[i].min);
+            n = putWord(data, n, profileTable[i].max);
+            n = putWord(data, n, profile_Average(&profileTable[i]));
         }
-    }
-    if (score == 0) {
-        i2c_WriteScoreToArduino(score);
-        __delay_ms(50);
-        i2c_WriteToArduino(0x01,1, "SUCCESS");
-        __delay_ms(50);
-        i2c_SendBallCount(balls);
-        __delay_ms(50);
+        profile_Reset();
+        telemetryPage = TELEMETRY_PAGE_COUNTERS;
     } else {
-        i2c_WriteToArduino(0x01,3, "FAIL ");
-        __delay_ms(50);
-        i2c_WriteScoreToArduino(score);
-        __delay_ms(50);
-        i2c_SendBallCount(balls);
-        __delay_ms(50);
+        n = telemetryCounters(data, n);
+        telemetryPage = TELEMETRY_PAGE_PROFILE;
     }
-    while (!startButtonPressed()) {
-        
+
+    I2cFrame* frame = i2c_BeginFrame(I2C_CHANNEL_LANE);
+    if (frame == NULL) {
+        return;
     }
-    //begin game
-    if (startButtonPressed()) {
-        currentState = STATE_ACTIVE_GAME;
-    } 
-    // once button is pressed initialize game variables
-    balls = 10;
-    score = 0;
-    clearEvents();
-  
+    i2c_PutTelemetry(frame, data, n);
+    i2c_CommitFrame(I2C_CHANNEL_LANE);
 }
 
-// these interrupts for the micro switches are simple functions that call ballIn to adjust the score
+Task tasks[TASK_COUNT] = {
+    // run            period (ms)
+    { inputTask,      1 },
+    { gameTask,       10 },
+    { displayTask,    50 },
+    { storageTask,    10 },
+    { telemetryTask,  500 },
+};
+
+// interrupt for the I2C queue and the 1ms Timer0 tick, which also debounces the switches
 void __interrupt() isr() {
-    //interrupt for RB7
-    if (IOCBFbits.IOCBF7) {
-        IOCBFbits.IOCBF7 = 0;
-        eventFlag |= EVENT_RB7;
-    }
-    //interrupt for RA0
-    if (IOCAFbits.IOCAF0) {
-        IOCAFbits.IOCAF0 = 0;
-        eventFlag |= EVENT_RA0;
-    }
-    //interrupt for RA1
-    if (IOCAFbits.IOCAF1) {
-        IOCAFbits.IOCAF1 = 0;
-        eventFlag |= EVENT_RA1;
+    //MSSP interrupt steps the frame at the head of the I2C queue
+    if (PIR1bits.SSP1IF) {
+        PROFILE_ISR_BEGIN();
+        PIR1bits.SSP1IF = 0;
+        i2c_Isr();
+        PROFILE_ISR_END();
     }
-    //interrupt for RA4
-    if (IOCAFbits.IOCAF4) {
-        IOCAFbits.IOCAF4 = 0;
-        eventFlag |= EVENT_RA4;
+    //bus collision, the I2C queue retries the frame
+    if (PIR2bits.BCL1IF) {
+        PIR2bits.BCL1IF = 0;
+        i2c_Collision();
     }
     //timer 0 interrupt for millis      
     if (INTCONbits.TMR0IF) {   // Check if Timer0 interrupt
         TMR0 = TMR0_PRELOAD;   // Reload the Timer0 preload value
         millisCounter++;       // Increment the milliseconds counter
+        debounceTick();        // Sample and debounce every switch
+        i2c_Tick();            // Start the next queued I2C frame when due
         INTCONbits.TMR0IF = 0; // Clear Timer0 interrupt flag
     }
 }
@@ -502,25 +590,14 @@ void __interrupt() isr() {
 void main(void) {
     initialSetup();
     setupSwitches();
+    core_Init(&game, &gameRules);
+    newGameEnter();
 
-    // Active loop with state switch
+    // Every state is driven by the tasks, nothing in here blocks
     while (1) {
-        switch (currentState) {
-            case STATE_NEW_GAME:
-                newGame();
-                break;
-            case STATE_ACTIVE_GAME:
-                activeGame();
-                break;
-            case STATE_END_GAME:
-                endGame();
-                break;
-            case STATE_WIN_GAME:
-                winGame();
-                break;
-            case STATE_REVERSE_GAME:
-                reverseGame();
-                break;
-        } 
+        PROFILE_BEGIN(PROFILE_LOOP);
+        scheduler_Run(tasks, TASK_COUNT);
+        loopCount++;
+        PROFILE_END(PROFILE_LOOP);
     }
 }
@@ -0,0 +1,90 @@
+#include <stdint.h>
+
+// Scoped timing of the hot paths.
+// PROFILE_BEGIN(slot) and PROFILE_END(slot) bracket a block in the same
+// scope, and every run adds its time to the slot's min/max/avg. The times
+// come from PROFILE_NOW(), the free running 1us Timer1 count on the PIC; a
+// host build can define it before including this file to use its own
+// clock with the same macros. A block has to take less than 65ms.
+
+#ifndef PROFILE_NOW
+uint16_t timer_Micros(void);
+#define PROFILE_NOW() timer_Micros()
+#endif
+
+#define PROFILE_LOOP 0       // one pass of the main loop
+#define PROFILE_SWITCHES 1   // handleSwitches()
+#define PROFILE_FLUSH 2      // display_FlushAll(), every i2c_Begin/Put/Commit of a refresh
+#define PROFILE_I2C_ISR 3    // one step of the I2C state machine in the interrupt, see below
+#define PROFILE_SLOTS 4
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint32_t total;     // sum of every run, for the average
+    uint16_t count;     // runs since the last reset
+} ProfileSlot;
+
+ProfileSlot profileTable[PROFILE_SLOTS];
+
+#define PROFILE_BEGIN(slot) uint16_t profileStart##slot = PROFILE_NOW()
+#define PROFILE_END(slot) profile_Record(slot, PROFILE_NOW() - profileStart##slot)
+
+// adds one run of elapsed us to a slot
+void profile_Record(uint8_t slot, uint16_t elapsed) {
+    ProfileSlot* entry = &profileTable[slot];
+    if (entry->count == 0 || elapsed < entry->min) {
+        entry->min = elapsed;
+    }
+    if (elapsed > entry->max) {
+        entry->max = elapsed;
+    }
+    entry->total += elapsed;
+    entry->count++;
+}
+
+// returns the average run of a slot in us, 0 if it has not run
+uint16_t profile_Average(const ProfileSlot* entry) {
+    return (entry->count == 0) ? 0 : entry->total / entry->count;
+}
+
+// starts a new measuring window for every slot
+void profile_Reset(void) {
+    for (uint8_t i = 0; i < PROFILE_SLOTS; i++) {
+        profileTable[i].min = 0;
+        profileTable[i].max = 0;
+        profileTable[i].total = 0;
+        profileTable[i].count = 0;
+    }
+}
+
+// The interrupt times itself into profileIsr, not into the table. Calling
+// profile_Record() or timer_Micros() from both the interrupt and the main
+// loop would make XC8 duplicate them, so PROFILE_ISR_BEGIN/END read Timer1
+// and add the run inline. The main loop takes the slot with interrupts
+// held off, see profile_TakeIsr() in pic_scoreboard.c.
+volatile ProfileSlot profileIsr;
+
+// reads Timer1 into value like timer_Micros(), but inline
+#define PROFILE_ISR_READ(value) do { \
+        uint8_t profileHigh; \
+        do { \
+            profileHigh = TMR1H; \
+            (value) = ((uint16_t)profileHigh << 8) | TMR1L; \
+        } while (profileHigh != TMR1H); \
+    } while (0)
+
+#define PROFILE_ISR_BEGIN() uint16_t profileIsrStart; PROFILE_ISR_READ(profileIsrStart)
+#define PROFILE_ISR_END() do { \
+        uint16_t profileIsrTime; \
+        PROFILE_ISR_READ(profileIsrTime); \
+        profileIsrTime -= profileIsrStart; \
+        if (profileIsr.count == 0 || profileIsrTime < profileIsr.min) { \
+            profileIsr.min = profileIsrTime; \
+        } \
+        if (profileIsrTime > profileIsr.max) { \
+            profileIsr.max = profileIsrTime; \
+        } \
+        profileIsr.total += profileIsrTime; \
+        profileIsr.count++; \
+    } while (0)
@@ -0,0 +1,47 @@
+#include <stdint.h>
+
+// Small cooperative scheduler driven by the millis() timebase.
+// Every task runs at a fixed period and must return without blocking,
+// so a slow task only ever delays the others by its own run time.
+
+unsigned long millis(void);
+uint16_t timer_Micros(void);
+
+typedef struct {
+    void (*run)(void);
+    uint16_t period;          // ms between runs
+    unsigned long nextRun;    // millis() when the task is next due
+    uint16_t runCount;        // times the task has run
+    uint16_t lastRunTime;     // us the last run took
+    uint16_t maxRunTime;      // longest single run in us
+    uint16_t maxLateness;     // longest a run started after it was due, in ms, until the owner resets it
+} Task;
+
+// Runs every task that is due, in table order
+void scheduler_Run(Task* tasks, uint8_t count) {
+    for (uint8_t i = 0; i < count; i++) {
+        Task* task = &tasks[i];
+        unsigned long now = millis();
+        if ((long)(now - task->nextRun) < 0) {
+            continue;   // Not due yet
+        }
+
+        uint16_t lateness = now - task->nextRun;
+        if (lateness > task->maxLateness) {
+            task->maxLateness = lateness;
+        }
+        task->nextRun += task->period;
+        if ((long)(now - task->nextRun) >= 0) {
+            task->nextRun = now + task->period;   // Fell a whole period behind, skip the missed runs
+        }
+
+        uint16_t start = timer_Micros();
+        task->run();
+
+        task->lastRunTime = timer_Micros() - start;
+        if (task->lastRunTime > task->maxRunTime) {
+            task->maxRunTime = task->lastRunTime;
+        }
+        task->runCount++;
+    }
+}
@@ -1,380 +1,716 @@
 #include <FastLED.h>
 #include <Wire.h>
 #include <avr/pgmspace.h>
+#include <util/twi.h>
 
 #define NUM_LEDS 256
 #define WIDTH 32
 #define HEIGHT 8
 #define DATA_PIN 2
-#define SLAVE_ADDRESS 0x04
+#define WS2812_PORT PORTD     // DATA_PIN is PD2 on the Uno
+#define WS2812_DDR DDRD
+#define WS2812_BIT _BV(PD2)
+#ifndef SLAVE_ADDRESS
+#define SLAVE_ADDRESS 0x04  // 0x04 + lane number on a lane scoreboard, 0x0B on the leaderboard
+#endif
+#define LEADERBOARD_SLAVE 0x0B  // the leaderboard's address, the only display that ignores the general call
 #define BUFFER_SIZE 32  
+#define MATRIX_DUMP 0     // 1: send 'd' over Serial to get the matrix back as text, blocks loop() and mixes text into the telemetry
+#define RX_QUEUE_SIZE 8   // frames buffered between receiveEvent() and loop(), must be a power of two
+#define MAX_FPS 30        // most times per second the strip is updated
+#define FRAME_INTERVAL_MS (1000 / MAX_FPS)
+#define SHOW_MAX_DEFER_MS 50  // show anyway if the bus has been busy this long
+#define SDA_SCL_MASK (_BV(PC4) | _BV(PC5))  // A4/A5 on the Uno
+#define WS2812_WINDOW_TICKS 10  // longest interrupt window in show(), Timer0 ticks of 4us
+#define BRIGHTNESS 40     // default global brightness, 0-255
+#define LED_GAMMA 0       // 1: gamma correct the palette before brightness, the colors then differ from the old firmware
+#define TELEMETRY 1       // send binary counter packets over Serial, see the telemetry section
 
-volatile byte i2cBuffer[BUFFER_SIZE];
-volatile int i2cBufferLength = 0;
-volatile bool dataReady = false;
+// Received frames wait in a single-producer/single-consumer ring:
+// receiveEvent() only moves rxHead and loop() only moves rxTail,
+// so neither side has to turn interrupts off
+struct RxFrame {
+    byte length;
+    byte data[BUFFER_SIZE];
+};
+volatile RxFrame rxQueue[RX_QUEUE_SIZE];
+volatile byte rxHead = 0;            // next slot receiveEvent() fills
+volatile byte rxTail = 0;            // next frame loop() processes
+volatile unsigned int rxFrames = 0;  // frames received, wraps
+volatile unsigned int rxDropped = 0; // frames lost because the ring was full
+volatile byte rxHighWater = 0;       // most frames ever waiting at once
+unsigned int rxMalformed = 0;        // frames rejected for an unknown command or a bad length
+volatile byte framesProcessed = 0;   // frames loop() has finished with, wraps at 256
+volatile bool showWaiting = false;   // a frame is due and waits for the bus to go quiet
+volatile bool showing = false;       // in ws2812Show(), the Wire interrupt only gets in between leds
 
-CRGB leds[NUM_LEDS];
+
+// Trace hook, called from receiveEvent() with every frame as it arrives.
+// It is empty here; a test or capture build can define it before this point
+// to record the raw traffic for replay.
+#ifndef TRACE_RX
+#define TRACE_RX(data, length)
+#endif
+
+// Commands never draw into leds[] directly. Every kind of content has its
+// own layer and compositeLayers() builds leds[] from them, bottom to top:
+//   background   the last streamed frame
+//   top text, bottom text, score, balls
+//   marquees
+//   overlay      animation frames
+// Unlit pixels of a layer let the layers below show through, so one field
+// can change without erasing the others or needing them sent again. A layer
+// change only marks the columns it covers in dirtyColumns, and only those
+// are built again, once per pass of loop().
+// leds[] is the back buffer: the strip keeps showing the last pushed frame
+// until the frame scheduler in loop() decides to show() again, so a clear
+// followed by a redraw is never seen half done.
+// Every led is a 4 bit palette index, two to a byte with the even led in the
+// low nibble, and is only turned into a color while it is sent to the strip.
+// Each column is 8 leds, so 4 bytes of a canvas.
+byte leds[NUM_LEDS / 2];
+byte background[NUM_LEDS / 2];  // last streamed frame, laid out like leds[]
+byte overlay[NUM_LEDS / 2];     // animation frames, laid out like leds[]
+bool overlayOn = false;         // overlay[] is on screen
+bool overlayOpaque = false;     // unlit overlay pixels hide the layers below too
+unsigned long dirtyColumns = 0; // bit x set when column x has to be built again
+bool frameChanged = false;  // set when leds[] or the palette changed, so show() can be skipped otherwise
+bool framePending = false;  // leds[] holds changes that have not been shown yet
+byte pendingUpdates = 0;    // passes of loop() that changed leds[] since the last show()
+unsigned long pendingSince = 0;  // millis() when the pending frame was started
+unsigned long lastShowTime = 0;  // millis() of the last show()
+
+// frame scheduler counters
+unsigned long framesShown = 0;       // times show() ran
+unsigned long framesCoalesced = 0;   // updates merged into a later show() instead of getting their own
+unsigned int showDuration = 0;       // us the last show() took
+unsigned int showDurationMax = 0;    // longest show() in us
+unsigned int showAborted = 0;        // show() runs cut short by a long interrupt, retried later
+unsigned int compositeDurationMax = 0;  // longest compositeLayers() in us
+
+// per command counters, indexed by the command byte
+#define COMMAND_LAST 0x0E
+unsigned int commandCount[COMMAND_LAST + 1];     // times each command ran, wraps
+unsigned int commandTimeMax[COMMAND_LAST + 1];   // longest run of each command in us
+
+// telemetry packet types, see the telemetry section
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_COUNTERS 1
+#define TELEMETRY_MASTER 2
+#define TELEMETRY_COMMANDS 3
+
+// palette indexes the drawing code uses, see palette[]
+#define COLOR_BLACK 0
+#define COLOR_RED 3
+#define COLOR_ORANGE 6
+
+// sets one 4 bit pixel of a canvas, returns true if it changed
+bool setPixel(byte* canvas, int index, byte color) {
+    byte* cell = &canvas[index >> 1];
+    byte value;
+    if (index & 1) {
+        value = (*cell & 0x0F) | (color << 4);
+    } else {
+        value = (*cell & 0xF0) | (color & 0x0F);
+    }
+    if (value == *cell) {
+        return false;
+    }
+    *cell = value;
+    return true;
+}
+
+// returns one 4 bit pixel of a canvas
+byte getPixel(const byte* canvas, int index) {
+    byte cell = canvas[index >> 1];
+    return (index & 1) ? (cell >> 4) : (cell & 0x0F);
+}
+
+// Text layers, one per row: the character and color at each of the 8 positions
+struct TextLayer {
+    char text[8];
+    byte color[8];
+};
+TextLayer textLayers[2];   // indexed by ROW_TOP and ROW_BOTTOM
+
+// The score layer holds a number right adjusted in the last SCORE_DIGITS
+// bottom positions, above the bottom text
+#define SCORE_DIGITS 5
+#define SCORE_FIRST_POSITION (8 - SCORE_DIGITS)
+char scoreDigits[SCORE_DIGITS] = {' ', ' ', ' ', ' ', ' '};  // ' ' is a blank position
+byte scoreColor = COLOR_RED;
+byte ballCount = 0;        // ball leds lit, see ballLeds[]
+
+// marks count columns from first to be built again, count is below 32
+void markColumns(byte first, byte count) {
+    dirtyColumns |= ((1UL << count) - 1) << first;
+}
+
+void markAllColumns() {
+    dirtyColumns = 0xFFFFFFFFUL;
+}
+
+// copies a whole canvas and marks the columns that differ
+void copyCanvas(byte* canvas, const byte* source) {
+    for (byte x = 0; x < WIDTH; x++) {
+        byte offset = x * (HEIGHT / 2);
+        if (memcmp(canvas + offset, source + offset, HEIGHT / 2) != 0) {
+            memcpy(canvas + offset, source + offset, HEIGHT / 2);
+            markColumns(x, 1);
+        }
+    }
+}
 
 // Mapping of LEDs for each character position
-// created an array for easier itteration
 // ONLY 8 CHARACTERS CAN BE DISPLAYED AT A TIME
-const int size = 15;
-// The top characters are mapped left adj
-int top1[size] = {0, 1, 2, 3, 4, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
-int top2[size] = {32, 33, 34, 35, 36, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52};
-int top3[size] = {64, 65, 66, 67, 68, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84};
-int top4[size] = {96, 97, 98, 99, 100, 107, 108, 109, 110, 111, 112, 113, 114, 115, 116};
-int top5[size] = {128, 129, 130, 131, 132, 139, 140, 141, 142, 143, 144, 145, 146, 147, 148};
-int top6[size] = {160, 161, 162, 163, 164, 171, 172, 173, 174, 175, 176, 177, 178, 179, 180};
-int top7[size] = {192, 193, 194, 195, 196, 203, 204, 205, 206, 207, 208, 209, 210, 211, 212};
-int top8[size] = {224, 225, 226, 227, 228, 235, 236, 237, 238, 239, 240, 241, 242, 243, 244};
-int* topMappings[8] = {top1, top2, top3, top4, top5, top6, top7, top8};
-
-// the bottom characters are mapped righ adj
-int bot1[size] = {12,11,10,9,8,23,22,21,20,19,28,27,26,25,24};
-int bot2[size] = {44,43,42,41,40,55,54,53,52,51,60,59,58,57,56};
-int bot3[size] = {76,75,74,73,72,87,86,85,84,83,92,91,90,89,88};
-int bot4[size] = {108,107,106,105,104,119,118,117,116,115,124,123,122,121,120};
-int bot5[size] = {140,139,138,137,136,151,150,149,148,147,156,155,154,153,152};
-int bot6[size] = {172,171,170,169,168,183,182,181,180,179,188,187,186,185,184};
-int bot7[size] = {204,203,202,201,200,215,214,213,212,211,220,219,218,217,216};
-int bot8[size] = {236,235,234,233,232,247,246,245,244,243,252,251,250,249,248};
-int* botMappings[8] = {bot1, bot2, bot3, bot4, bot5, bot6, bot7, bot8};
+// Each character is 3 columns of 5 rows, 15 pixels. The top characters are
+// mapped left adj, position p on columns 4p to 4p+2 and rows 0-4. The bottom
+// characters are mapped righ adj, on columns 4p+1 to 4p+3 and rows 3-7, so
+// the two rows share rows 3 and 4.
+#define ROW_TOP 0
+#define ROW_BOTTOM 1
 
 // certain leds indicate balls remaining
-int ballLeds[] = {9, 25, 41, 57, 73, 89, 105, 121, 137, 153};
+const uint8_t ballLeds[10] PROGMEM = {9, 25, 41, 57, 73, 89, 105, 121, 137, 153};
+
+// returns the led at column x (0-31) and row y (0-7)
+// the strip runs down the even columns and back up the odd ones
+int pixelLed(byte x, byte y) {
+    return x * HEIGHT + ((x & 1) ? (HEIGHT - 1 - y) : y);
+}
+
+// returns the row (0-7) of a led, the inverse of pixelLed()
+byte ledRow(int led) {
+    byte y = led & (HEIGHT - 1);
+    return ((led / HEIGHT) & 1) ? (HEIGHT - 1 - y) : y;
+}
+
+// returns the first column of the character at a row and position
+byte positionColumn(byte row, byte position) {
+    return position * 4 + ((row == ROW_TOP) ? 0 : 1);
+}
 
 // Characters LED Font
-// characters stored in progmem to free up ram
 // This tells the arduino what each character looks like
-const int ctA PROGMEM = 12;
-const int A[ctA] PROGMEM = {0,1,2,3,4,7,9,10,11,12,13,14};
-const int ctB PROGMEM = 12;
-const int B[ctB] PROGMEM = {0,1,2,3,4,5,7,9,10,11,13,14};
-const int ctC PROGMEM = 9;
-const int C[ctC] PROGMEM = {0,1,2,3,4,5,9,10,14};
-const int ctD PROGMEM = 10;
-const int D[ctD] PROGMEM = {0,1,2,3,4,5,9,11,12,13};
-const int ctE PROGMEM = 11;
-const int E[ctE] PROGMEM = {0,1,2,3,4,5,7,9,10,12,14};
-const int ctF PROGMEM = 9;
-const int F[ctF] PROGMEM = {0,1,2,3,4,7,9,10,12};
-const int ctG PROGMEM = 11;
-const int G[ctG] PROGMEM = {0,1,2,3,4,5,9,10,12,13,14};
-const int ctH PROGMEM = 11;
-const int H[ctH] PROGMEM = {0,1,2,3,4,7,10,11,12,13,14};
-const int ctI PROGMEM = 9;
-const int I[ctI] PROGMEM = {0,4,5,6,7,8,9,10,14};
-const int ctJ PROGMEM = 8;
-const int J[ctJ] PROGMEM = {3,4,5,10,11,12,13,14};
-const int ctK PROGMEM = 10;
-const int K[ctK] PROGMEM = {0,1,2,3,4,7,10,11,13,14};
-const int ctL PROGMEM = 7;
-const int L[ctL] PROGMEM = {0,1,2,3,4,5,14};
-const int ctM PROGMEM = 12;
-const int M[ctM] PROGMEM = {0,1,2,3,4,7,8,10,11,12,13,14};
-const int ctN PROGMEM = 10;
-const int N[ctN] PROGMEM = {0,1,2,3,4,9,11,12,13,14};
-const int ctO PROGMEM = 12;
-const int O[ctO] PROGMEM = {0,1,2,3,4,5,9,10,11,12,13,14};
-const int ctP PROGMEM = 10;
-const int P[ctP] PROGMEM = {0,1,2,3,4,7,9,10,11,12};
-const int ctQ PROGMEM = 11;
-const int Q[ctQ] PROGMEM = {0,1,2,3,6,9,10,11,12,13,14};
-const int ctR PROGMEM = 11;
-const int R[ctR] PROGMEM = {0,1,2,3,4,7,9,10,11,13,14};
-const int ctS PROGMEM = 11;
-const int S[ctS] PROGMEM = {0, 1, 2, 4, 5, 7, 9, 10, 12, 13, 14};
-const int ctT PROGMEM = 7;
-const int T[ctT] PROGMEM = {0,5,6,7,8,9,10};
-const int ctU PROGMEM = 11;
-const int U[ctU] PROGMEM = {0,1,2,3,4,5,10,11,12,13,14};
-const int ctV PROGMEM = 9;
-const int V[ctV] PROGMEM = {0,1,2,3,5,10,11,12,13};
-const int ctW PROGMEM = 12;
-const int W[ctW] PROGMEM = {0,1,2,3,4,6,7,10,11,12,13,14};
-const int ctX PROGMEM = 9;
-const int X[ctX] PROGMEM = {0,1,3,4,7,10,11,13,14};
-const int ctY PROGMEM = 9;
-const int Y[ctY] PROGMEM = {0,1,2,5,6,7,10,11,12};
-const int ctZ PROGMEM = 9;
-const int Z[ctZ] PROGMEM = {0,3,4,5,7,9,10,11,14};
-//Numbers
-const int ct0 PROGMEM = 12;
-const int n0[ct0] PROGMEM = {0,1,2,3,4,5,9,10,11,12,13,14};
-const int ct1 PROGMEM = 8;
-const int n1[ct1] PROGMEM = {0,4,5,6,7,8,9,14};
-const int ct2 PROGMEM = 11;
-const int n2[ct2] PROGMEM = {0,2,3,4,5,7,9,10,11,12,14};
-const int ct3 PROGMEM = 10;
-const int n3[ct3] PROGMEM = {0,4,5,7,9,10,11,12,13,14};
-const int ct4 PROGMEM = 9;
-const int n4[ct4] PROGMEM = {0,1,2,7,10,11,12,13,14};
-const int ct5 PROGMEM = 11;
-const int n5[ct5] PROGMEM = {0,1,2,4,5,7,9,10,12,13,14};
-const int ct6 PROGMEM = 12;
-const int n6[ct6] PROGMEM = {0,1,2,3,4,5,7,9,10,12,13,14};
-const int ct7 PROGMEM = 7;
-const int n7[ct7] PROGMEM = {0,5,6,7,9,10,11};
-const int ct8 PROGMEM = 13;
-const int n8[ct8] PROGMEM = {0,1,2,3,4,5,7,9,10,11,12,13,14};
-const int ct9 PROGMEM = 10;
-const int n9[ct9] PROGMEM = {0,1,2,7,9,10,11,12,13,14};
-// this is for "?"
-const int ctqq PROGMEM = 9;
-const int qq[ctqq] PROGMEM = {0,5,7,9,10,11,12};
-
-
-// this function takes the char from I2C and calls the correct Font variables
-void displayCharacterFromChar(char character, int *ledMapping, CRGB color) {
-    //this is setup so that a space will erase the previous character
-    // doing an ___ will not erase. this is good for overlaying top and bottom text
-    if (character == ' ') {
-        clearLedMapping(ledMapping);
-        return; // Skip the rest of the function
-    }  else if (character == '_') {
-        return; // Skip the rest of the function
-    }  
-    clearLedMapping(ledMapping);
-    int patternSize = 0;
-    const int *pattern = NULL;
-    
-    //this switch case maps each character to its pattern
-    switch(character) {
-        case 'A':
-            patternSize = pgm_read_word_near(&ctA);
-            pattern = A;
-            break;
-        case 'B':
-            patternSize = pgm_read_word_near(&ctB);
-            pattern = B;
-            break;
-        case 'C':
-            patternSize = pgm_read_word_near(&ctC);
-            pattern = C;
-            break;
-        case 'D':
-            patternSize = pgm_read_word_near(&ctD);
-            pattern = D;
-            break;
-        case 'E':
-            patternSize = pgm_read_word_near(&ctE);
-            pattern = E;
-            break;
-        case 'F':
-            patternSize = pgm_read_word_near(&ctF);
-            pattern = F;
-            break;
-        case 'G':
-            patternSize = pgm_read_word_near(&ctG);
-            pattern = G;
-            break;
-        case 'H':
-            patternSize = pgm_read_word_near(&ctH);
-            pattern = H;
-            break;
-        case 'I':
-            patternSize = pgm_read_word_near(&ctI);
-            pattern = I;
-            break;
-        case 'J':
-            patternSize = pgm_read_word_near(&ctJ);
-            pattern = J;
-            break;
-        case 'K':
-            patternSize = pgm_read_word_near(&ctK);
-            pattern = K;
-            break;
-        case 'L':
-            patternSize = pgm_read_word_near(&ctL);
-            pattern = L;
-            break;
-        case 'M':
-            patternSize = pgm_read_word_near(&ctM);
-            pattern = M;
-            break;
-        case 'N':
-            patternSize = pgm_read_word_near(&ctN);
-            pattern = N;
-            break;
-        case 'O':
-            patternSize = pgm_read_word_near(&ctO);
-            pattern = O;
-            break;
-        case 'P':
-            patternSize = pgm_read_word_near(&ctP);
-            pattern = P;
-            break;
-        case 'Q':
-            patternSize = pgm_read_word_near(&ctQ);
-            pattern = Q;
-            break;
-        case 'R':
-            patternSize = pgm_read_word_near(&ctR);
-            pattern = R;
-            break;
-        case 'S':
-            patternSize = pgm_read_word_near(&ctS);
-            pattern = S;
-            break;
-        case 'T':
-            patternSize = pgm_read_word_near(&ctT);
-            pattern = T;
-            break;
-        case 'U':
-            patternSize = pgm_read_word_near(&ctU);
-            pattern = U;
-            break;
-        case 'V':
-            patternSize = pgm_read_word_near(&ctV);
-            pattern = V;
-            break;
-        case 'W':
-            patternSize = pgm_read_word_near(&ctW);
-            pattern = W;
-            break;
-        case 'X':
-            patternSize = pgm_read_word_near(&ctX);
-            pattern = X;
-            break;
-        case 'Y':
-            patternSize = pgm_read_word_near(&ctY);
-            pattern = Y;
-            break;
-        case 'Z':
-            patternSize = pgm_read_word_near(&ctZ);
-            pattern = Z;
-            break;
-        case '0':
-            patternSize = pgm_read_word_near(&ct0);
-            pattern = n0;
-            break;
-        case '1':
-            patternSize = pgm_read_word_near(&ct1);
-            pattern = n1;
-            break;
-        case '2':
-            patternSize = pgm_read_word_near(&ct2);
-            pattern = n2;
-            break;
-        case '3':
-            patternSize = pgm_read_word_near(&ct3);
-            pattern = n3;
-            break;
-        case '4':
-            patternSize = pgm_read_word_near(&ct4);
-            pattern = n4;
-            break;
-        case '5':
-            patternSize = pgm_read_word_near(&ct5);
-            pattern = n5;
-            break;
-        case '6':
-            patternSize = pgm_read_word_near(&ct6);
-            pattern = n6;
-            break;
-        case '7':
-            patternSize = pgm_read_word_near(&ct7);
-            pattern = n7;
-            break;
-        case '8':
-            patternSize = pgm_read_word_near(&ct8);
-            pattern = n8;
-            break;
-        case '9':
-            patternSize = pgm_read_word_near(&ct9);
-            pattern = n9;
-            break;
-        case '?':
-            patternSize = pgm_read_word_near(&ctqq);
-            pattern = qq;
-            break;
-    }
+// Every glyph is one 15 bit mask, bit n set means pixel n of the character is lit.
+// glyph() builds the mask at compile time from the list of lit pixels.
+constexpr uint16_t glyph() {
+    return 0;
+}
+template <typename... Pixels>
+constexpr uint16_t glyph(int pixel, Pixels... rest) {
+    return (uint16_t)((1u << pixel) | glyph(rest...));
+}
 
+// indexed by character, starting at '0'. characters without a glyph are blank
+#define FONT_FIRST '0'
+#define FONT_LAST 'Z'
+const uint16_t font[FONT_LAST - FONT_FIRST + 1] PROGMEM = {
+    //Numbers
+    glyph(0,1,2,3,4,5,9,10,11,12,13,14),   // 0
+    glyph(0,4,5,6,7,8,9,14),               // 1
+    glyph(0,2,3,4,5,7,9,10,11,12,14),      // 2
+    glyph(0,4,5,7,9,10,11,12,13,14),       // 3
+    glyph(0,1,2,7,10,11,12,13,14),         // 4
+    glyph(0,1,2,4,5,7,9,10,12,13,14),      // 5
+    glyph(0,1,2,3,4,5,7,9,10,12,13,14),    // 6
+    glyph(0,5,6,7,9,10,11),                // 7
+    glyph(0,1,2,3,4,5,7,9,10,11,12,13,14), // 8
+    glyph(0,1,2,7,9,10,11,12,13,14),       // 9
+    0, 0, 0, 0, 0,                         // : ; < = >
+    glyph(0,5,7,9,10,11,12),               // ?
+    0,                                     // @
+    glyph(0,1,2,3,4,7,9,10,11,12,13,14),   // A
+    glyph(0,1,2,3,4,5,7,9,10,11,13,14),    // B
+    glyph(0,1,2,3,4,5,9,10,14),            // C
+    glyph(0,1,2,3,4,5,9,11,12,13),         // D
+    glyph(0,1,2,3,4,5,7,9,10,12,14),       // E
+    glyph(0,1,2,3,4,7,9,10,12),            // F
+    glyph(0,1,2,3,4,5,9,10,12,13,14),      // G
+    glyph(0,1,2,3,4,7,10,11,12,13,14),     // H
+    glyph(0,4,5,6,7,8,9,10,14),            // I
+    glyph(3,4,5,10,11,12,13,14),           // J
+    glyph(0,1,2,3,4,7,10,11,13,14),        // K
+    glyph(0,1,2,3,4,5,14),                 // L
+    glyph(0,1,2,3,4,7,8,10,11,12,13,14),   // M
+    glyph(0,1,2,3,4,9,11,12,13,14),        // N
+    glyph(0,1,2,3,4,5,9,10,11,12,13,14),   // O
+    glyph(0,1,2,3,4,7,9,10,11,12),         // P
+    glyph(0,1,2,3,6,9,10,11,12,13,14),     // Q
+    glyph(0,1,2,3,4,7,9,10,11,13,14),      // R
+    glyph(0,1,2,4,5,7,9,10,12,13,14),      // S
+    glyph(0,5,6,7,8,9,10),                 // T
+    glyph(0,1,2,3,4,5,10,11,12,13,14),     // U
+    glyph(0,1,2,3,5,10,11,12,13),          // V
+    glyph(0,1,2,3,4,6,7,10,11,12,13,14),   // W
+    glyph(0,1,3,4,7,10,11,13,14),          // X
+    glyph(0,1,2,5,6,7,10,11,12),           // Y
+    glyph(0,3,4,5,7,9,10,11,14)            // Z
+};
 
-        //Debugging code 
-        /*
-        Serial.print("Displaying character: ");
-        Serial.println(character);
-        Serial.print("Pattern Size: ");
-        Serial.println(patternSize);
-        Serial.print("Using LED mapping starting at index: ");
-        Serial.println(ledMapping[0]);  // Assuming this prints the first LED index used for this character
-        */
+// returns the pixel mask for a character, 0 if there is no glyph for it
+uint16_t glyphMask(char character) {
+    if (character < FONT_FIRST || character > FONT_LAST) {
+        return 0;
+    }
+    return pgm_read_word_near(&font[character - FONT_FIRST]);
+}
 
-    // Maps leds
-    for (int i = 0; i < patternSize; i++) {
-        int ledIndex = pgm_read_word_near(&pattern[i]);
-        if (ledIndex < size) {
-            leds[ledMapping[ledIndex]] = color;
-            // print for debugging
-            //Serial.print("Activating LED at index: ");
-            //Serial.println(ledMapping[ledIndex]);
-        }
+// this function puts a character in the text layer of a row at a position (0-7)
+// a space leaves the position blank, so the other row shows through again
+void displayCharacterFromChar(char character, byte row, byte position, byte color) {
+    // doing an ___ leaves the position as it is, kept for masters that still
+    // use it to write one row without erasing the other
+    if (character == '_') {
+        return; // Skip the rest of the function
+    }
+    TextLayer* layer = &textLayers[row];
+    uint16_t mask = glyphMask(character);
+    if (mask == glyphMask(layer->text[position]) && (mask == 0 || color == layer->color[position])) {
+        return;     // Looks the same already
     }
+    layer->text[position] = character;
+    layer->color[position] = color;
+    markColumns(positionColumn(row, position), 3);
 }
 
 //setup function
 void setup() {
-  //setup FastLED
-  FastLED.addLeds<WS2812, DATA_PIN, GRB>(leds, NUM_LEDS);
-  FastLED.clear();
-  FastLED.setBrightness(050);
+  //setup the strip, leds[] starts out black
+  WS2812_DDR |= WS2812_BIT;
+  loadPalette();
+  ws2812Show(false);
   //setup Wire
   Wire.begin(SLAVE_ADDRESS);
+#if SLAVE_ADDRESS != LEADERBOARD_SLAVE
+  TWAR |= _BV(TWGCE);   // also take general call frames sent to every lane
+#endif
   Wire.onReceive(receiveEvent);
+  Wire.onRequest(requestEvent);
   //setup Serial
   Serial.begin(9600);
-  Serial.println("Waiting for data...");
-}
-
-// Function to assign a cgrb color to integers 0-9
-CRGB colorSelect(int color) {
-  switch (color) {
-    case 1:
-      return CRGB::Green;
-    case 2:
-      return CRGB::Blue;
-    case 3:
-      return CRGB::Red;
-    case 4:
-      return CRGB::Yellow;
-    case 5:
-      return CRGB::Purple;
-    case 6:
-      return CRGB::Orange;
-    case 7:
-      return CRGB::White;
-    default:
-      return CRGB::Black;  // Default color if no valid color selected
+#if !TELEMETRY
+  Serial.println("Waiting for data...");   // text would only confuse the telemetry decoder
+#endif
+}
+
+// Default 16 color palette, the first 8 are the text colors
+#define PALETTE_SIZE 16
+const uint32_t palette[PALETTE_SIZE] PROGMEM = {
+    CRGB::Black, CRGB::Green, CRGB::Blue, CRGB::Red,
+    CRGB::Yellow, CRGB::Purple, CRGB::Orange, CRGB::White,
+    CRGB::Aqua, CRGB::Magenta, CRGB::Pink, CRGB::Navy,
+    CRGB::Gray, CRGB::Maroon, CRGB::Lime, CRGB::Gold
+};
+
+// The palette in use. Changing an entry recolors every led that uses it
+// without touching leds[], which is how whole screen flashes are done.
+CRGB paletteColors[PALETTE_SIZE];
+byte brightness = BRIGHTNESS;
+// paletteColors after gamma and brightness, in the GRB order the strip takes
+byte outputColors[PALETTE_SIZE][3];
+
+// scales one color channel for the strip
+byte outputLevel(byte level) {
+#if LED_GAMMA
+    level = ((unsigned int)level * level + 255) >> 8;   // gamma 2
+#endif
+    return ((unsigned int)level * (brightness + 1)) >> 8;
+}
+
+// sets one palette entry (0-15) and the output color it is sent as
+void setPaletteColor(byte index, CRGB color) {
+    index &= PALETTE_SIZE - 1;
+    paletteColors[index] = color;
+    outputColors[index][0] = outputLevel(color.g);
+    outputColors[index][1] = outputLevel(color.r);
+    outputColors[index][2] = outputLevel(color.b);
+    frameChanged = true;   // The leds did not change but what they show did
+}
+
+// restores the default palette
+void loadPalette() {
+    for (byte i = 0; i < PALETTE_SIZE; i++) {
+        setPaletteColor(i, CRGB(pgm_read_dword(&palette[i])));
+    }
+}
+
+// sets the global brightness, the whole palette is scaled again
+void setBrightness(byte level) {
+    brightness = level;
+    for (byte i = 0; i < PALETTE_SIZE; i++) {
+        setPaletteColor(i, paletteColors[i]);
+    }
+}
+
+// Function to assign a palette index to integers 0-9
+byte colorSelect(int color) {
+  if (color < 1 || color > 7) {
+    return COLOR_BLACK;  // Default color if no valid color selected
   }
+  return color;  // 1 green, 2 blue, 3 red, 4 yellow, 5 purple, 6 orange, 7 white
+}
+
+// Strip output
+// FastLED wants a 24 bit buffer per led, so the strip is driven here
+// instead: each 4 bit pixel is looked up in outputColors[] while it is
+// being sent. The bit timing is the one light_ws2812 uses for a 16MHz AVR.
+#if F_CPU != 16000000L
+#error "ws2812Byte() counts cycles for a 16MHz clock"
+#endif
+
+// clocks one byte out to the strip, most significant bit first
+// a 0 bit is high for 5 cycles, a 1 bit for 14, and every bit takes 20
+// host builds (host/) record the bytes instead, see host/arduino_host.h
+#ifdef __AVR__
+static inline void ws2812Byte(byte data, byte high, byte low) {
+    byte count;
+    asm volatile(
+        "       ldi   %0, 8     \n\t"
+        "1:                     \n\t"
+        "       out   %2, %3    \n\t"   // rising edge
+        "       rjmp  .+0       \n\t"   // 3 cycles
+        "       nop             \n\t"
+        "       sbrs  %1, 7     \n\t"
+        "       out   %2, %4    \n\t"   // falling edge of a 0 bit
+        "       lsl   %1        \n\t"
+        "       rjmp  .+0       \n\t"   // 7 cycles
+        "       rjmp  .+0       \n\t"
+        "       rjmp  .+0       \n\t"
+        "       nop             \n\t"
+        "       out   %2, %4    \n\t"   // falling edge of a 1 bit
+        "       rjmp  .+0       \n\t"   // 2 cycles
+        "       dec   %0        \n\t"
+        "       brne  1b        \n\t"
+        : "=&d" (count), "+r" (data)
+        : "I" (_SFR_IO_ADDR(WS2812_PORT)), "r" (high), "r" (low)
+    );
+}
+#else
+void ws2812Byte(byte data, byte high, byte low);
+#endif
+
+// The core's Timer0 counts (wiring.c), millis() and micros() read them
+extern volatile unsigned long timer0_overflow_count;
+extern volatile unsigned long timer0_millis;
+unsigned int timer0Fraction = 0;     // us toward the next ms, of overflows added below
+
+// Adds Timer0 overflows the core's interrupt did not get to, 1024us each
+// at 16MHz. Call with interrupts off.
+void timer0Catchup(byte overflows) {
+    unsigned long us = overflows * 1024UL + timer0Fraction;
+    timer0_overflow_count += overflows;
+    timer0_millis += us / 1000;
+    timer0Fraction = us % 1000;
+}
+
+// Sends leds[] to the strip, ~7.7ms for the whole matrix.
+// Interrupts are let in for a moment after every two leds, so the Wire
+// interrupt can take a byte and let go of SCL instead of holding the
+// master for the whole frame. The strip latches once the line has been low
+// for about 50us, so if a window ran longer than WS2812_WINDOW_TICKS the
+// rest of the frame would start over at the first led: the show is cut
+// short and false returned, and the caller sends it again later.
+// The interrupt for the stop at the end of a write runs receiveEvent(),
+// which copies the whole frame and can take longer than a window, so no
+// window is opened while one waits: it runs once the show is done, and
+// the Wire hardware stretches the clock of the next transaction meanwhile.
+// Without windows interrupts stay off the whole time and the show always
+// completes, the Wire hardware stretches the clock until it is done.
+// Whenever a window is not opened, Timer0 overflows are taken here instead
+// of by the core's interrupt, which would see only the last of them, and
+// handed to millis() at the end.
+bool ws2812Show(bool windows) {
+    byte sreg = SREG;
+    cli();
+    byte high = WS2812_PORT | WS2812_BIT;
+    byte low = WS2812_PORT & ~WS2812_BIT;
+    byte overflows = 0;
+    for (int i = 0; i < NUM_LEDS / 2; i++) {
+        byte cell = leds[i];
+        const byte* color = outputColors[cell & 0x0F];
+        ws2812Byte(color[0], high, low);
+        ws2812Byte(color[1], high, low);
+        ws2812Byte(color[2], high, low);
+        color = outputColors[cell >> 4];
+        ws2812Byte(color[0], high, low);
+        ws2812Byte(color[1], high, low);
+        ws2812Byte(color[2], high, low);
+
+        bool stopWaiting = (TWCR & _BV(TWINT)) && TW_STATUS == TW_SR_STOP;
+        if (!windows || stopWaiting) {
+            if (TIFR0 & _BV(TOV0)) {
+                TIFR0 = _BV(TOV0);      // a 1 clears it
+                overflows++;
+            }
+            continue;
+        }
+        // Interrupt window, the line is low between leds anyway
+        byte start = TCNT0;
+        sei();
+        asm volatile("nop");    // sei holds off interrupts for one instruction
+        cli();
+        if ((byte)(TCNT0 - start) > WS2812_WINDOW_TICKS) {
+            timer0Catchup(overflows);
+            SREG = sreg;
+            return false;
+        }
+    }
+    timer0Catchup(overflows);
+    SREG = sreg;
+    return true;
 }
 
 // wait for i2c event
+// runs in the Wire interrupt and queues the frame for loop()
 void receiveEvent(int howMany) {
+    rxFrames++;
+    byte next = (rxHead + 1) & (RX_QUEUE_SIZE - 1);
+    if (next == rxTail) {
+        // Ring is full, throw the frame away rather than overwrite a queued one
+        while (Wire.available()) {
+            Wire.read();
+        }
+        rxDropped++;
+        return;
+    }
+    volatile RxFrame* frame = &rxQueue[rxHead];
     int index = 0;
     while (Wire.available() && index < BUFFER_SIZE) {
-        i2cBuffer[index++] = Wire.read();
+        frame->data[index++] = Wire.read();
+    }
+    frame->length = index;  // Store the number of bytes read
+    TRACE_RX(frame->data, index);
+    rxHead = next;          // Publish the frame only once it is complete
+
+    byte waiting = (next - rxTail) & (RX_QUEUE_SIZE - 1);
+    if (waiting > rxHighWater) {
+        rxHighWater = waiting;
+    }
+}
+
+// Returns true while another I2C transaction is on the bus.
+// An idle bus has both lines high. SCL is sampled over a little more than
+// one 100kHz bit time, longer than a bit at any bus speed the master
+// uses, so a byte in flight is not missed.
+bool i2cBusActive() {
+    for (byte i = 0; i < 40; i++) {
+        if ((PINC & SDA_SCL_MASK) != SDA_SCL_MASK) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pushes leds[] to the strip and updates the frame counters
+// a show cut short by a long interrupt leaves the frame pending, so the
+// next pass of loop() sends it again. A frame that has waited
+// SHOW_MAX_DEFER_MS goes out with interrupts off so it is never starved.
+void showFrame() {
+    unsigned long start = micros();
+    bool windows = millis() - pendingSince < SHOW_MAX_DEFER_MS;
+    showing = true;         // a status read in a window says so
+    bool shown = ws2812Show(windows);
+    showing = false;
+    if (!shown) {
+        showAborted++;
+        return;
+    }
+    showDuration = micros() - start;
+    if (showDuration > showDurationMax) {
+        showDurationMax = showDuration;
+    }
+    framesShown++;
+    framesCoalesced += pendingUpdates - 1;
+    pendingUpdates = 0;
+    framePending = false;
+    lastShowTime = millis();
+}
+
+// Counts a pass of loop() that changed leds[] toward the next show()
+void frameUpdated() {
+    if (!framePending) {
+        framePending = true;
+        pendingSince = millis();
+    }
+    if (pendingUpdates < 255) {
+        pendingUpdates++;
     }
-    i2cBufferLength = index;  // Store the number of bytes read
-    dataReady = true;         // Set flag to indicate data is ready to be processed
 }
+
+// processes every queued frame, then shows the result when the frame scheduler allows it
 void loop() {
-    if (dataReady) {
-        processI2CData(i2cBuffer, i2cBufferLength);
-        dataReady = false;  // Reset the flag after processing
+    // Commands only change the layers, leds[] is built once they are all in
+    frameChanged = false;
+    while (rxTail != rxHead) {
+        volatile RxFrame* frame = &rxQueue[rxTail];
+        processI2CData((const byte*)frame->data, frame->length);
+        rxTail = (rxTail + 1) & (RX_QUEUE_SIZE - 1);
+        framesProcessed++;
+    }
+
+    // Scrolling text and animations move on by themselves without any bus traffic
+    updateMarquees();
+    updateAnimation();
+    compositeLayers();
+    if (frameChanged) {
+        frameUpdated();
+    }
+#if TELEMETRY
+    updateTelemetry();
+#endif
+
+    // Push at most MAX_FPS frames a second, and hold off while the master is
+    // talking to us because a long Wire interrupt cuts show() short
+    bool waiting = false;
+    if (framePending) {
+        unsigned long now = millis();
+        bool frameDue = now - lastShowTime >= FRAME_INTERVAL_MS;
+        bool busQuiet = !i2cBusActive() || now - pendingSince >= SHOW_MAX_DEFER_MS;
+        if (frameDue && busQuiet) {
+            showFrame();
+        } else {
+            waiting = frameDue;   // Tell the master through the status block
+        }
+    }
+    showWaiting = waiting;
+#if MATRIX_DUMP
+    if (Serial.available() && Serial.read() == 'd') {
+        dumpMatrix();
     }
+#endif
 }
+
+#if MATRIX_DUMP
+// Prints the matrix as 8 lines of 32 characters, one letter per palette
+// index ('.' is 0). Capturing these dumps on the bench gives plain text
+// frames that can be diffed between builds.
+// This blocks while Serial drains, so it is only for debugging.
+void dumpMatrix() {
+    const char codes[] = ".GBRYPOWamknsdlg";  // palette 0 to 15
+    for (byte y = 0; y < HEIGHT; y++) {
+        char line[WIDTH + 1];
+        for (byte x = 0; x < WIDTH; x++) {
+            line[x] = codes[getPixel(leds, pixelLed(x, y))];
+        }
+        line[WIDTH] = '\0';
+        Serial.println(line);
+    }
+    Serial.println();
+}
+#endif
+
+// Every length the sender gives is checked against the bytes that actually
+// arrived before anything is drawn, and frames that fail are only counted.
 void processI2CData(const byte* buffer, int length) {
     if (length == 0) return;  // No data to process
 
+    if (buffer[0] == 0x06) {
+        // Batch: a packed list of commands applied together with a single show()
+        // Every command is checked first so a damaged batch changes nothing
+        int offset = 1;
+        while (offset < length) {
+            int size = commandLength(buffer + offset, length - offset);
+            if (size == 0) {
+                rxMalformed++;
+                return;
+            }
+            offset += size;
+        }
+        offset = 1;
+        while (offset < length) {
+            int size = commandLength(buffer + offset, length - offset);
+            runCommand(buffer + offset, size);
+            offset += size;
+        }
+    } else if (buffer[0] == 0x07) {
+        unsigned long start = micros();
+        processFrameChunk(buffer, length);  // A stream chunk is the whole frame, it checks its own payload
+        countCommand(0x07, micros() - start);
+    } else {
+        int size = commandLength(buffer, length);
+        if (size == 0) {
+            rxMalformed++;
+            return;
+        }
+        runCommand(buffer, size);
+    }
+}
+
+// adds one run of a command to its counters
+void countCommand(byte command, unsigned int duration) {
+    commandCount[command]++;
+    if (duration > commandTimeMax[command]) {
+        commandTimeMax[command] = duration;
+    }
+}
+
+// applies one checked command and times it
+void runCommand(const byte* buffer, int length) {
+    unsigned long start = micros();
+    applyCommand(buffer, length);
+    countCommand(buffer[0], micros() - start);
+}
+
+// Returns how many bytes the command at the start of buffer uses,
+// or 0 if it is unknown or runs past the end of the buffer
+// applyCommand() is only ever given commands that passed this
+int commandLength(const byte* buffer, int length) {
+    int size = 0;
+    switch (buffer[0]) {
+        case 0x01:
+        case 0x02:
+            if (length < 3) return 0;
+            size = 3 + buffer[2];  // command, color, string length, then the string
+            break;
+        case 0x03:
+            size = 3;              // command, high byte, low byte
+            break;
+        case 0x04:
+            size = 2;              // command, ball count
+            break;
+        case 0x05:
+            size = 1;              // command only
+            break;
+        case 0x08:
+            if (length < 6) return 0;
+            size = 6 + buffer[5];  // command, row, color, speed, flags, string length, then the string
+            break;
+        case 0x09:
+            if (length < 3) return 0;
+            size = 3 + buffer[2] * 3;  // command, first entry, count, then 3 bytes per entry
+            break;
+        case 0x0A:
+            size = 2;              // command, brightness
+            break;
+        case 0x0B:
+            size = 4;              // command, animation, times, flags
+            break;
+        case 0x0C:
+            size = 4;              // command, high byte, low byte, color
+            break;
+        case 0x0D:
+            if (length < 2) return 0;
+            size = 2 + buffer[1];  // command, length, then the master's counters
+            break;
+        case 0x0E:
+            size = 4;              // command, lane, high byte, low byte
+            break;
+        default:
+            return 0;              // unknown commands and nested batches are rejected
+    }
+    return (size <= length) ? size : 0;
+}
+
+// Draws a single command into leds[], the caller decides when to show()
+void applyCommand(const byte* buffer, int length) {
     int command = buffer[0];  // First byte is the command
     switch (command) {
         case 0x01: {
             if (length < 3) return;  // Ensure minimum length for colorIndex and string length bytes
 
             int colorIndex = buffer[1];
-            CRGB color = colorSelect(colorIndex);
+            byte color = colorSelect(colorIndex);
             int stringLength = buffer[2];
 
             if (length < stringLength + 3) return;  // Ensure full string is in buffer
@@ -387,12 +723,12 @@ void processI2CData(const byte* buffer, int length) {
             }
             text[maxChars] = '\0';  // Ensure string is null-terminated
 
+            stopMarquee(ROW_TOP);  // Fixed text replaces scrolling text on the same row
             for (int i = 0; i < maxChars; i++) {
                 if (i < 8) {  // Ensure i does not exceed the number of defined mappings
-                    displayCharacterFromChar(text[i], topMappings[i], color);
+                    displayCharacterFromChar(text[i], ROW_TOP, i, color);
                 }
             }
-            FastLED.show();
             break;
         }
         case 0x02: {
@@ -400,7 +736,7 @@ void processI2CData(const byte* buffer, int length) {
             if (length < 3) return;  // Ensure there are at least 3 bytes: command, colorIndex, stringLength
 
             int colorIndex = buffer[1];
-            CRGB color = colorSelect(colorIndex); 
+            byte color = colorSelect(colorIndex); 
             int stringLength = buffer[2];
 
             // Ensure there is enough buffer for the entire string specified by stringLength
@@ -416,11 +752,11 @@ void processI2CData(const byte* buffer, int length) {
             text[maxChars] = '\0';  // Null-terminate the string
 
             // Display characters on the bottom line
+            stopMarquee(ROW_BOTTOM);  // Fixed text replaces scrolling text on the same row
             for (int i = 0; i < maxChars; i++) {
                 // Ensure i does not exceed the number of defined mappings
-                displayCharacterFromChar(text[i], botMappings[i % 8], color);
+                displayCharacterFromChar(text[i], ROW_BOTTOM, i % 8, color);
             }
-            FastLED.show();
             break;
         }
         case 0x03:
@@ -431,10 +767,9 @@ void processI2CData(const byte* buffer, int length) {
             int lowByte = buffer[2];    // Read low byte
 
             // Combine the high and low bytes to form a 16-bit integer
-            int number = (highByte << 8) | lowByte;
+            uint16_t number = (highByte << 8) | lowByte;
 
-            displayNumber(number);  // Display the number
-            FastLED.show();
+            displayNumber(number, COLOR_RED);  // Display the number
             break;
         }
         case 0x04:
@@ -443,75 +778,713 @@ void processI2CData(const byte* buffer, int length) {
 
             int ballCount = buffer[1];  // Read the ball count from buffer
             displayBalls(ballCount);   // Update the ball count display
-            FastLED.show();
             break;
         }        
         case 0x05:
         {
-            FastLED.clear();
-            FastLED.show();  // Ensure to update the display after clearing
+            clearLayers();  // A clear starts a new screen, so nothing may cover it
+            break;
+        }
+        case 0x08:
+        {
+            startMarquee(buffer, length);  // Scroll a long message on one row
+            break;
+        }
+        case 0x09:
+        {
+            // Palette: first entry, entry count, then red, green, blue for each
+            // A count of 0 restores the default palette
+            if (length < 3) return;
+            int count = buffer[2];
+            if (length < 3 + count * 3) return;
+            if (count == 0) {
+                loadPalette();
+            }
+            for (int i = 0; i < count; i++) {
+                const byte* rgb = buffer + 3 + i * 3;
+                setPaletteColor(buffer[1] + i, CRGB(rgb[0], rgb[1], rgb[2]));
+            }
+            break;
+        }
+        case 0x0A:
+        {
+            if (length < 2) return;
+            setBrightness(buffer[1]);  // Global brightness 0-255
             break;
         }
-        default: {
-            Serial.print("Unknown command received: ");
-            Serial.println(command);
+        case 0x0B:
+        {
+            startAnimation(buffer, length);  // Play an animation from flash
             break;
         }
+        case 0x0C:
+        {
+            // Score in a color: high byte, low byte, color 0-7
+            if (length < 4) return;
+            displayNumber((buffer[1] << 8) | buffer[2], colorSelect(buffer[3]));
+            break;
+        }
+        case 0x0D:
+        {
+            // Master telemetry: length, then its counters, passed on as they are
+#if TELEMETRY
+            sendMasterTelemetry(buffer + 2, buffer[1]);
+#endif
+            break;
+        }
+        case 0x0E:
+        {
+            // Best score of one lane: lane, high byte, low byte
+            if (length < 4) return;
+            displayLaneBest(buffer[1], (buffer[2] << 8) | buffer[3]);
+            break;
+        }
+        default:
+            break;  // commandLength() has already rejected it
     }
 }
 
 
 //this function turns on 10 specific pixels to represent balls left
 void displayBalls(int count) {
-  // Turn off all ball LEDs first
-  for (int i = 0; i < 10; i++) {
-    leds[ballLeds[i]] = CRGB::Black;
+  count = constrain(count, 0, 10);
+  // Only the balls that turn on or off are built again
+  for (int i = min(count, ballCount); i < max(count, (int)ballCount); i++) {
+    markColumns(pgm_read_byte(&ballLeds[i]) / HEIGHT, 1);
   }
+  ballCount = count;
+}
 
-  // Now turn on the LEDs up to the count
-  for (int i = 0; i < count; i++) {
-    // Ensure the index is within the array bounds
-    if (i < 10) {
-      leds[ballLeds[i]] = CRGB::Orange; // Or any other color you wish to use
+// Puts a number right adjusted in the score layer, without leading zeros.
+// The leading blanks let the bottom text show through. Only the positions
+// whose digit or color changed are built again.
+void displayNumber(uint16_t number, byte color) {
+    for (int8_t i = SCORE_DIGITS - 1; i >= 0; i--) {
+        char digit = (number > 0 || i == SCORE_DIGITS - 1) ? '0' + number % 10 : ' ';
+        number /= 10;
+        if (digit != scoreDigits[i] || (digit != ' ' && color != scoreColor)) {
+            scoreDigits[i] = digit;
+            markColumns(positionColumn(ROW_BOTTOM, SCORE_FIRST_POSITION + i), 3);
+        }
     }
-  }
+    scoreColor = color;
 }
 
-//simply displays a number when provided an int
-void displayNumber(int number) {
-    char numStr[5];  // Assuming a maximum of four digits plus a terminating null character
-    snprintf(numStr, sizeof(numStr), "%d", number);  // Convert the number to a string
+// Leaderboard
+// Every lane's PIC sends its own best score with 0x0E. The board keeps the
+// best of each lane and shows the lane holding the top one with its score,
+// so the lanes never have to know each other's scores.
+#define LANES_MAX 7
+#define LEADER_COLOR 4
+uint16_t laneBest[LANES_MAX];   // best score each lane sent, 0 until it does
 
-    // Clear only the last three character mappings before displaying new number
-    for (int i = 5; i < 8; i++) {  // Assuming mappings 5, 6, and 7 are the bottom right three positions
-        clearLedMapping(botMappings[i]);
+void displayLaneBest(byte lane, uint16_t number) {
+    if (lane >= LANES_MAX) {
+        return;
     }
+    laneBest[lane] = number;
+    byte leader = 0;
+    for (byte i = 1; i < LANES_MAX; i++) {
+        if (laneBest[i] > laneBest[leader]) {
+            leader = i;
+        }
+    }
+    char text[] = "LANE 1  ";
+    text[5] = '1' + leader;
+    stopMarquee(ROW_TOP);
+    for (byte i = 0; i < 8; i++) {
+        displayCharacterFromChar(text[i], ROW_TOP, i, colorSelect(LEADER_COLOR));
+    }
+    displayNumber(laneBest[leader], colorSelect(LEADER_COLOR));
+}
+
+// Streamed frames
+// A full 32x8 frame is sent as a run of 0x07 chunks, each small enough for
+// the 32 byte Wire buffer:
+//   [0] 0x07
+//   [1] frame sequence number
+//   [2] chunk number (0-63) | STREAM_LAST on the final chunk | STREAM_KEY on a keyframe
+//   [3] encoding, STREAM_PACKED or STREAM_RLE
+//   [4] first led the payload covers
+//   [5..] payload of palette indexes
+// STREAM_PACKED holds two pixels per byte, low nibble first.
+// STREAM_RLE holds one run per byte, (length - 1) << 4 | color.
+// A keyframe starts from a black canvas, any other frame only patches the
+// leds its chunks cover (delta frame). Chunks build the frame in
+// streamFrame[] and it only becomes the background layer when the last
+// chunk arrives with no chunk missing, so a torn frame is never shown.
+#define STREAM_HEADER 5
+#define STREAM_LAST 0x80
+#define STREAM_KEY 0x40
+#define STREAM_CHUNK_MASK 0x3F
+#define STREAM_PACKED 0
+#define STREAM_RLE 1
 
-    int len = strlen(numStr);  // Get the length of the number string
-    // Display the number starting from the rightmost available character mapping set
-    for (int i = 0; i < len; i++) {
-        // Calculate which mapping to use (counting backwards from the last mapping)
-        int* currentMapping = botMappings[7 - (len - 1 - i)];
-        // Convert char to uppercase, necessary if using alphanumeric character mappings
-        char currentChar = numStr[i];
-        // Display the character using a specific color, e.g., CRGB::Red
-        displayCharacterFromChar(currentChar, currentMapping, CRGB::Red);
+byte streamFrame[NUM_LEDS / 2];    // canvas laid out like leds[]
+byte streamSeq = 0;                // sequence number of the frame being built
+byte streamNextChunk = 0;          // chunk number expected next
+bool streamBroken = true;          // current frame lost a chunk and will be dropped
+bool streamSynced = false;         // canvas holds the last committed frame, so delta frames can apply
+unsigned int streamCommitted = 0;  // frames drawn
+unsigned int streamRejected = 0;   // frames dropped for a missing or bad chunk
+
+// writes a chunk payload into the canvas, returns false if it runs off the matrix
+bool decodeChunk(byte encoding, int led, const byte* payload, int length) {
+    for (int i = 0; i < length; i++) {
+        byte value = payload[i];
+        if (encoding == STREAM_PACKED) {
+            if (led + 2 > NUM_LEDS) return false;
+            setPixel(streamFrame, led++, value & 0x0F);
+            setPixel(streamFrame, led++, value >> 4);
+        } else if (encoding == STREAM_RLE) {
+            int run = (value >> 4) + 1;
+            if (led + run > NUM_LEDS) return false;
+            while (run--) {
+                setPixel(streamFrame, led++, value & 0x0F);
+            }
+        } else {
+            return false;
+        }
     }
+    return true;
 }
 
-// Function to clear all LEDs in a given mapping
-void clearLedMapping(int *ledMapping) {
-    for (int i = 0; i < size; i++) {
-        leds[ledMapping[i]] = CRGB::Black;
+// handles one 0x07 chunk
+void processFrameChunk(const byte* buffer, int length) {
+    if (length < STREAM_HEADER) return;
+
+    byte seq = buffer[1];
+    byte chunk = buffer[2] & STREAM_CHUNK_MASK;
+    bool last = buffer[2] & STREAM_LAST;
+
+    if (chunk == 0) {
+        // First chunk starts a new frame, whatever was half built is gone
+        streamSeq = seq;
+        streamNextChunk = 0;
+        streamBroken = false;
+        if (buffer[2] & STREAM_KEY) {
+            memset(streamFrame, 0, sizeof(streamFrame));
+        } else if (!streamSynced) {
+            streamBroken = true;  // A delta frame needs the previous frame as its base
+        }
+        streamSynced = false;     // The canvas no longer matches a committed frame until this one commits
+    } else if (seq != streamSeq || chunk != streamNextChunk) {
+        streamBroken = true;      // A chunk went missing
+    }
+
+    if (!streamBroken && !decodeChunk(buffer[3], buffer[4], buffer + STREAM_HEADER, length - STREAM_HEADER)) {
+        streamBroken = true;
+    }
+    streamNextChunk = chunk + 1;
+
+    if (!last) return;
+    if (streamBroken) {
+        // The canvas may be half patched, only a keyframe can fix it now
+        streamRejected++;
+        return;
     }
+    // The frame replaces the screen, text sent after it is drawn over it
+    stopAnimation();
+    hideOverlay();
+    stopMarquee(ROW_TOP);
+    stopMarquee(ROW_BOTTOM);
+    clearFields();
+    copyCanvas(background, streamFrame);
+    streamSynced = true;
+    streamBroken = true;          // Chunks after the last one need a new chunk 0
+    streamCommitted++;
 }
 
-//displays a character. must pass through displaycharacterfromchar for easier access
-void displayCharacter(int pattern[], int patternSize, int ledMapping[], int mappingSize, CRGB color) {
-  
-  for (int i = 0; i < patternSize; i++) {
-    if (pattern[i] < mappingSize) {  // Ensure the pattern index is within the mapping array size
-      leds[ledMapping[pattern[i]]] = color;  // Turn on the LED at the mapped index
+// Scrolling text
+// A message longer than the 8 character slots is sent once and the Arduino
+// scrolls it across one row by itself:
+//   [0] 0x08
+//   [1] row, 0x01 top or 0x02 bottom
+//   [2] color 0-7, same as the text commands
+//   [3] ms per one column step
+//   [4] flags, MARQUEE_LOOP to keep scrolling, otherwise it runs once and stops
+//   [5] string length, 0 stops the marquee
+//   [6..] the string
+// Each character is 3 columns plus a 1 column gap, the text enters from the
+// right edge and leaves on the left. Fixed text on the same row, a clear, or
+// a streamed frame stops it.
+#define MARQUEE_HEADER 6
+#define MARQUEE_MAX (BUFFER_SIZE - MARQUEE_HEADER)
+#define MARQUEE_LOOP 0x01
+
+struct Marquee {
+    char text[MARQUEE_MAX];
+    byte length;               // 0 when the marquee is off
+    byte color;                // palette index
+    byte stepMs;               // ms per column step
+    byte flags;
+    int offset;                // columns the text has moved in from the right edge
+    unsigned long lastStep;    // millis() of the last step
+};
+Marquee marquees[2];           // indexed by ROW_TOP and ROW_BOTTOM
+
+// returns the 5 pixels of one column (0-2) of a character, bit n is row n from the top
+byte glyphColumn(char character, byte column) {
+    uint16_t mask = glyphMask(character);
+    byte bits = 0;
+    for (byte r = 0; r < 5; r++) {
+        // the middle column of a glyph runs bottom to top, like the strip
+        byte pixel = (column == 0) ? r : (column == 1) ? 9 - r : 10 + r;
+        if (mask & (1 << pixel)) {
+            bits |= 1 << r;
+        }
     }
-  }
-}
\ No newline at end of file
+    return bits;
+}
+
+// returns the column bitmap the marquee of a row shows on screen column x when scrolled to offset
+byte marqueeColumn(byte row, int offset, byte x) {
+    Marquee* m = &marquees[row];
+    int column = offset - WIDTH + x;   // column of the text under screen column x
+    if (column < 0 || column >= m->length * 4 || (column & 3) == 3) {
+        return 0;                      // before, after, or in the gap between characters
+    }
+    return glyphColumn(m->text[column >> 2], column & 3);
+}
+
+// turns a marquee off
+void stopMarquee(byte row) {
+    Marquee* m = &marquees[row];
+    if (m->length == 0) return;
+    m->length = 0;
+    markAllColumns();
+}
+
+// handles a 0x08 command
+void startMarquee(const byte* buffer, int length) {
+    if (length < MARQUEE_HEADER) return;
+    int textLength = buffer[5];
+    if (length < MARQUEE_HEADER + textLength) return;
+
+    byte row = (buffer[1] == 0x02) ? ROW_BOTTOM : ROW_TOP;
+    stopMarquee(row);
+    Marquee* m = &marquees[row];
+    m->length = min(textLength, MARQUEE_MAX);
+    memcpy(m->text, buffer + MARQUEE_HEADER, m->length);
+    m->color = colorSelect(buffer[2]);
+    m->stepMs = max(buffer[3], 1);
+    m->flags = buffer[4];
+    m->offset = 0;
+    m->lastStep = millis();
+    markAllColumns();
+}
+
+// steps every running marquee that is due, called from loop()
+void updateMarquees() {
+    unsigned long now = millis();
+    for (byte row = 0; row < 2; row++) {
+        Marquee* m = &marquees[row];
+        if (m->length == 0 || now - m->lastStep < m->stepMs) {
+            continue;
+        }
+        m->lastStep = now;
+        m->offset++;
+        if (m->offset > WIDTH + m->length * 4) {
+            // The text has scrolled off the left edge
+            if (!(m->flags & MARQUEE_LOOP)) {
+                m->length = 0;         // Run once: stop, the last step already left the row blank
+                continue;
+            }
+            m->offset = 0;
+        }
+        markAllColumns();   // The whole row moved one column
+    }
+}
+
+// Animations
+// Short effects kept in flash and played by the Arduino on its own, so one
+// command replaces a string of screen writes:
+//   [0] 0x0B
+//   [1] animation number, ANIM_STOP (or any unknown number) stops the one playing
+//   [2] times to play it, 0 repeats until stopped
+//   [3] flags, ANIM_RETURN puts the scoreboard back when it ends
+// An animation is a list of frame records:
+//   hold time in ANIM_TICK_MS units (0 marks the end of the list)
+//   ANIM_KEY or 0
+//   span count, then each span: first led, run count, runs in the STREAM_RLE format
+// A keyframe starts from black, any other frame only patches its spans.
+// Animations are drawn as text in host/animations/ and compiled into
+// animations.h (make -C host animations), not written here by hand.
+// Frames are drawn into overlay[], above every other layer, so commands
+// sent meanwhile keep updating the layers under it. After a keyframe the
+// overlay is opaque, black included; until then only its lit pixels show.
+// With ANIM_RETURN the overlay goes away when the animation ends, without
+// it the last frame stays up until a clear, a streamed frame or the next
+// animation. A clear or a streamed frame stops the animation.
+#define ANIM_TICK_MS 10
+#define ANIM_KEY 0x01
+#define ANIM_RETURN 0x01
+#define ANIM_STOP 0xFF
+
+#include "animations.h"     // winAnimation[], drainAnimation[], attractAnimation[]
+
+// indexed by the animation number of the 0x0B command
+const byte* const animations[] PROGMEM = {
+    winAnimation,       // 0
+    drainAnimation,     // 1
+    attractAnimation,   // 2
+};
+#define ANIM_COUNT (sizeof(animations) / sizeof(animations[0]))
+
+struct AnimationPlayer {
+    bool playing;
+    const byte* start;         // first frame record, in flash
+    const byte* next;          // frame record drawn next, in flash
+    byte repeats;              // passes left, 0 plays until stopped
+    byte flags;
+    unsigned int holdMs;       // how long the frame on screen stays up
+    unsigned long lastFrame;   // millis() when it was drawn
+};
+AnimationPlayer animation;
+
+// draws one frame record into overlay[] and returns the record after it
+const byte* drawAnimationFrame(const byte* frame) {
+    byte flags = pgm_read_byte(frame + 1);
+    byte spans = pgm_read_byte(frame + 2);
+    frame += 3;
+    if (flags & ANIM_KEY) {
+        memset(overlay, 0, sizeof(overlay));
+        overlayOpaque = true;
+        markAllColumns();
+    }
+    while (spans--) {
+        int led = pgm_read_byte(frame++);
+        byte runs = pgm_read_byte(frame++);
+        while (runs--) {
+            byte value = pgm_read_byte(frame++);
+            for (byte n = (value >> 4) + 1; n > 0 && led < NUM_LEDS; n--, led++) {
+                if (setPixel(overlay, led, value & 0x0F)) {
+                    markColumns(led / HEIGHT, 1);
+                }
+            }
+        }
+    }
+    return frame;
+}
+
+// takes the overlay off the screen
+void hideOverlay() {
+    if (!overlayOn) return;
+    overlayOn = false;
+    markAllColumns();
+}
+
+// ends the animation on screen, if there is one
+void stopAnimation() {
+    if (!animation.playing) return;
+    animation.playing = false;
+    if (animation.flags & ANIM_RETURN) {
+        hideOverlay();
+    }
+}
+
+// handles a 0x0B command, the first frame is drawn on the next updateAnimation()
+void startAnimation(const byte* buffer, int length) {
+    if (length < 4) return;
+    stopAnimation();
+    if (buffer[1] >= ANIM_COUNT) return;   // ANIM_STOP
+
+    hideOverlay();
+    memset(overlay, 0, sizeof(overlay));
+    overlayOn = true;
+    overlayOpaque = false;
+    animation.playing = true;
+    animation.start = (const byte*)pgm_read_ptr(&animations[buffer[1]]);
+    animation.next = animation.start;
+    animation.repeats = buffer[2];
+    animation.flags = buffer[3];
+    animation.holdMs = 0;
+    animation.lastFrame = millis();
+}
+
+// draws the next animation frame when it is due, called from loop()
+void updateAnimation() {
+    if (!animation.playing) return;
+    unsigned long now = millis();
+    if (now - animation.lastFrame < animation.holdMs) return;
+
+    byte hold = pgm_read_byte(animation.next);
+    if (hold == 0) {
+        // End of the frame list
+        if (animation.repeats == 1) {
+            stopAnimation();
+            return;
+        }
+        if (animation.repeats > 1) {
+            animation.repeats--;
+        }
+        animation.next = animation.start;
+        hold = pgm_read_byte(animation.next);
+    }
+    animation.next = drawAnimationFrame(animation.next);
+    animation.holdMs = hold * ANIM_TICK_MS;
+    animation.lastFrame = now;
+}
+
+// Compositor
+// Builds leds[] from the layers, one column at a time and only where a
+// layer marked the column dirty
+
+// blanks the text, score and ball layers, only what was lit is built again
+void clearFields() {
+    for (byte row = 0; row < 2; row++) {
+        for (byte position = 0; position < 8; position++) {
+            displayCharacterFromChar(' ', row, position, COLOR_BLACK);
+        }
+    }
+    for (byte i = 0; i < SCORE_DIGITS; i++) {
+        if (scoreDigits[i] != ' ') {
+            scoreDigits[i] = ' ';
+            markColumns(positionColumn(ROW_BOTTOM, SCORE_FIRST_POSITION + i), 3);
+        }
+    }
+    displayBalls(0);
+}
+
+// empties every layer, the matrix goes black
+void clearLayers() {
+    stopAnimation();
+    hideOverlay();
+    stopMarquee(ROW_TOP);
+    stopMarquee(ROW_BOTTOM);
+    clearFields();
+    memset(background, 0, sizeof(background));
+    streamSynced = false;     // The screen no longer shows the last streamed frame, a delta needs a keyframe first
+    markAllColumns();
+}
+
+// sets the rows of a column from top down whose bit is set in bits
+void paintBits(byte* column, byte bits, byte top, byte color) {
+    for (byte r = 0; r < 5; r++) {
+        if (bits & (1 << r)) {
+            column[top + r] = color;
+        }
+    }
+}
+
+// builds column x of leds[] from the layers, bottom to top
+void compositeColumn(byte x) {
+    byte column[HEIGHT];
+    for (byte y = 0; y < HEIGHT; y++) {
+        column[y] = getPixel(background, pixelLed(x, y));
+    }
+
+    // Top text, rows 0-4
+    if ((x & 3) != 3) {
+        byte position = x >> 2;
+        TextLayer* layer = &textLayers[ROW_TOP];
+        paintBits(column, glyphColumn(layer->text[position], x & 3), 0, layer->color[position]);
+    }
+    // Bottom text and the score above it, rows 3-7
+    if (x > 0 && ((x - 1) & 3) != 3) {
+        byte position = (x - 1) >> 2;
+        byte glyphX = (x - 1) & 3;
+        TextLayer* layer = &textLayers[ROW_BOTTOM];
+        paintBits(column, glyphColumn(layer->text[position], glyphX), 3, layer->color[position]);
+        if (position >= SCORE_FIRST_POSITION) {
+            paintBits(column, glyphColumn(scoreDigits[position - SCORE_FIRST_POSITION], glyphX), 3, scoreColor);
+        }
+    }
+    for (byte i = 0; i < ballCount; i++) {
+        int led = pgm_read_byte(&ballLeds[i]);
+        if (led / HEIGHT == x) {
+            column[ledRow(led)] = COLOR_ORANGE;
+        }
+    }
+    for (byte row = 0; row < 2; row++) {
+        Marquee* m = &marquees[row];
+        if (m->length > 0) {
+            paintBits(column, marqueeColumn(row, m->offset, x), (row == ROW_TOP) ? 0 : 3, m->color);
+        }
+    }
+    if (overlayOn) {
+        for (byte y = 0; y < HEIGHT; y++) {
+            byte color = getPixel(overlay, pixelLed(x, y));
+            if (color != COLOR_BLACK || overlayOpaque) {
+                column[y] = color;
+            }
+        }
+    }
+
+    for (byte y = 0; y < HEIGHT; y++) {
+        if (setPixel(leds, pixelLed(x, y), column[y])) {
+            frameChanged = true;
+        }
+    }
+}
+
+// builds every dirty column, called from loop() before the frame scheduler
+void compositeLayers() {
+    if (dirtyColumns == 0) return;
+    unsigned long start = micros();
+    for (byte x = 0; x < WIDTH; x++) {
+        if (dirtyColumns & (1UL << x)) {
+            compositeColumn(x);
+        }
+    }
+    dirtyColumns = 0;
+    unsigned int duration = micros() - start;
+    if (duration > compositeDurationMax) {
+        compositeDurationMax = duration;
+    }
+}
+
+// Status read-back
+// The master reads this block before it sends, so it can send the next
+// frame as soon as there is room instead of waiting a fixed time
+#define STATUS_SIZE 6
+#define STATUS_BUSY 0x01     // in show(), a frame sent now only waits in the ring
+#define STATUS_WAITING 0x02  // showWaiting, a frame is due and waits for the bus to go quiet
+
+// returns a counter clipped to one byte
+byte statusCount(unsigned int count) {
+    return (count > 255) ? 255 : count;
+}
+
+// runs in the Wire interrupt when the master reads, answers with the status block:
+//   [0] frames processed, wraps
+//   [1] flags, STATUS_BUSY and STATUS_WAITING, the master holds off on either
+//   [2] frames the receive ring can still take
+//   [3] frames dropped because the ring was full
+//   [4] frames rejected as malformed
+//   [5] streamed frames rejected
+// the counters stop at 255
+void requestEvent() {
+    byte status[STATUS_SIZE];
+    byte waiting = (rxHead - rxTail) & (RX_QUEUE_SIZE - 1);
+    status[0] = framesProcessed;
+    status[1] = (showing ? STATUS_BUSY : 0) | (showWaiting ? STATUS_WAITING : 0);
+    status[2] = RX_QUEUE_SIZE - 1 - waiting;   // one slot always stays empty
+    status[3] = statusCount(rxDropped);
+    status[4] = statusCount(rxMalformed);
+    status[5] = statusCount(streamRejected);
+    Wire.write(status, STATUS_SIZE);
+}
+
+#if TELEMETRY
+// Telemetry
+// Once a second the counters go out over Serial as small binary packets:
+//   [0] TELEMETRY_SYNC
+//   [1] packet type
+//   [2] payload length
+//   [3..] payload, numbers little endian
+//   [last] low byte of the sum of the type, length and payload bytes
+// A packet is only written when the Serial transmit buffer has room for all
+// of it, so loop() never waits on the port; a packet that does not fit
+// waits for a later pass of loop(). Counters wrap and the receiving side
+// turns them into rates from one packet to the next.
+//
+// TELEMETRY_COUNTERS payload:
+//   u32 millis()
+//   u16 frames received, u16 dropped, u16 malformed, u16 streamed frames rejected
+//   u8  most frames ever waiting in the receive ring
+//   u16 show() count, u16 updates coalesced, u16 last show() us, u16 longest show() us
+//   u16 longest compositeLayers() us
+//   u16 show() runs cut short by a long interrupt
+//   u16 packets that had to wait for room
+//   u16 master pages dropped for want of room
+// TELEMETRY_COMMANDS payload, for every command 0x01 to COMMAND_LAST:
+//   u16 times it ran, u16 longest run in us
+// TELEMETRY_MASTER payload: the counters the master sent with 0x0D, as sent
+// The packet types are defined at the top.
+#define TELEMETRY_INTERVAL_MS 1000
+#define TELEMETRY_MAX (COMMAND_LAST * 4)   // largest payload
+
+byte telemetryPayload[TELEMETRY_MAX];
+byte telemetryLength = 0;
+byte telemetryWaiting = 0;           // packet types due, bit n for type n
+unsigned long lastTelemetry = 0;     // millis() when the last round was due
+unsigned int telemetryDeferred = 0;  // times a packet had to wait for room
+unsigned int telemetryMasterLost = 0;  // master pages dropped, they cannot wait
+
+void putByte(byte value) {
+    telemetryPayload[telemetryLength++] = value;
+}
+
+void put16(unsigned int value) {
+    putByte(value);
+    putByte(value >> 8);
+}
+
+// writes one packet if the transmit buffer can take all of it, returns false otherwise
+bool sendTelemetry(byte type, const byte* payload, byte length) {
+    if (Serial.availableForWrite() < length + 4) {
+        return false;
+    }
+    byte header[3] = {TELEMETRY_SYNC, type, length};
+    byte sum = type + length;
+    for (byte i = 0; i < length; i++) {
+        sum += payload[i];
+    }
+    Serial.write(header, sizeof(header));
+    Serial.write(payload, length);
+    Serial.write(sum);
+    return true;
+}
+
+// passes a master page on right away, there is nowhere to keep it
+void sendMasterTelemetry(const byte* payload, byte length) {
+    if (!sendTelemetry(TELEMETRY_MASTER, payload, length)) {
+        telemetryMasterLost++;
+    }
+}
+
+// fills telemetryPayload[] for one packet type
+void buildTelemetry(byte type) {
+    telemetryLength = 0;
+    if (type == TELEMETRY_COUNTERS) {
+        unsigned long now = millis();
+        noInterrupts();   // The receive counters are written from the Wire interrupt
+        unsigned int frames = rxFrames;
+        unsigned int dropped = rxDropped;
+        byte highWater = rxHighWater;
+        interrupts();
+        put16(now);
+        put16(now >> 16);
+        put16(frames);
+        put16(dropped);
+        put16(rxMalformed);
+        put16(streamRejected);
+        putByte(highWater);
+        put16(framesShown);
+        put16(framesCoalesced);
+        put16(showDuration);
+        put16(showDurationMax);
+        put16(compositeDurationMax);
+        put16(showAborted);
+        put16(telemetryDeferred);
+        put16(telemetryMasterLost);
+    } else {
+        for (byte command = 1; command <= COMMAND_LAST; command++) {
+            put16(commandCount[command]);
+            put16(commandTimeMax[command]);
+        }
+    }
+}
+
+// sends the next packet that is due, called from loop()
+void updateTelemetry() {
+    unsigned long now = millis();
+    if (now - lastTelemetry >= TELEMETRY_INTERVAL_MS) {
+        lastTelemetry = now;
+        if (telemetryWaiting) {
+            telemetryDeferred++;   // The last round is still not out
+        }
+        telemetryWaiting = _BV(TELEMETRY_COUNTERS) | _BV(TELEMETRY_COMMANDS);
+    }
+    for (byte type = TELEMETRY_COUNTERS; type <= TELEMETRY_COMMANDS; type++) {
+        if (telemetryWaiting & _BV(type)) {
+            buildTelemetry(type);
+            if (sendTelemetry(type, telemetryPayload, telemetryLength)) {
+                telemetryWaiting &= ~_BV(type);
+            }
+            return;   // At most one packet per pass
+        }
+    }
+}
+#endif